@@ -2,41 +2,97 @@
 
 #include "utils.hpp"
 
+// Elements are moved around with memcpy and never destructed, so T should be plain data
+// or at least not mind being relocated bitwise, which holds for Array itself.
 template<typename T>
 class Array
 {
     T* m_buffer;
     size_t m_used;
     size_t m_size;
+    Allocator* m_allocator;
+
+    static const size_t MIN_GROWTH_SIZE = 8;
     
 public:
-    Array()
+    Array(Allocator& allocator = get_heap_allocator())
     : m_size(0)
     , m_used(0)
     , m_buffer(nullptr)
+    , m_allocator(&allocator)
     {}
 
-    Array(size_t size)
+    Array(size_t size, Allocator& allocator = get_heap_allocator())
     : m_size(size)
     , m_used(0)
+    , m_allocator(&allocator)
     {
         size_t num_of_bytes = sizeof(T) * size;
-        m_buffer = static_cast<T*>(malloc(num_of_bytes));
+        m_buffer = static_cast<T*>(m_allocator->allocate(num_of_bytes, alignof(T)));
         memset(m_buffer, 0, num_of_bytes);
     }
 
+    // Copies would free the same buffer twice, hand the buffer over with a move instead.
+    Array(const Array<T>& other) = delete;
+    Array<T>& operator=(const Array<T>& other) = delete;
+
+    // The moved from Array is left empty but keeps its allocator, so it can be reused.
+    Array(Array<T>&& other)
+    : m_buffer(other.m_buffer)
+    , m_used(other.m_used)
+    , m_size(other.m_size)
+    , m_allocator(other.m_allocator)
+    {
+        other.m_buffer = nullptr;
+        other.m_used   = 0;
+        other.m_size   = 0;
+    }
+
+    Array<T>& operator=(Array<T>&& other)
+    {
+        if (this == &other)
+            return *this;
+
+        if (m_buffer)
+            m_allocator->deallocate(m_buffer, sizeof(T) * m_size);
+
+        m_buffer    = other.m_buffer;
+        m_used      = other.m_used;
+        m_size      = other.m_size;
+        m_allocator = other.m_allocator;
+
+        other.m_buffer = nullptr;
+        other.m_used   = 0;
+        other.m_size   = 0;
+        return *this;
+    }
+
     ~Array()
     {
-        free(m_buffer);
+        if (m_buffer)
+            m_allocator->deallocate(m_buffer, sizeof(T) * m_size);
         memset(this, 0, sizeof(*this));
     }
 
+    // Grows to twice the size when full, so pushes are amortized constant time.
     void push(T value)
     {
-        assert(m_used != m_size);
+        if (m_used == m_size)
+            reserve(max(m_size * 2, MIN_GROWTH_SIZE));
+
         m_buffer[m_used++] = value;
     }
 
+    // Constructs the element where it will live rather than copying it in.
+    template<typename... Args>
+    T& emplace(Args&&... args)
+    {
+        if (m_used == m_size)
+            reserve(max(m_size * 2, MIN_GROWTH_SIZE));
+
+        return *new (&m_buffer[m_used++]) T(std::forward<Args>(args)...);
+    }
+
     T pop()
     {
         assert(m_used != 0);
@@ -70,17 +126,69 @@ public:
         m_buffer[index] = value;
     }
 
-    void resize(size_t new_size)
+    // Makes room for at least `new_size` elements. Everything already in the buffer is
+    // kept and the new part is zeroed.
+    void reserve(size_t new_size)
     {
+        if (new_size <= m_size)
+            return;
+
+        size_t old_num_of_bytes = sizeof(T) * m_size;
+        size_t num_of_bytes     = sizeof(T) * new_size;
+
+        T* buffer = static_cast<T*>(m_allocator->allocate(num_of_bytes, alignof(T)));
         if (m_buffer)
-            free(m_buffer);
+        {
+            memcpy(buffer, m_buffer, old_num_of_bytes);
+            m_allocator->deallocate(m_buffer, old_num_of_bytes);
+        }
+        memset(reinterpret_cast<uint8_t*>(buffer) + old_num_of_bytes, 0, num_of_bytes - old_num_of_bytes);
 
-        m_size = new_size;
-        m_used = 0;
+        m_buffer = buffer;
+        m_size   = new_size;
+    }
+
+    // Like reserve but can shrink too, elements past `new_size` are dropped.
+    void resize(size_t new_size)
+    {
+        if (new_size >= m_size)
+        {
+            reserve(new_size);
+            return;
+        }
 
         size_t num_of_bytes = sizeof(T) * new_size;
-        m_buffer = static_cast<T*>(malloc(num_of_bytes));
-        memset(m_buffer, 0, new_size);
+        T* buffer = static_cast<T*>(m_allocator->allocate(num_of_bytes, alignof(T)));
+        memcpy(buffer, m_buffer, num_of_bytes);
+        m_allocator->deallocate(m_buffer, sizeof(T) * m_size);
+
+        m_buffer = buffer;
+        m_size   = new_size;
+        m_used   = min(m_used, new_size);
+    }
+
+    // Exchanges buffers without copying.
+    void swap(Array<T>& other)
+    {
+        T* buffer            = m_buffer;
+        size_t used          = m_used;
+        size_t size          = m_size;
+        Allocator* allocator = m_allocator;
+
+        m_buffer    = other.m_buffer;
+        m_used      = other.m_used;
+        m_size      = other.m_size;
+        m_allocator = other.m_allocator;
+
+        other.m_buffer    = buffer;
+        other.m_used      = used;
+        other.m_size      = size;
+        other.m_allocator = allocator;
+    }
+
+    Allocator& get_allocator()
+    {
+        return *m_allocator;
     }
 
     T* get_underlying_buffer()
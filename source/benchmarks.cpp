@@ -0,0 +1,536 @@
+#include "benchmarks.hpp"
+#include "life.hpp"
+#include "pattern.hpp"
+#include "snapshot.hpp"
+#include "history.hpp"
+
+// Only for comparison with Array.
+#include <vector>
+
+bool run_benchmark(const char* name, int num_of_threads)
+{
+    if (strcmp(name, "threads") == 0)
+    {
+        benchmark_threads(num_of_threads > 0 ? num_of_threads : ThreadPool::get_num_of_cores());
+        return true;
+    }
+
+    if (strcmp(name, "array") == 0)
+    {
+        benchmark_array();
+        return true;
+    }
+
+    if (strcmp(name, "pattern") == 0)
+    {
+        benchmark_pattern();
+        return true;
+    }
+
+    if (strcmp(name, "snapshot") == 0)
+    {
+        benchmark_snapshot();
+        return true;
+    }
+
+    if (strcmp(name, "history") == 0)
+    {
+        benchmark_history();
+        return true;
+    }
+
+    return false;
+}
+
+/* -------------------------------------- Threads ------------------------------------- */
+
+void benchmark_threads(int max_threads)
+{
+    int board_size      = 16384;
+    int num_of_warmups  = 1;
+    int num_of_gens     = 8;
+    uint64_t board_seed = 0x3C6EF372FE94F82Bull;
+
+    printf("[BENCHMARK]: %dx%d board, %d generations, %s kernel\n",
+           board_size, board_size, num_of_gens, life_get_best_kernel().name);
+    printf("[BENCHMARK]: %8s %12s %10s %12s\n", "threads", "ms/gen", "speedup", "efficiency");
+
+    LifeGrid grid(board_size, board_size);
+    double single_thread_time = 0;
+    uint64_t expected_hash    = 0;
+
+    int num_of_threads = 1;
+    for (;;)
+    {
+        ThreadPool thread_pool(num_of_threads);
+        grid.set_thread_pool(&thread_pool);
+
+        // Every run starts from the same board so the results can be checked against each
+        // other as well.
+        grid.randomize(board_seed, 0.3f);
+        grid.step(num_of_warmups);
+
+        double start_time = get_time_in_seconds();
+        grid.step(num_of_gens);
+        double time_per_gen = (get_time_in_seconds() - start_time) / num_of_gens;
+
+        grid.set_thread_pool(nullptr);
+
+        uint64_t hash = grid.get_hash();
+        if (num_of_threads == 1)
+        {
+            single_thread_time = time_per_gen;
+            expected_hash      = hash;
+        }
+
+        double speedup = single_thread_time / time_per_gen;
+        printf("[BENCHMARK]: %8d %12.3f %9.2fx %11.0f%%%s\n",
+               num_of_threads, time_per_gen * 1000.0, speedup, speedup / num_of_threads * 100.0,
+               hash == expected_hash ? "" : "  HASH MISMATCH");
+
+        if (num_of_threads == max_threads)
+            break;
+
+        num_of_threads = min(num_of_threads * 2, max_threads);
+    }
+}
+
+/* --------------------------------------- Array -------------------------------------- */
+
+struct ArrayBenchmarkResult
+{
+    double push_time;
+    double iterate_time;
+    uint64_t sum;
+};
+
+static ArrayBenchmarkResult time_array(size_t count, bool reserve)
+{
+    ArrayBenchmarkResult result = {};
+
+    double start_time = get_time_in_seconds();
+    Array<uint64_t> array;
+    if (reserve)
+        array.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        array.push(i);
+    result.push_time = get_time_in_seconds() - start_time;
+
+    start_time = get_time_in_seconds();
+    uint64_t* values = array.get_underlying_buffer();
+    for (size_t i = 0; i < array.get_used(); i++)
+        result.sum += values[i];
+    result.iterate_time = get_time_in_seconds() - start_time;
+
+    return result;
+}
+
+static ArrayBenchmarkResult time_vector(size_t count, bool reserve)
+{
+    ArrayBenchmarkResult result = {};
+
+    double start_time = get_time_in_seconds();
+    std::vector<uint64_t> vector;
+    if (reserve)
+        vector.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        vector.push_back(i);
+    result.push_time = get_time_in_seconds() - start_time;
+
+    start_time = get_time_in_seconds();
+    for (uint64_t value : vector)
+        result.sum += value;
+    result.iterate_time = get_time_in_seconds() - start_time;
+
+    return result;
+}
+
+void benchmark_array()
+{
+    size_t count       = 1 << 24;
+    int num_of_repeats = 5;
+
+    printf("[BENCHMARK]: %zu 64-bit pushes, best of %d\n", count, num_of_repeats);
+    printf("[BENCHMARK]: %-22s %14s %14s\n", "container", "push ns/elem", "iter ns/elem");
+
+    for (int reserve = 0; reserve < 2; reserve++)
+    {
+        for (int use_vector = 0; use_vector < 2; use_vector++)
+        {
+            ArrayBenchmarkResult best = {};
+            for (int repeat = 0; repeat < num_of_repeats; repeat++)
+            {
+                ArrayBenchmarkResult result = use_vector ? time_vector(count, reserve) : time_array(count, reserve);
+                assert_with_message(result.sum == count * (count - 1) / 2, "Wrong sum %llu", (unsigned long long) result.sum);
+
+                if (repeat == 0 || result.push_time < best.push_time)
+                    best.push_time = result.push_time;
+                if (repeat == 0 || result.iterate_time < best.iterate_time)
+                    best.iterate_time = result.iterate_time;
+            }
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s%s", use_vector ? "std::vector" : "Array", reserve ? " (reserved)" : "");
+            printf("[BENCHMARK]: %-22s %14.3f %14.3f\n", name, best.push_time * 1e9 / count, best.iterate_time * 1e9 / count);
+        }
+    }
+}
+
+/* -------------------------------------- Pattern ------------------------------------- */
+
+// Tools wrap RLE lines at 70 characters, so the benchmark files do too.
+static const int RLE_LINE_LENGTH = 70;
+
+static void write_rle_run(FILE* file, int64_t count, char tag, int& line_length)
+{
+    char run[32];
+    int length = count > 1 ? snprintf(run, sizeof(run), "%lld%c", (long long) count, tag) : snprintf(run, sizeof(run), "%c", tag);
+
+    if (line_length + length > RLE_LINE_LENGTH)
+    {
+        fputc('\n', file);
+        line_length = 0;
+    }
+
+    fwrite(run, 1, length, file);
+    line_length += length;
+}
+
+static void write_rle(FILE* file, LifeGrid& grid)
+{
+    fprintf(file, "#C Written by the pattern benchmark\nx = %d, y = %d, rule = B3/S23\n", grid.get_width(), grid.get_height());
+
+    int line_length    = 0;
+    int64_t empty_rows = 0;
+    for (int y = 0; y < grid.get_height(); y++)
+    {
+        int x = 0;
+        while (x < grid.get_width())
+        {
+            bool alive  = grid.get_cell(x, y);
+            int run_end = x;
+            while (run_end < grid.get_width() && grid.get_cell(run_end, y) == alive)
+                run_end++;
+
+            // Dead cells at the end of a row are left out.
+            if (alive || run_end < grid.get_width())
+            {
+                if (empty_rows)
+                {
+                    write_rle_run(file, empty_rows, '$', line_length);
+                    empty_rows = 0;
+                }
+
+                write_rle_run(file, run_end - x, alive ? 'o' : 'b', line_length);
+            }
+
+            x = run_end;
+        }
+
+        empty_rows++;
+    }
+
+    fputs("!\n", file);
+}
+
+static void write_life_106(FILE* file, LifeGrid& grid)
+{
+    fputs("#Life 1.06\n", file);
+    for (int y = 0; y < grid.get_height(); y++)
+    {
+        for (int x = 0; x < grid.get_width(); x++)
+        {
+            if (grid.get_cell(x, y))
+                fprintf(file, "%d %d\n", x, y);
+        }
+    }
+}
+
+static void write_plaintext(FILE* file, LifeGrid& grid)
+{
+    fputs("!Name: Written by the pattern benchmark\n", file);
+    for (int y = 0; y < grid.get_height(); y++)
+    {
+        for (int x = 0; x < grid.get_width(); x++)
+            fputc(grid.get_cell(x, y) ? 'O' : '.', file);
+        fputc('\n', file);
+    }
+}
+
+// Runs of a few hundred to a few thousand live cells, where set_run fills whole words.
+static void fill_stripes(LifeGrid& grid, uint64_t seed)
+{
+    uint64_t random_state = seed;
+    for (int y = 0; y < grid.get_height(); y++)
+    {
+        int x = 0;
+        while (x < grid.get_width())
+        {
+            int length = min(256 + (int) (random_next(random_state) % 2048), grid.get_width() - x);
+            grid.set_run(x, y, length);
+            x += length + 1 + (int) (random_next(random_state) % 64);
+        }
+    }
+}
+
+void benchmark_pattern()
+{
+    struct PatternBenchmark
+    {
+        const char* name;
+        const char* extension;
+        void (*write)(FILE* file, LifeGrid& grid);
+        int size;
+        bool is_striped;
+    };
+
+    PatternBenchmark benchmarks[] =
+    {
+        { "RLE soup",       "rle",   write_rle,       8192, false },
+        { "RLE stripes",    "rle",   write_rle,       8192, true  },
+        { "plaintext soup", "cells", write_plaintext, 4096, false },
+        { "Life 1.06 soup", "lif",   write_life_106,  1024, false },
+    };
+
+    int num_of_repeats = 5;
+    uint64_t seed      = 0x510E527FADE682D1ull;
+
+    printf("[BENCHMARK]: Loading patterns from a mapped file, best of %d\n", num_of_repeats);
+    printf("[BENCHMARK]: %-16s %10s %10s %10s %12s\n", "pattern", "MB", "ms", "MB/s", "Mcells/s");
+
+    for (PatternBenchmark& benchmark : benchmarks)
+    {
+        LifeGrid source(benchmark.size, benchmark.size);
+        if (benchmark.is_striped)
+            fill_stripes(source, seed);
+        else
+            source.randomize(seed, 0.3f);
+
+        char filepath[1024];
+        snprintf(filepath, sizeof(filepath), "%s/game_of_life_benchmark.%d.%s", P_tmpdir, (int) getpid(), benchmark.extension);
+
+        FILE* output = fopen(filepath, "wb");
+        assert_with_message(output, "Could not write %s", filepath);
+        benchmark.write(output, source);
+        fclose(output);
+
+        File file(filepath, FILE_ACCESS_SEQUENTIAL);
+        LifeGrid target(benchmark.size, benchmark.size);
+
+        double best_time = 0;
+        PatternInfo info = {};
+        for (int repeat = 0; repeat < num_of_repeats; repeat++)
+        {
+            target.clear();
+
+            // The formats without a header are decoded twice, once to find their size.
+            // Their top left is wherever the first live cells are, which is where the
+            // file's coordinates put it.
+            double start_time = get_time_in_seconds();
+            bool is_loaded    = pattern_get_info(file, info) && pattern_load(file, target, info.origin_x, info.origin_y, info);
+            double time       = get_time_in_seconds() - start_time;
+            assert_with_message(is_loaded, "%s:%zu: %s", filepath, info.error_line, info.error);
+
+            if (repeat == 0 || time < best_time)
+                best_time = time;
+        }
+
+        unlink(filepath);
+
+        double megabytes = file.get_size() / (1024.0 * 1024.0);
+        printf("[BENCHMARK]: %-16s %10.1f %10.2f %10.1f %12.1f%s\n",
+               benchmark.name, megabytes, best_time * 1000, megabytes / best_time, info.num_of_cells / best_time / 1e6,
+               target.get_hash() == source.get_hash() ? "" : "  MISMATCH");
+    }
+}
+
+/* ------------------------------------- Snapshot ------------------------------------- */
+
+void benchmark_snapshot()
+{
+    int board_size     = 16384;
+    int num_of_repeats = 3;
+    uint64_t seed      = 0x9B05688C2B3E6C1Full;
+
+    struct SnapshotBenchmark
+    {
+        const char* name;
+        int soup_size;
+    };
+
+    // A soup over the whole board doesn't compress at all, one in a corner leaves most
+    // rows empty.
+    SnapshotBenchmark benchmarks[] =
+    {
+        { "dense soup",  16384 },
+        { "sparse soup", 2048  },
+    };
+
+    char filepath[1024];
+    snprintf(filepath, sizeof(filepath), "%s/game_of_life_benchmark.%d.snapshot", P_tmpdir, (int) getpid());
+
+    printf("[BENCHMARK]: %dx%d board, best of %d\n", board_size, board_size, num_of_repeats);
+    printf("[BENCHMARK]: %-12s %8s %10s %10s %11s %10s\n", "board", "MB", "encode ms", "write ms", "restore ms", "stall ms");
+
+    for (SnapshotBenchmark& benchmark : benchmarks)
+    {
+        LifeGrid source(board_size, board_size);
+        LifeGrid soup(benchmark.soup_size, benchmark.soup_size);
+        soup.randomize(seed, 0.3f);
+        for (int y = 0; y < benchmark.soup_size; y++)
+            source.set_row(0, y, soup.get_row(y), soup.get_words_per_row());
+        source.set_generation(12345);
+
+        LifeGrid target(board_size, board_size);
+        Array<uint64_t> buffer;
+        SnapshotWriter writer;
+        double best_encode_time  = 0;
+        double best_write_time   = 0;
+        double best_restore_time = 0;
+        double best_stall_time   = 0;
+        bool is_same             = true;
+
+        for (int repeat = 0; repeat < num_of_repeats; repeat++)
+        {
+            double start_time = get_time_in_seconds();
+            snapshot_encode(source, buffer);
+            double encode_time = get_time_in_seconds() - start_time;
+
+            start_time = get_time_in_seconds();
+            bool is_written = snapshot_write(filepath, buffer);
+            double write_time = get_time_in_seconds() - start_time;
+            assert_with_message(is_written, "Could not write %s", filepath);
+
+            // Opening the file is part of restoring, it's mapped rather than read.
+            target.clear();
+            start_time = get_time_in_seconds();
+            File file;
+            SnapshotInfo info;
+            bool is_restored = file.open(filepath, FILE_ACCESS_SEQUENTIAL) && snapshot_get_info(file, info) &&
+                               snapshot_restore(file, target, 0, 0, info);
+            double restore_time = get_time_in_seconds() - start_time;
+            assert_with_message(is_restored, "Could not restore %s: %s", filepath, info.error);
+            is_same = is_same && target.get_hash() == source.get_hash() && target.get_generation() == source.get_generation();
+
+            // How long the simulation thread would be held up by a background snapshot.
+            start_time = get_time_in_seconds();
+            writer.save(source, filepath);
+            double stall_time = get_time_in_seconds() - start_time;
+            writer.wait();
+
+            if (repeat == 0 || encode_time < best_encode_time)
+                best_encode_time = encode_time;
+            if (repeat == 0 || write_time < best_write_time)
+                best_write_time = write_time;
+            if (repeat == 0 || restore_time < best_restore_time)
+                best_restore_time = restore_time;
+            if (repeat == 0 || stall_time < best_stall_time)
+                best_stall_time = stall_time;
+        }
+
+        unlink(filepath);
+
+        printf("[BENCHMARK]: %-12s %8.1f %10.2f %10.2f %11.2f %10.2f%s\n", benchmark.name,
+               buffer.get_used() * sizeof(uint64_t) / (1024.0 * 1024.0), best_encode_time * 1000, best_write_time * 1000,
+               best_restore_time * 1000, best_stall_time * 1000, is_same ? "" : "  MISMATCH");
+    }
+}
+
+/* -------------------------------------- History ------------------------------------- */
+
+void benchmark_history()
+{
+    int board_size         = 2048;
+    int num_of_generations = 512;
+    size_t memory_budget   = 1ull << 30;
+    uint64_t seed          = 0x510E527FADE682D1ull;
+
+    // Past the first burst, where nearly every word changes every generation.
+    LifeGrid grid(board_size, board_size);
+    grid.randomize(seed, 0.3f);
+    grid.step(1024);
+
+    // Hashes of every generation, to check what comes back.
+    Array<uint64_t> hashes;
+    LifeHistory history(memory_budget);
+
+    double step_time   = 0;
+    double record_time = 0;
+    for (int generation = 0; generation < num_of_generations; generation++)
+    {
+        double start_time = get_time_in_seconds();
+        if (generation > 0)
+            grid.step();
+        step_time += get_time_in_seconds() - start_time;
+
+        start_time = get_time_in_seconds();
+        history.record(grid);
+        record_time += get_time_in_seconds() - start_time;
+
+        hashes.push(grid.get_hash());
+    }
+
+    double board_mb   = board_size * (double) board_size / 8 / (1024 * 1024);
+    double history_mb = history.get_memory_used() / (1024.0 * 1024.0);
+    printf("[BENCHMARK]: %dx%d soup, %d generations after the first 1024\n", board_size, board_size, num_of_generations);
+    printf("[BENCHMARK]: Recording   %8.3f ms/generation (stepping %.3f ms/generation)\n",
+           record_time * 1000 / num_of_generations, step_time * 1000 / num_of_generations);
+    printf("[BENCHMARK]: Memory      %8.1f MB, %.1f KB/generation against %.1f KB for whole boards\n",
+           history_mb, history_mb * 1024 / num_of_generations, board_mb * 1024);
+
+    // One step back at a time, the way it's scrubbed through.
+    bool is_same      = true;
+    double start_time = get_time_in_seconds();
+    for (int generation = num_of_generations - 2; generation >= 0; generation--)
+    {
+        history.restore(grid, 1024 + generation);
+        is_same = is_same && grid.get_hash() == hashes[generation];
+    }
+    double back_time = get_time_in_seconds() - start_time;
+
+    // Jumps all over, which is a keyframe and some deltas each time.
+    uint64_t random_state = seed;
+    int num_of_jumps = 256;
+    start_time = get_time_in_seconds();
+    for (int i = 0; i < num_of_jumps; i++)
+    {
+        int generation = (int) (random_next(random_state) % num_of_generations);
+        history.restore(grid, 1024 + generation);
+        is_same = is_same && grid.get_hash() == hashes[generation];
+    }
+    double jump_time = get_time_in_seconds() - start_time;
+
+    printf("[BENCHMARK]: Step back   %8.3f ms\n", back_time * 1000 / (num_of_generations - 1));
+    printf("[BENCHMARK]: Jump        %8.3f ms\n", jump_time * 1000 / num_of_jumps);
+    if (!is_same)
+        printf("[BENCHMARK]: MISMATCH, a restored generation isn't what was recorded\n");
+
+    // Only the tiles that changed are recorded, so a small soup on the same board should
+    // cost about as much as it would on a board its size.
+    int soup_size = 256;
+    LifeGrid soup(soup_size, soup_size);
+    soup.randomize(seed, 0.3f);
+
+    LifeGrid sparse_grid(board_size, board_size);
+    int soup_offset = (board_size - soup_size) / 2;
+    for (int y = 0; y < soup_size; y++)
+        sparse_grid.set_row(soup_offset, soup_offset + y, soup.get_row(y), soup.get_words_per_row());
+
+    LifeHistory sparse_history(memory_budget);
+    step_time   = 0;
+    record_time = 0;
+    for (int generation = 0; generation < num_of_generations; generation++)
+    {
+        double start_time = get_time_in_seconds();
+        if (generation > 0)
+            sparse_grid.step();
+        step_time += get_time_in_seconds() - start_time;
+
+        start_time = get_time_in_seconds();
+        sparse_history.record(sparse_grid);
+        record_time += get_time_in_seconds() - start_time;
+    }
+
+    printf("[BENCHMARK]: Sparse      %8.3f ms/generation recording a %dx%d soup on the same board (stepping %.3f ms/generation)\n",
+           record_time * 1000 / num_of_generations, soup_size, soup_size, step_time * 1000 / num_of_generations);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Benchmarks are run from the command line with --benchmark=<name> and print their
+// results to stdout. Returns false if there's no benchmark with that name.
+bool run_benchmark(const char* name, int num_of_threads);
+
+// Steps a large board with 1, 2, 4... up to `max_threads` threads and reports the
+// speedup over a single thread.
+void benchmark_threads(int max_threads);
+
+// Pushes into and then iterates over an Array and a std::vector, growing from empty and
+// with the space reserved up front.
+void benchmark_array();
+
+// Writes boards out as RLE, Life 1.06 and plaintext and reports how fast each is loaded
+// back, in MB/s of file and cells/s.
+void benchmark_pattern();
+
+// Saves a large board as a snapshot and restores it, dense and sparse, and reports how long
+// a background snapshot holds up the thread taking it.
+void benchmark_snapshot();
+
+// Records a soup generation by generation, then steps back through it and jumps around in
+// it, checking every generation that comes back.
+void benchmark_history();
@@ -0,0 +1,108 @@
+#include "font_cache.hpp"
+#include "utils.hpp"
+
+FontCache::FontCache()
+: m_file()
+{}
+
+FontCache::~FontCache()
+{
+    close();
+}
+
+bool FontCache::open(const char* filepath, const FontCacheKey& key)
+{
+    close();
+
+    // Uploaded front to back once, and not touched again.
+    if (!m_file.open(filepath, FILE_ACCESS_SEQUENTIAL))
+        return false;
+
+    if (m_file.get_size() < sizeof(Header))
+    {
+        close();
+        return false;
+    }
+
+    const Header* header = get_header();
+    size_t expected_size = sizeof(Header) + header->num_of_glyphs * sizeof(stbtt_packedchar) +
+                           (size_t) key.bitmap_width * key.bitmap_height;
+
+    bool is_valid = header->magic == MAGIC && header->version == VERSION &&
+                    is_same_key(header->key, key) &&
+                    header->num_of_glyphs == (uint32_t) (key.last_codepoint - key.first_codepoint + 1) &&
+                    m_file.get_size() == expected_size;
+    if (!is_valid)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+const stbtt_packedchar* FontCache::get_glyphs()
+{
+    assert(m_file.is_open());
+    return reinterpret_cast<const stbtt_packedchar*>(get_header() + 1);
+}
+
+size_t FontCache::get_num_of_glyphs()
+{
+    assert(m_file.is_open());
+    return get_header()->num_of_glyphs;
+}
+
+const uint8_t* FontCache::get_pixels()
+{
+    assert(m_file.is_open());
+    return reinterpret_cast<const uint8_t*>(get_glyphs() + get_num_of_glyphs());
+}
+
+bool FontCache::save(const char* filepath, const FontCacheKey& key, const stbtt_packedchar* glyphs, size_t num_of_glyphs,
+                     const uint8_t* pixels)
+{
+    FileReplacement replacement;
+    if (!replacement.open(filepath))
+        return false;
+
+    Header header        = {};
+    header.magic         = MAGIC;
+    header.version       = VERSION;
+    header.key           = key;
+    header.num_of_glyphs = (uint32_t) num_of_glyphs;
+
+    FILE* file         = replacement.get_file();
+    size_t pixels_size = (size_t) key.bitmap_width * key.bitmap_height;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(glyphs, sizeof(stbtt_packedchar), num_of_glyphs, file);
+    fwrite(pixels, 1, pixels_size, file);
+    return replacement.commit();
+}
+
+uint64_t FontCache::hash_font_file(File& font_file)
+{
+    assert(font_file.is_open());
+
+    size_t size   = font_file.get_size();
+    uint64_t hash = hash_bytes(&size, sizeof(size));
+    return hash_bytes(font_file.get_data(), size, hash);
+}
+
+// Field by field, the padding isn't guaranteed to match.
+bool FontCache::is_same_key(const FontCacheKey& a, const FontCacheKey& b)
+{
+    return a.font_file_hash == b.font_file_hash && a.font_type == b.font_type && a.font_size == b.font_size &&
+           a.first_codepoint == b.first_codepoint && a.last_codepoint == b.last_codepoint &&
+           a.bitmap_width == b.bitmap_width && a.bitmap_height == b.bitmap_height;
+}
+
+void FontCache::close()
+{
+    m_file.close();
+}
+
+const FontCache::Header* FontCache::get_header()
+{
+    return static_cast<const Header*>(m_file.get_data());
+}
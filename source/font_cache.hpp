@@ -0,0 +1,62 @@
+#pragma once
+
+#include "utils.hpp"
+
+// Everything a baked font depends on. A cache is only used if all of it matches.
+struct FontCacheKey
+{
+    uint64_t font_file_hash;
+    int font_type;
+    float font_size;
+    int first_codepoint;
+    int last_codepoint;
+    int bitmap_width;
+    int bitmap_height;
+};
+
+// A font rasterized once and saved to disk: the packed glyph metrics followed by the
+// glyph bitmap, one byte per pixel. Later launches memory map the file instead of
+// rasterizing the TTF, and upload the pixels straight from the mapping.
+//
+// The file is native endian and not meant to be shared between machines, it's rebuilt
+// whenever it doesn't match.
+class FontCache
+{
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        FontCacheKey key;
+        uint32_t num_of_glyphs;
+        uint32_t reserved;
+    };
+
+    static const uint32_t MAGIC   = 0x46434746; // "FGCF"
+    static const uint32_t VERSION = 2;
+
+    File m_file;
+
+public:
+    FontCache();
+    ~FontCache();
+
+    // Maps the cache at `filepath`. Fails if it doesn't exist or was baked for a different
+    // key, in which case nothing stays mapped.
+    bool open(const char* filepath, const FontCacheKey& key);
+
+    // Only valid after a successful open, and until the cache is destroyed.
+    const stbtt_packedchar* get_glyphs();
+    size_t get_num_of_glyphs();
+    const uint8_t* get_pixels();
+
+    static bool save(const char* filepath, const FontCacheKey& key, const stbtt_packedchar* glyphs, size_t num_of_glyphs,
+                     const uint8_t* pixels);
+
+    // Hash of the whole font file, for the key.
+    static uint64_t hash_font_file(File& font_file);
+
+private:
+    static bool is_same_key(const FontCacheKey& a, const FontCacheKey& b);
+    void close();
+    const Header* get_header();
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "array.hpp"
+
+// Open addressing hash map with linear probing, for integer keys and plain old data
+// values. Removal shifts the entries that follow back into the hole, so there are no
+// tombstones and lookups never slow down over time.
+template<typename K, typename V>
+class HashMap
+{
+    struct Entry
+    {
+        K key;
+        V value;
+        bool occupied;
+    };
+
+    Array<Entry> m_entries;
+    size_t m_count;
+
+public:
+    HashMap(size_t initial_capacity = 16)
+    : m_count(0)
+    {
+        size_t capacity = 16;
+        while (capacity < initial_capacity)
+            capacity *= 2;
+
+        m_entries.resize(capacity);
+        m_entries.clear_and_zero();
+    }
+
+    V* find(K key)
+    {
+        Entry* entries = m_entries.get_underlying_buffer();
+        size_t mask    = m_entries.get_size() - 1;
+
+        for (size_t i = get_home(key); entries[i].occupied; i = (i + 1) & mask)
+        {
+            if (entries[i].key == key)
+                return &entries[i].value;
+        }
+
+        return nullptr;
+    }
+
+    // Overwrites the value if the key is already present.
+    V& insert(K key, V value)
+    {
+        // Keeps the load factor under 3/4 so probe sequences stay short.
+        if ((m_count + 1) * 4 > m_entries.get_size() * 3)
+            grow();
+
+        Entry* entries = m_entries.get_underlying_buffer();
+        size_t mask    = m_entries.get_size() - 1;
+
+        size_t i = get_home(key);
+        for (; entries[i].occupied; i = (i + 1) & mask)
+        {
+            if (entries[i].key == key)
+            {
+                entries[i].value = value;
+                return entries[i].value;
+            }
+        }
+
+        entries[i] = { key, value, true };
+        m_count++;
+        return entries[i].value;
+    }
+
+    bool remove(K key)
+    {
+        Entry* entries = m_entries.get_underlying_buffer();
+        size_t mask    = m_entries.get_size() - 1;
+
+        size_t hole = get_home(key);
+        while (entries[hole].occupied && entries[hole].key != key)
+            hole = (hole + 1) & mask;
+
+        if (!entries[hole].occupied)
+            return false;
+
+        // Moves back every entry after the hole that would no longer be reachable from its
+        // home slot, until the end of the cluster.
+        for (size_t i = (hole + 1) & mask; entries[i].occupied; i = (i + 1) & mask)
+        {
+            size_t home = get_home(entries[i].key);
+            bool reachable = ((i - home) & mask) < ((i - hole) & mask);
+            if (!reachable)
+            {
+                entries[hole] = entries[i];
+                hole = i;
+            }
+        }
+
+        entries[hole].occupied = false;
+        m_count--;
+        return true;
+    }
+
+    void clear()
+    {
+        m_entries.clear_and_zero();
+        m_count = 0;
+    }
+
+    size_t get_count()
+    {
+        return m_count;
+    }
+
+    /* ------------------------------------- Iteration ------------------------------------ */
+
+    // Entries are visited in slot order. `function` is called with the key and a reference
+    // to the value, and must not insert or remove entries.
+    template<typename F>
+    void for_each(F function)
+    {
+        for (Entry& entry : m_entries)
+        {
+            if (entry.occupied)
+                function(entry.key, entry.value);
+        }
+    }
+
+private:
+    size_t get_home(K key)
+    {
+        return hash_u64((uint64_t) key) & (m_entries.get_size() - 1);
+    }
+
+    void grow()
+    {
+        Array<Entry> old_entries = std::move(m_entries);
+
+        m_entries.resize(old_entries.get_size() * 2);
+        m_count = 0;
+
+        for (Entry& entry : old_entries)
+        {
+            if (entry.occupied)
+                insert(entry.key, entry.value);
+        }
+    }
+};
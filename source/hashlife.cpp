@@ -0,0 +1,707 @@
+#include "hashlife.hpp"
+
+HashLife::HashLife(size_t memory_budget_in_bytes)
+: m_free_list(NODE_NONE)
+, m_num_of_free_nodes(0)
+, m_root(NODE_NONE)
+, m_generation(0)
+, m_step_log2(0)
+, m_num_of_collections(0)
+{
+    // Every node has one hash bucket worth of memory to go with it.
+    size_t bytes_per_node = sizeof(Node) + sizeof(uint32_t);
+    size_t node_capacity  = min<size_t>(memory_budget_in_bytes / bytes_per_node, UINT32_MAX);
+    assert_with_message(node_capacity >= 1024, "HashLife memory budget of %zu bytes is too small", memory_budget_in_bytes);
+
+    size_t bucket_capacity = 1;
+    while (bucket_capacity * 2 <= node_capacity)
+        bucket_capacity *= 2;
+
+    m_nodes.resize(node_capacity);
+    m_buckets.resize(bucket_capacity);
+    m_buckets.clear_and_zero();
+
+    Node* nodes = m_nodes.get_underlying_buffer();
+    nodes[NODE_NONE]  = { 0, 0, 0, 0, NODE_NONE, NODE_NONE, 0, LEVEL_FREE, 0 };
+    nodes[LEAF_DEAD]  = { 0, 0, 0, 0, NODE_NONE, NODE_NONE, 0, 0, 0 };
+    nodes[LEAF_ALIVE] = { 0, 0, 0, 0, NODE_NONE, NODE_NONE, 1, 0, 0 };
+
+    for (size_t i = node_capacity - 1; i > LEAF_ALIVE; i--)
+    {
+        nodes[i].level = LEVEL_FREE;
+        nodes[i].next  = m_free_list;
+        m_free_list    = i;
+        m_num_of_free_nodes++;
+    }
+
+    memset(m_empty_nodes, 0, sizeof(m_empty_nodes));
+    m_empty_nodes[0] = LEAF_DEAD;
+
+    int initial_level = 3;
+    m_root = get_empty(initial_level);
+}
+
+// Takes one jump per set bit. Jumps of other sizes can reuse the results of the nodes
+// small enough to advance the same number of generations either way, the rest are worked
+// out again, so a run steps best at a single power of two.
+void HashLife::step(uint64_t generations)
+{
+    for (int step_log2 = 0; step_log2 < 64; step_log2++)
+    {
+        if (generations & (1ull << step_log2))
+            step_power_of_two(step_log2);
+    }
+}
+
+// The old nodes are left for the next collection.
+void HashLife::clear()
+{
+    m_root       = get_empty(3);
+    m_generation = 0;
+}
+
+void HashLife::step_power_of_two(int step_log2)
+{
+    if (advance(step_log2))
+        return;
+
+    collect_garbage();
+    if (advance(step_log2))
+        return;
+
+    // The working set of a jump this big doesn't fit in the budget, so take two jumps half
+    // the size instead.
+    assert_with_message(step_log2 > 0, "HashLife memory budget is too small to advance a single generation");
+    step_power_of_two(step_log2 - 1);
+    step_power_of_two(step_log2 - 1);
+}
+
+bool HashLife::get_cell(int64_t x, int64_t y)
+{
+    int64_t half = 1ll << (get_level(m_root) - 1);
+    if (x < -half || x >= half || y < -half || y >= half)
+        return false;
+
+    return get_cell(m_root, x + half, y + half);
+}
+
+void HashLife::set_cell(int64_t x, int64_t y, bool alive)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        uint32_t root = m_root;
+        int64_t half  = 1ll << (get_level(root) - 1);
+        while (root && (x < -half || x >= half || y < -half || y >= half))
+        {
+            assert_with_message(get_level(root) < MAX_LEVEL, "Cell (%lld, %lld) is out of range", (long long) x, (long long) y);
+            root = expand(root);
+            half = 1ll << (get_level(root) - 1);
+        }
+
+        if (root)
+            root = set_cell(root, x + half, y + half, alive);
+
+        if (root)
+        {
+            m_root = root;
+            return;
+        }
+
+        collect_garbage();
+    }
+
+    assert_with_message(false, "HashLife memory budget exhausted while setting a cell");
+}
+
+uint64_t HashLife::get_population()
+{
+    return m_nodes[m_root].population;
+}
+
+uint64_t HashLife::get_generation()
+{
+    return m_generation;
+}
+
+void HashLife::set_generation(uint64_t generation)
+{
+    m_generation = generation;
+}
+
+void HashLife::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1)
+{
+    int64_t half = 1ll << (get_level(m_root) - 1);
+    x0 = -half;
+    y0 = -half;
+    x1 = half;
+    y1 = half;
+}
+
+void HashLife::capture(LifeFrame& frame)
+{
+    frame.set_stats(m_generation, get_population());
+
+    int64_t half = 1ll << (get_level(m_root) - 1);
+    capture(m_root, -half, -half, frame);
+}
+
+void HashLife::collect_garbage()
+{
+    Node* nodes          = m_nodes.get_underlying_buffer();
+    size_t node_capacity = m_nodes.get_size();
+
+    for (size_t i = 0; i < node_capacity; i++)
+        nodes[i].marked = 0;
+
+    mark(m_root);
+    for (int level = 0; level <= MAX_LEVEL; level++)
+        mark(m_empty_nodes[level]);
+
+    // Memoized results may point at nodes that are about to be freed.
+    for (size_t i = LEAF_ALIVE + 1; i < node_capacity; i++)
+    {
+        Node& node = nodes[i];
+        if (node.marked && node.result > LEAF_ALIVE && !nodes[node.result].marked)
+            node.result = NODE_NONE;
+    }
+
+    m_buckets.clear_and_zero();
+    uint32_t* buckets    = m_buckets.get_underlying_buffer();
+    uint32_t bucket_mask = m_buckets.get_size() - 1;
+
+    m_free_list         = NODE_NONE;
+    m_num_of_free_nodes = 0;
+
+    for (size_t i = node_capacity - 1; i > LEAF_ALIVE; i--)
+    {
+        Node& node = nodes[i];
+        if (node.level != LEVEL_FREE && node.marked)
+        {
+            uint32_t bucket = hash_children(node.nw, node.ne, node.sw, node.se) & bucket_mask;
+            node.next       = buckets[bucket];
+            buckets[bucket] = i;
+        }
+        else
+        {
+            node.level  = LEVEL_FREE;
+            node.result = NODE_NONE;
+            node.next   = m_free_list;
+            m_free_list = i;
+            m_num_of_free_nodes++;
+        }
+    }
+
+    m_num_of_collections++;
+}
+
+bool HashLife::set_macrocell(Macrocell& macrocell)
+{
+    // Nothing of the old universe is needed, so the whole pool is free to build in.
+    m_root = get_empty(3);
+    collect_garbage();
+
+    // Children come before their parents in the macrocell, so one pass in index order
+    // converts them all.
+    size_t num_of_nodes = macrocell.get_num_of_nodes();
+    Array<uint32_t> converted(num_of_nodes);
+    converted[Macrocell::NODE_EMPTY] = NODE_NONE;
+
+    for (size_t i = 1; i < num_of_nodes; i++)
+    {
+        MacrocellNode& node = macrocell.get_node(i);
+        uint32_t result     = NODE_NONE;
+        if (node.level == Macrocell::LEAF_LEVEL)
+        {
+            result = join_leaf(node.bits, Macrocell::LEAF_LEVEL, 0, 0);
+        }
+        else
+        {
+            uint32_t empty = get_empty(node.level - 1);
+            uint32_t nw    = node.nw ? converted[node.nw] : empty;
+            uint32_t ne    = node.ne ? converted[node.ne] : empty;
+            uint32_t sw    = node.sw ? converted[node.sw] : empty;
+            uint32_t se    = node.se ? converted[node.se] : empty;
+            result         = join(nw, ne, sw, se);
+        }
+
+        // Half built nodes are unreachable, the next collection frees them.
+        if (!result)
+        {
+            m_root = get_empty(3);
+            return false;
+        }
+
+        converted[i] = result;
+    }
+
+    uint32_t root = macrocell.get_root();
+    m_root        = root ? converted[root] : get_empty(macrocell.get_root_level());
+    m_generation  = macrocell.get_generation();
+    return true;
+}
+
+void HashLife::get_macrocell(Macrocell& macrocell)
+{
+    macrocell.clear();
+
+    HashMap<uint32_t, uint32_t> converted;
+    uint32_t root = get_macrocell(macrocell, m_root, converted);
+    macrocell.set_root(root, get_level(m_root));
+    macrocell.set_generation(m_generation);
+}
+
+size_t HashLife::get_num_of_nodes()
+{
+    return m_nodes.get_size() - m_num_of_free_nodes;
+}
+
+size_t HashLife::get_node_capacity()
+{
+    return m_nodes.get_size();
+}
+
+size_t HashLife::get_num_of_collections()
+{
+    return m_num_of_collections;
+}
+
+// Returns false if the node pool ran out, in which case nothing has changed.
+bool HashLife::advance(int step_log2)
+{
+    m_step_log2 = step_log2;
+
+    // Shrinks the root back down if the pattern has died down or been jumped with a big
+    // step before.
+    uint32_t root = m_root;
+    while (get_level(root) > max(3, step_log2 + 3) && is_padded(root) && is_padded(centre(root)))
+        root = centre(root);
+
+    // The successor is the centre half of the node, so the pattern has to sit in the centre
+    // quarter with enough margin that it can't escape at the speed of light.
+    while (root && (get_level(root) < step_log2 + 2 || !is_padded(root)))
+        root = expand(root);
+
+    if (root)
+        root = expand(root);
+
+    assert_with_message(!root || get_level(root) <= MAX_LEVEL, "HashLife universe grew beyond 2^%d cells", MAX_LEVEL);
+
+    uint32_t result = root ? successor(root) : NODE_NONE;
+    if (!result)
+        return false;
+
+    m_root = result;
+    m_generation += 1ull << step_log2;
+    return true;
+}
+
+uint32_t HashLife::join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    if (!nw || !ne || !sw || !se)
+        return NODE_NONE;
+
+    Node* nodes       = m_nodes.get_underlying_buffer();
+    uint32_t* buckets = m_buckets.get_underlying_buffer();
+    uint32_t bucket   = hash_children(nw, ne, sw, se) & (m_buckets.get_size() - 1);
+
+    for (uint32_t i = buckets[bucket]; i != NODE_NONE; i = nodes[i].next)
+    {
+        Node& node = nodes[i];
+        if (node.nw == nw && node.ne == ne && node.sw == sw && node.se == se)
+            return i;
+    }
+
+    uint32_t index = allocate_node();
+    if (!index)
+        return NODE_NONE;
+
+    Node& node      = nodes[index];
+    node.nw         = nw;
+    node.ne         = ne;
+    node.sw         = sw;
+    node.se         = se;
+    node.result     = NODE_NONE;
+    node.population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+    node.level      = nodes[nw].level + 1;
+    node.marked     = 0;
+    node.next       = buckets[bucket];
+    buckets[bucket] = index;
+
+    return index;
+}
+
+uint32_t HashLife::get_empty(int level)
+{
+    assert(level >= 0 && level <= MAX_LEVEL);
+
+    if (!m_empty_nodes[level])
+    {
+        uint32_t empty = get_empty(level - 1);
+        m_empty_nodes[level] = join(empty, empty, empty, empty);
+    }
+
+    return m_empty_nodes[level];
+}
+
+// Wraps the node in an empty node twice its size, keeping it centred.
+uint32_t HashLife::expand(uint32_t node)
+{
+    int level      = get_level(node);
+    uint32_t empty = get_empty(level - 1);
+    Node n         = m_nodes[node];
+
+    uint32_t nw = join(empty, empty, empty, n.nw);
+    uint32_t ne = join(empty, empty, n.ne, empty);
+    uint32_t sw = join(empty, n.sw, empty, empty);
+    uint32_t se = join(n.se, empty, empty, empty);
+
+    return join(nw, ne, sw, se);
+}
+
+uint32_t HashLife::centre(uint32_t node)
+{
+    Node n = m_nodes[node];
+    return join(m_nodes[n.nw].se, m_nodes[n.ne].sw, m_nodes[n.sw].ne, m_nodes[n.se].nw);
+}
+
+uint32_t HashLife::successor(uint32_t node)
+{
+    // Lets callers pass the result of a join that ran out of nodes straight through.
+    if (!node)
+        return NODE_NONE;
+
+    Node n    = m_nodes[node];
+    int level = n.level;
+    assert(level >= 2);
+
+    if (n.population == 0)
+        return get_empty(level - 1);
+
+    // A node of level k advances min(m_step_log2, k - 2) generations, so a result is only
+    // out of date when it was worked out for a different number of them.
+    int result_step_log2 = min(m_step_log2, level - 2);
+    if (n.result && n.result_step_log2 == result_step_log2)
+        return n.result;
+
+    uint32_t result = NODE_NONE;
+    if (level == 2)
+    {
+        result = successor_level_2(node);
+    }
+    else
+    {
+        Node a = m_nodes[n.nw];
+        Node b = m_nodes[n.ne];
+        Node c = m_nodes[n.sw];
+        Node d = m_nodes[n.se];
+
+        // The nine overlapping sub squares of half the size.
+        uint32_t n00 = n.nw;
+        uint32_t n01 = join(a.ne, b.nw, a.se, b.sw);
+        uint32_t n02 = n.ne;
+        uint32_t n10 = join(a.sw, a.se, c.nw, c.ne);
+        uint32_t n11 = join(a.se, b.sw, c.ne, d.nw);
+        uint32_t n12 = join(b.sw, b.se, d.nw, d.ne);
+        uint32_t n20 = n.sw;
+        uint32_t n21 = join(c.ne, d.nw, c.se, d.sw);
+        uint32_t n22 = n.se;
+        if (!n01 || !n10 || !n11 || !n12 || !n21)
+            return NODE_NONE;
+
+        uint32_t r00 = successor(n00);
+        uint32_t r01 = successor(n01);
+        uint32_t r02 = successor(n02);
+        uint32_t r10 = successor(n10);
+        uint32_t r11 = successor(n11);
+        uint32_t r12 = successor(n12);
+        uint32_t r20 = successor(n20);
+        uint32_t r21 = successor(n21);
+        uint32_t r22 = successor(n22);
+        if (!r00 || !r01 || !r02 || !r10 || !r11 || !r12 || !r20 || !r21 || !r22)
+            return NODE_NONE;
+
+        if (m_step_log2 >= level - 2)
+        {
+            // Full speed, the second half of the generations comes from another round of
+            // successors on the four quadrants.
+            uint32_t q_nw = successor(join(r00, r01, r10, r11));
+            uint32_t q_ne = successor(join(r01, r02, r11, r12));
+            uint32_t q_sw = successor(join(r10, r11, r20, r21));
+            uint32_t q_se = successor(join(r11, r12, r21, r22));
+            if (!q_nw || !q_ne || !q_sw || !q_se)
+                return NODE_NONE;
+
+            result = join(q_nw, q_ne, q_sw, q_se);
+        }
+        else
+        {
+            // Slowed down, the nine successors already advanced the full step so only
+            // their centres are stitched together.
+            Node s00 = m_nodes[r00], s01 = m_nodes[r01], s02 = m_nodes[r02];
+            Node s10 = m_nodes[r10], s11 = m_nodes[r11], s12 = m_nodes[r12];
+            Node s20 = m_nodes[r20], s21 = m_nodes[r21], s22 = m_nodes[r22];
+
+            uint32_t q_nw = join(s00.se, s01.sw, s10.ne, s11.nw);
+            uint32_t q_ne = join(s01.se, s02.sw, s11.ne, s12.nw);
+            uint32_t q_sw = join(s10.se, s11.sw, s20.ne, s21.nw);
+            uint32_t q_se = join(s11.se, s12.sw, s21.ne, s22.nw);
+
+            result = join(q_nw, q_ne, q_sw, q_se);
+        }
+    }
+
+    if (result)
+    {
+        m_nodes[node].result           = result;
+        m_nodes[node].result_step_log2 = result_step_log2;
+    }
+
+    return result;
+}
+
+// Brute forces the centre 2x2 cells of a 4x4 node one generation ahead.
+uint32_t HashLife::successor_level_2(uint32_t node)
+{
+    Node n = m_nodes[node];
+    uint32_t quadrants[4] = { n.nw, n.ne, n.sw, n.se };
+
+    // Bit (y * 4 + x) is the cell at (x, y).
+    uint32_t cells = 0;
+    for (int q = 0; q < 4; q++)
+    {
+        Node quadrant = m_nodes[quadrants[q]];
+        uint32_t leaves[4] = { quadrant.nw, quadrant.ne, quadrant.sw, quadrant.se };
+
+        for (int l = 0; l < 4; l++)
+        {
+            int x = (q & 1) * 2 + (l & 1);
+            int y = (q >> 1) * 2 + (l >> 1);
+            if (leaves[l] == LEAF_ALIVE)
+                cells |= 1u << (y * 4 + x);
+        }
+    }
+
+    uint32_t next[4];
+    for (int i = 0; i < 4; i++)
+    {
+        int x = 1 + (i & 1);
+        int y = 1 + (i >> 1);
+
+        int neighbours = 0;
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (dx || dy)
+                    neighbours += (cells >> ((y + dy) * 4 + (x + dx))) & 1;
+            }
+        }
+
+        bool alive = (cells >> (y * 4 + x)) & 1;
+        next[i]    = (neighbours == 3 || (alive && neighbours == 2)) ? LEAF_ALIVE : LEAF_DEAD;
+    }
+
+    return join(next[0], next[1], next[2], next[3]);
+}
+
+// True if every live cell is inside the centre half of the node.
+bool HashLife::is_padded(uint32_t node)
+{
+    if (!node || get_level(node) < 3)
+        return false;
+
+    Node n = m_nodes[node];
+    Node a = m_nodes[n.nw];
+    Node b = m_nodes[n.ne];
+    Node c = m_nodes[n.sw];
+    Node d = m_nodes[n.se];
+
+    uint64_t border_population = m_nodes[a.nw].population + m_nodes[a.ne].population + m_nodes[a.sw].population
+                               + m_nodes[b.nw].population + m_nodes[b.ne].population + m_nodes[b.se].population
+                               + m_nodes[c.nw].population + m_nodes[c.sw].population + m_nodes[c.se].population
+                               + m_nodes[d.ne].population + m_nodes[d.sw].population + m_nodes[d.se].population;
+
+    return border_population == 0;
+}
+
+// Coordinates are relative to the top left corner of the node.
+uint32_t HashLife::set_cell(uint32_t node, int64_t x, int64_t y, bool alive)
+{
+    int level = get_level(node);
+    if (level == 0)
+        return alive ? LEAF_ALIVE : LEAF_DEAD;
+
+    Node n       = m_nodes[node];
+    int64_t half = 1ll << (level - 1);
+
+    if (y < half)
+    {
+        if (x < half) n.nw = set_cell(n.nw, x,        y, alive);
+        else          n.ne = set_cell(n.ne, x - half, y, alive);
+    }
+    else
+    {
+        if (x < half) n.sw = set_cell(n.sw, x,        y - half, alive);
+        else          n.se = set_cell(n.se, x - half, y - half, alive);
+    }
+
+    return join(n.nw, n.ne, n.sw, n.se);
+}
+
+bool HashLife::get_cell(uint32_t node, int64_t x, int64_t y)
+{
+    while (get_level(node) > 0)
+    {
+        Node n = m_nodes[node];
+        if (n.population == 0)
+            return false;
+
+        int64_t half = 1ll << (n.level - 1);
+        if (y < half)
+        {
+            node = x < half ? n.nw : n.ne;
+        }
+        else
+        {
+            node = x < half ? n.sw : n.se;
+            y -= half;
+        }
+
+        if (x >= half)
+            x -= half;
+    }
+
+    return node == LEAF_ALIVE;
+}
+
+// Descends until the nodes are the size of one frame block, so a zoomed out frame only
+// visits as many nodes as it has blocks.
+void HashLife::capture(uint32_t node, int64_t x, int64_t y, LifeFrame& frame)
+{
+    Node n = m_nodes[node];
+    if (n.population == 0)
+        return;
+
+    int frame_level  = frame.get_level();
+    int64_t frame_x0 = frame.get_x();
+    int64_t frame_y0 = frame.get_y();
+    int64_t frame_x1 = frame_x0 + ((int64_t) frame.get_width()  << frame_level);
+    int64_t frame_y1 = frame_y0 + ((int64_t) frame.get_height() << frame_level);
+
+    int64_t size = 1ll << n.level;
+    if (x >= frame_x1 || y >= frame_y1 || x + size <= frame_x0 || y + size <= frame_y0)
+        return;
+
+    if (n.level <= frame_level)
+    {
+        frame.set_block((x - frame_x0) >> frame_level, (y - frame_y0) >> frame_level);
+        return;
+    }
+
+    int64_t half = size / 2;
+    capture(n.nw, x,        y,        frame);
+    capture(n.ne, x + half, y,        frame);
+    capture(n.sw, x,        y + half, frame);
+    capture(n.se, x + half, y + half, frame);
+}
+
+// The node of `level` for the square of a macrocell leaf at (x, y).
+uint32_t HashLife::join_leaf(uint64_t bits, int level, int x, int y)
+{
+    if (level == 0)
+        return (bits >> (y * 8 + x)) & 1 ? LEAF_ALIVE : LEAF_DEAD;
+
+    int half = 1 << (level - 1);
+    return join(join_leaf(bits, level - 1, x,        y),
+                join_leaf(bits, level - 1, x + half, y),
+                join_leaf(bits, level - 1, x,        y + half),
+                join_leaf(bits, level - 1, x + half, y + half));
+}
+
+// Cells of a node of at most level 3 as macrocell leaf bits, with its top left at (x, y).
+uint64_t HashLife::get_leaf_bits(uint32_t node, int level, int x, int y)
+{
+    if (level == 0)
+        return node == LEAF_ALIVE ? 1ull << (y * 8 + x) : 0;
+
+    Node n   = m_nodes[node];
+    int half = 1 << (level - 1);
+    return get_leaf_bits(n.nw, level - 1, x,        y)
+         | get_leaf_bits(n.ne, level - 1, x + half, y)
+         | get_leaf_bits(n.sw, level - 1, x,        y + half)
+         | get_leaf_bits(n.se, level - 1, x + half, y + half);
+}
+
+uint32_t HashLife::get_macrocell(Macrocell& macrocell, uint32_t node, HashMap<uint32_t, uint32_t>& converted)
+{
+    // Empty nodes are hash consed like the rest, so there's one per level.
+    Node n = m_nodes[node];
+    if (node == m_empty_nodes[n.level])
+        return Macrocell::NODE_EMPTY;
+
+    // Shared nodes are converted once, which is what keeps this as fast as the tree is
+    // small rather than as the universe is large.
+    uint32_t* found = converted.find(node);
+    if (found)
+        return *found;
+
+    uint32_t result = Macrocell::NODE_EMPTY;
+    if (n.level == Macrocell::LEAF_LEVEL)
+    {
+        result = macrocell.add_leaf(get_leaf_bits(node, n.level, 0, 0));
+    }
+    else
+    {
+        uint32_t nw = get_macrocell(macrocell, n.nw, converted);
+        uint32_t ne = get_macrocell(macrocell, n.ne, converted);
+        uint32_t sw = get_macrocell(macrocell, n.sw, converted);
+        uint32_t se = get_macrocell(macrocell, n.se, converted);
+        result      = macrocell.add_node(n.level, nw, ne, sw, se);
+    }
+
+    converted.insert(node, result);
+    return result;
+}
+
+void HashLife::mark(uint32_t node)
+{
+    if (node <= LEAF_ALIVE)
+        return;
+
+    Node& n = m_nodes[node];
+    if (n.marked)
+        return;
+
+    n.marked = 1;
+    mark(n.nw);
+    mark(n.ne);
+    mark(n.sw);
+    mark(n.se);
+}
+
+uint32_t HashLife::allocate_node()
+{
+    uint32_t index = m_free_list;
+    if (index)
+    {
+        m_free_list = m_nodes[index].next;
+        m_num_of_free_nodes--;
+    }
+
+    return index;
+}
+
+uint32_t HashLife::hash_children(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    uint64_t hash = nw;
+    hash = hash * 0x9E3779B97F4A7C15ull + ne;
+    hash = hash * 0x9E3779B97F4A7C15ull + sw;
+    hash = hash * 0x9E3779B97F4A7C15ull + se;
+    hash ^= hash >> 29;
+    return (uint32_t) hash;
+}
+
+int HashLife::get_level(uint32_t node)
+{
+    return m_nodes[node].level;
+}
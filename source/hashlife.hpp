@@ -0,0 +1,100 @@
+#pragma once
+
+#include "macrocell.hpp"
+#include "hash_map.hpp"
+
+// Gosper's HashLife. The universe is a quadtree whose nodes are hash consed, so identical
+// regions anywhere in space or time share one node, and each node memoizes its successor.
+// That makes it possible to jump patterns with regular structure billions of generations
+// ahead in a handful of steps.
+//
+// A node of level k is a square of (1 << k) cells. Its successor is the centre square of
+// level k-1, (1 << m_step_log2) generations later.
+class HashLife : public LifeEngine
+{
+    static const uint32_t NODE_NONE  = 0;
+    static const uint32_t LEAF_DEAD  = 1;
+    static const uint32_t LEAF_ALIVE = 2;
+    static const int MAX_LEVEL       = 62;
+
+    // Marks a slot in the node pool as free.
+    static const uint8_t LEVEL_FREE = 0xFF;
+
+    struct Node
+    {
+        uint32_t nw, ne, sw, se;
+        uint32_t result;
+        uint32_t next;
+        uint64_t population;
+        uint8_t level;
+        uint8_t marked;
+        // The step the result was worked out for.
+        uint8_t result_step_log2;
+    };
+
+    // The pool is sized from the memory budget up front so node indices stay valid forever.
+    Array<Node> m_nodes;
+    Array<uint32_t> m_buckets;
+    uint32_t m_free_list;
+    uint32_t m_num_of_free_nodes;
+
+    uint32_t m_empty_nodes[MAX_LEVEL + 1];
+    uint32_t m_root;
+    uint64_t m_generation;
+    int m_step_log2;
+
+    size_t m_num_of_collections;
+
+public:
+    HashLife(size_t memory_budget_in_bytes);
+
+    void step(uint64_t generations) override;
+    void clear() override;
+    bool get_cell(int64_t x, int64_t y) override;
+    void set_cell(int64_t x, int64_t y, bool alive) override;
+    uint64_t get_population() override;
+    uint64_t get_generation() override;
+    void set_generation(uint64_t generation) override;
+    void get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) override;
+    void capture(LifeFrame& frame) override;
+
+    // Frees every node that isn't reachable from the root.
+    void collect_garbage();
+
+    // Replaces the universe with the macrocell's, node for node, so it takes about as much
+    // memory as the macrocell does however large the pattern is. Returns false if it
+    // doesn't fit in the budget, which leaves the universe empty.
+    bool set_macrocell(Macrocell& macrocell);
+
+    // The other way around, replacing whatever the macrocell held.
+    void get_macrocell(Macrocell& macrocell);
+
+    size_t get_num_of_nodes();
+    size_t get_node_capacity();
+    size_t get_num_of_collections();
+
+private:
+    void step_power_of_two(int step_log2);
+    bool advance(int step_log2);
+
+    uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+    uint32_t get_empty(int level);
+    uint32_t expand(uint32_t node);
+    uint32_t centre(uint32_t node);
+    uint32_t successor(uint32_t node);
+    uint32_t successor_level_2(uint32_t node);
+    bool is_padded(uint32_t node);
+
+    uint32_t set_cell(uint32_t node, int64_t x, int64_t y, bool alive);
+    bool get_cell(uint32_t node, int64_t x, int64_t y);
+    void capture(uint32_t node, int64_t x, int64_t y, LifeFrame& frame);
+
+    uint32_t join_leaf(uint64_t bits, int level, int x, int y);
+    uint64_t get_leaf_bits(uint32_t node, int level, int x, int y);
+    uint32_t get_macrocell(Macrocell& macrocell, uint32_t node, HashMap<uint32_t, uint32_t>& converted);
+
+    void mark(uint32_t node);
+    uint32_t allocate_node();
+    uint32_t hash_children(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+    int get_level(uint32_t node);
+};
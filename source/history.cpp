@@ -0,0 +1,403 @@
+#include "history.hpp"
+
+// Stands in for tiles the other board doesn't have.
+static const uint64_t EMPTY_ROWS[LIFE_TILE_SIZE] = {};
+
+static uint64_t get_tile_key(int32_t x, int32_t y)
+{
+    return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y;
+}
+
+/* ----------------------------------- HistoryBoard ----------------------------------- */
+
+HistoryBoard::HistoryBoard()
+: m_num_of_live_rows(0)
+{}
+
+void HistoryBoard::clear()
+{
+    m_lookup.clear();
+    m_tiles.clear();
+    m_num_of_live_rows = 0;
+}
+
+void HistoryBoard::write_to(LifeEngine& engine)
+{
+    for (size_t i = 0; i < m_tiles.get_used(); i++)
+    {
+        HistoryBoardTile& tile = m_tiles[i];
+        for (int row = 0; row < LIFE_TILE_SIZE; row++)
+        {
+            if (tile.rows[row])
+                engine.set_row((int64_t) tile.x * LIFE_TILE_SIZE, (int64_t) tile.y * LIFE_TILE_SIZE + row, &tile.rows[row], 1);
+        }
+    }
+}
+
+HistoryBoardTile* HistoryBoard::find_tile(int32_t x, int32_t y)
+{
+    uint32_t* index = m_lookup.find(get_tile_key(x, y));
+    return index ? &m_tiles[*index] : nullptr;
+}
+
+HistoryBoardTile& HistoryBoard::add_tile(int32_t x, int32_t y)
+{
+    HistoryBoardTile* tile = find_tile(x, y);
+    if (tile)
+        return *tile;
+
+    uint32_t index = m_tiles.get_used();
+    m_tiles.push({});
+    m_tiles[index].x = x;
+    m_tiles[index].y = y;
+    m_lookup.insert(get_tile_key(x, y), index);
+    return m_tiles[index];
+}
+
+size_t HistoryBoard::xor_rows(HistoryBoardTile& tile, uint64_t row_mask, const uint64_t* words)
+{
+    size_t num_of_words = 0;
+    while (row_mask)
+    {
+        int row = __builtin_ctzll(row_mask);
+        row_mask &= row_mask - 1;
+
+        uint64_t& row_bits = tile.rows[row];
+        m_num_of_live_rows -= row_bits != 0;
+        row_bits ^= words[num_of_words++];
+        m_num_of_live_rows += row_bits != 0;
+    }
+
+    return num_of_words;
+}
+
+HistoryBoardTile& HistoryBoard::get_tile(size_t index)
+{
+    return m_tiles[index];
+}
+
+size_t HistoryBoard::get_num_of_tiles()
+{
+    return m_tiles.get_used();
+}
+
+size_t HistoryBoard::get_num_of_live_rows()
+{
+    return m_num_of_live_rows;
+}
+
+/* ------------------------------------ LifeHistory ----------------------------------- */
+
+static void ignore_tile(void* data, int64_t tile_x, int64_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride)
+{
+}
+
+LifeHistory::LifeHistory(size_t memory_budget_in_bytes, Allocator& allocator)
+: m_allocator(&allocator)
+, m_memory_budget(memory_budget_in_bytes)
+, m_memory_used(0)
+, m_first(0)
+, m_num_of_entries(0)
+, m_current(0)
+, m_num_of_words(0)
+, m_oldest_generation(0)
+, m_newest_generation(0)
+, m_published_memory_used(0)
+{}
+
+LifeHistory::~LifeHistory()
+{
+    clear();
+}
+
+bool LifeHistory::record(LifeEngine& engine)
+{
+    uint64_t generation = engine.get_generation();
+    if (m_num_of_entries > 0)
+    {
+        while (m_num_of_entries > m_current + 1)
+            forget_newest();
+
+        // Only if the engine was changed some other way than stepping, nothing recorded
+        // leads up to this generation any more.
+        if (generation <= get_entry(m_current).generation)
+            clear();
+    }
+
+    m_num_of_words = 0;
+    m_tiles.clear();
+
+    // Starting over, the first keyframe is the whole engine and the changes it kept track
+    // of until now don't matter.
+    if (m_num_of_entries == 0)
+    {
+        if (!engine.visit_changed_tiles(ignore_tile, nullptr))
+            return false;
+
+        m_board.clear();
+        engine.visit_tiles(record_tile, this);
+    }
+    else if (!engine.visit_changed_tiles(record_tile, this))
+    {
+        return false;
+    }
+
+    bool is_keyframe = m_num_of_entries == 0;
+    if (!is_keyframe)
+    {
+        size_t keyframe           = find_keyframe(m_current);
+        size_t num_of_delta_words = m_num_of_words;
+        for (size_t i = keyframe + 1; i <= m_current; i++)
+            num_of_delta_words += get_entry(i).num_of_words;
+
+        if (num_of_delta_words > m_board.get_num_of_live_rows() || m_current + 1 - keyframe >= MAX_KEYFRAME_INTERVAL)
+        {
+            encode_keyframe();
+            is_keyframe = true;
+        }
+    }
+
+    push_entry(generation, is_keyframe);
+    m_current = m_num_of_entries - 1;
+
+    while (m_memory_used > m_memory_budget && find_keyframe(m_num_of_entries - 1) != 0)
+        forget_oldest_keyframe();
+
+    publish_stats();
+    return true;
+}
+
+bool LifeHistory::restore(LifeEngine& engine, uint64_t generation)
+{
+    if (m_num_of_entries == 0 || get_entry(0).generation > generation)
+        return false;
+
+    size_t index = m_num_of_entries - 1;
+    while (get_entry(index).generation > generation)
+        index--;
+
+    // The board is already decoded, so from anywhere after the same keyframe only the
+    // deltas in between are needed.
+    size_t keyframe = find_keyframe(index);
+    if (find_keyframe(m_current) == keyframe)
+    {
+        for (size_t i = m_current; i > index; i--)
+            apply(get_entry(i));
+        for (size_t i = m_current + 1; i <= index; i++)
+            apply(get_entry(i));
+    }
+    else
+    {
+        m_board.clear();
+        for (size_t i = keyframe; i <= index; i++)
+            apply(get_entry(i));
+    }
+
+    // The engine is the same as the board again, none of the changes it kept track of
+    // need recording.
+    engine.clear();
+    m_board.write_to(engine);
+    engine.set_generation(get_entry(index).generation);
+    engine.visit_changed_tiles(ignore_tile, nullptr);
+
+    m_current = index;
+    return true;
+}
+
+void LifeHistory::clear()
+{
+    while (m_num_of_entries > 0)
+        forget_newest();
+
+    m_first   = 0;
+    m_current = 0;
+    m_board.clear();
+    publish_stats();
+}
+
+uint64_t LifeHistory::get_oldest_generation()
+{
+    return __atomic_load_n(&m_oldest_generation, __ATOMIC_RELAXED);
+}
+
+uint64_t LifeHistory::get_newest_generation()
+{
+    return __atomic_load_n(&m_newest_generation, __ATOMIC_RELAXED);
+}
+
+size_t LifeHistory::get_memory_used()
+{
+    return __atomic_load_n(&m_published_memory_used, __ATOMIC_RELAXED);
+}
+
+LifeHistory::Entry& LifeHistory::get_entry(size_t index)
+{
+    assert(index < m_num_of_entries);
+    return m_entries[(m_first + index) % m_entries.get_size()];
+}
+
+size_t LifeHistory::find_keyframe(size_t index)
+{
+    while (!get_entry(index).is_keyframe)
+        index--;
+
+    return index;
+}
+
+// Keyframes are XORed onto a cleared board, which sets their rows.
+void LifeHistory::apply(Entry& entry)
+{
+    const uint64_t* words = entry.data;
+    const uint64_t* tiles = entry.data + entry.num_of_words;
+    for (size_t i = 0; i < entry.num_of_tiles; i++)
+    {
+        uint64_t key           = tiles[i * 2];
+        HistoryBoardTile& tile = m_board.add_tile((int32_t) (key >> 32), (int32_t) key);
+        words += m_board.xor_rows(tile, tiles[i * 2 + 1], words);
+    }
+}
+
+/* -------------------------------------- Encoding ------------------------------------ */
+
+// Encodes how a tile the engine changed differs from the board and brings the board up
+// to date with it.
+void LifeHistory::record_tile(void* data, int64_t tile_x, int64_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride)
+{
+    LifeHistory& history   = *static_cast<LifeHistory*>(data);
+    HistoryBoard& board    = history.m_board;
+    HistoryBoardTile* tile = board.find_tile((int32_t) tile_x, (int32_t) tile_y);
+    if (!tile)
+    {
+        // Dead tiles the board doesn't have yet have nothing to add.
+        uint64_t any = 0;
+        for (int row = 0; row < num_of_rows; row++)
+            any |= rows[row * stride];
+
+        if (!any)
+            return;
+
+        tile = &board.add_tile((int32_t) tile_x, (int32_t) tile_y);
+    }
+
+    size_t first_word   = history.m_num_of_words;
+    size_t num_of_tiles = history.m_tiles.get_used();
+    history.encode_rows(tile->x, tile->y, rows, num_of_rows, stride, tile->rows);
+
+    if (history.m_tiles.get_used() > num_of_tiles)
+        board.xor_rows(*tile, history.m_tiles.last(), history.m_words.get_underlying_buffer() + first_word);
+}
+
+// Replaces the delta being encoded with the whole board.
+void LifeHistory::encode_keyframe()
+{
+    m_num_of_words = 0;
+    m_tiles.clear();
+
+    for (size_t i = 0; i < m_board.get_num_of_tiles(); i++)
+    {
+        HistoryBoardTile& tile = m_board.get_tile(i);
+        encode_rows(tile.x, tile.y, tile.rows, LIFE_TILE_SIZE, 1, EMPTY_ROWS);
+    }
+}
+
+// Pushes the tile's rows, `stride` words apart, XORed with `other_rows`, leaving out the
+// ones that come to zero.
+void LifeHistory::encode_rows(int32_t tile_x, int32_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride,
+                              const uint64_t* other_rows)
+{
+    if (m_words.get_size() < m_num_of_words + LIFE_TILE_SIZE)
+        m_words.reserve(max(m_words.get_size() * 2, m_num_of_words + LIFE_TILE_SIZE));
+
+    // Every row is written and only kept if it isn't zero, rather than branching on each.
+    uint64_t* words          = m_words.get_underlying_buffer() + m_num_of_words;
+    size_t num_of_kept_words = 0;
+    uint64_t row_mask        = 0;
+    for (int row = 0; row < num_of_rows; row++)
+    {
+        uint64_t word = rows[row * stride] ^ other_rows[row];
+        words[num_of_kept_words] = word;
+        num_of_kept_words += word != 0;
+        row_mask |= (uint64_t) (word != 0) << row;
+    }
+    m_num_of_words += num_of_kept_words;
+
+    if (row_mask)
+    {
+        m_tiles.push(get_tile_key(tile_x, tile_y));
+        m_tiles.push(row_mask);
+    }
+}
+
+void LifeHistory::push_entry(uint64_t generation, bool is_keyframe)
+{
+    if (m_num_of_entries == m_entries.get_size())
+    {
+        // Unrolled into the new ring oldest first.
+        Array<Entry> entries(max<size_t>(m_entries.get_size() * 2, 64));
+        for (size_t i = 0; i < m_num_of_entries; i++)
+            entries[i] = get_entry(i);
+
+        m_entries = std::move(entries);
+        m_first   = 0;
+    }
+
+    Entry entry        = {};
+    entry.generation   = generation;
+    entry.num_of_words = m_num_of_words;
+    entry.num_of_tiles = m_tiles.get_used() / 2;
+    entry.is_keyframe  = is_keyframe;
+
+    // Still lifes have nothing to store at all.
+    size_t num_of_words_in_bytes = m_num_of_words * sizeof(uint64_t);
+    size_t num_of_bytes          = num_of_words_in_bytes + m_tiles.get_used_amount_in_bytes();
+    if (num_of_bytes)
+    {
+        entry.data = static_cast<uint64_t*>(m_allocator->allocate(num_of_bytes, alignof(uint64_t)));
+        memcpy(entry.data, m_words.get_underlying_buffer(), num_of_words_in_bytes);
+        memcpy(entry.data + entry.num_of_words, m_tiles.get_underlying_buffer(), m_tiles.get_used_amount_in_bytes());
+    }
+
+    m_num_of_entries++;
+    get_entry(m_num_of_entries - 1) = entry;
+    m_memory_used += num_of_bytes;
+}
+
+/* ------------------------------------- Forgetting ----------------------------------- */
+
+void LifeHistory::forget_newest()
+{
+    Entry& entry        = get_entry(m_num_of_entries - 1);
+    size_t num_of_bytes = (entry.num_of_words + entry.num_of_tiles * 2) * sizeof(uint64_t);
+    if (entry.data)
+        m_allocator->deallocate(entry.data, num_of_bytes);
+
+    m_memory_used -= num_of_bytes;
+    m_num_of_entries--;
+}
+
+// Its deltas go with it, there'd be nothing left to apply them to.
+void LifeHistory::forget_oldest_keyframe()
+{
+    do
+    {
+        Entry& entry        = get_entry(0);
+        size_t num_of_bytes = (entry.num_of_words + entry.num_of_tiles * 2) * sizeof(uint64_t);
+        if (entry.data)
+            m_allocator->deallocate(entry.data, num_of_bytes);
+
+        m_memory_used -= num_of_bytes;
+        m_first = (m_first + 1) % m_entries.get_size();
+        m_num_of_entries--;
+        m_current--;
+    }
+    while (m_num_of_entries > 0 && !get_entry(0).is_keyframe);
+}
+
+void LifeHistory::publish_stats()
+{
+    uint64_t oldest_generation = m_num_of_entries ? get_entry(0).generation : 0;
+    uint64_t newest_generation = m_num_of_entries ? get_entry(m_num_of_entries - 1).generation : 0;
+    __atomic_store_n(&m_oldest_generation, oldest_generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_newest_generation, newest_generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_published_memory_used, m_memory_used, __ATOMIC_RELAXED);
+}
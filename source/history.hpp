@@ -0,0 +1,141 @@
+#pragma once
+
+#include "life.hpp"
+#include "hash_map.hpp"
+
+// The cells of an engine copied out tile by tile, keyed by tile coordinate. Tiles can be
+// all dead, they're only dropped when the board is cleared.
+struct HistoryBoardTile
+{
+    int32_t x, y;
+    uint64_t rows[LIFE_TILE_SIZE];
+};
+
+class HistoryBoard
+{
+    HashMap<uint64_t, uint32_t> m_lookup;
+    Array<HistoryBoardTile> m_tiles;
+    size_t m_num_of_live_rows;
+
+public:
+    HistoryBoard();
+
+    void clear();
+
+    // Sets the board's live cells in an engine that's been cleared.
+    void write_to(LifeEngine& engine);
+
+    HistoryBoardTile* find_tile(int32_t x, int32_t y);
+    // Returns the tile at (x, y), adding an all dead one if there isn't one yet.
+    HistoryBoardTile& add_tile(int32_t x, int32_t y);
+
+    // XORs one word onto each row in `row_mask`, lowest row first. Returns how many words
+    // it took.
+    size_t xor_rows(HistoryBoardTile& tile, uint64_t row_mask, const uint64_t* words);
+
+    HistoryBoardTile& get_tile(size_t index);
+    size_t get_num_of_tiles();
+    // Rows with any live cells across all tiles.
+    size_t get_num_of_live_rows();
+};
+
+/* ------------------------------------ LifeHistory ----------------------------------- */
+
+// The generations an engine went through, recent ones first to go when it runs out of
+// memory, so they can be gone back to without stepping again from the start.
+//
+// Most of a board is the same from one generation to the next, so only every so often is
+// a whole board kept, a keyframe. The generations in between keep the rows that changed
+// since the one before, XORed with how they were. A keyframe is taken once the deltas
+// since the last one add up to as many words as it would take, so going back or forward
+// never decodes more than about two keyframes' worth: the nearest keyframe before plus the
+// deltas after it, or only the deltas in between when starting out from a generation after
+// the same keyframe, XOR undoes a delta just as well as it applies it.
+//
+// Both kinds are stored like a snapshot, the words of the rows that aren't zero followed
+// by a { x, y, row_mask } per tile. Recording only looks at the tiles the engine says
+// changed, so it needs an engine that keeps track of them.
+//
+// Only the thread stepping the engine records and restores, the getters can be called
+// from any thread.
+class LifeHistory
+{
+    // Keeps a still life from making one keyframe last forever.
+    static const size_t MAX_KEYFRAME_INTERVAL = 256;
+
+    struct Entry
+    {
+        uint64_t generation;
+        uint64_t* data;
+        size_t num_of_words;
+        size_t num_of_tiles;
+        bool is_keyframe;
+    };
+
+    Allocator* m_allocator;
+    size_t m_memory_budget;
+    size_t m_memory_used;
+
+    // A ring, oldest first. Always starts with a keyframe, whole runs of a keyframe and
+    // its deltas are forgotten at once.
+    Array<Entry> m_entries;
+    size_t m_first;
+    size_t m_num_of_entries;
+
+    // The engine was last recorded at or restored to this entry, which the board holds
+    // decoded. Recording brings it up to date with the engine's changed tiles.
+    size_t m_current;
+    HistoryBoard m_board;
+
+    // The entry being encoded. Words are written a tile at a time past the end of what's
+    // used, so they're counted apart from the array.
+    Array<uint64_t> m_words;
+    size_t m_num_of_words;
+    Array<uint64_t> m_tiles;
+
+    // Written by the thread recording.
+    uint64_t m_oldest_generation;
+    uint64_t m_newest_generation;
+    size_t m_published_memory_used;
+
+public:
+    // Keyframes and deltas are kept under `memory_budget_in_bytes`, apart from the newest
+    // keyframe and its deltas, which are always kept. The decoded board comes on top.
+    LifeHistory(size_t memory_budget_in_bytes, Allocator& allocator = get_heap_allocator());
+    ~LifeHistory();
+
+    LifeHistory(const LifeHistory& other) = delete;
+    LifeHistory& operator=(const LifeHistory& other) = delete;
+
+    // Adds the engine's current generation. Anything after the generation it was last
+    // restored to is forgotten first, the engine is taking another way from there. Returns
+    // false if the engine can't be recorded. Takes the changes the engine kept track of,
+    // nothing else may visit them in between.
+    bool record(LifeEngine& engine);
+
+    // Puts the engine back to the newest recorded generation that isn't after
+    // `generation`. Returns false if every recorded generation is after it.
+    bool restore(LifeEngine& engine, uint64_t generation);
+
+    void clear();
+
+    // Both zero when nothing is recorded.
+    uint64_t get_oldest_generation();
+    uint64_t get_newest_generation();
+    size_t get_memory_used();
+
+private:
+    Entry& get_entry(size_t index);
+    size_t find_keyframe(size_t index);
+    void apply(Entry& entry);
+
+    static void record_tile(void* data, int64_t tile_x, int64_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride);
+    void encode_keyframe();
+    void encode_rows(int32_t tile_x, int32_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride,
+                     const uint64_t* other_rows);
+    void push_entry(uint64_t generation, bool is_keyframe);
+
+    void forget_newest();
+    void forget_oldest_keyframe();
+    void publish_stats();
+};
@@ -0,0 +1,664 @@
+#include "life.hpp"
+
+// Checks the cells [x0, x1) of a packed row.
+static bool any_alive_in_span(const uint64_t* row, int64_t x0, int64_t x1)
+{
+    int64_t first_word = x0 / LIFE_CELLS_PER_WORD;
+    int64_t last_word  = (x1 - 1) / LIFE_CELLS_PER_WORD;
+
+    for (int64_t word_index = first_word; word_index <= last_word; word_index++)
+    {
+        uint64_t mask = ~0ull;
+        if (word_index == first_word)
+            mask &= ~0ull << (x0 % LIFE_CELLS_PER_WORD);
+        if (word_index == last_word)
+            mask &= ~0ull >> (LIFE_CELLS_PER_WORD - 1 - (x1 - 1) % LIFE_CELLS_PER_WORD);
+
+        if (row[word_index] & mask)
+            return true;
+    }
+
+    return false;
+}
+
+/* ---------------------------------- LifeDirtyTiles ---------------------------------- */
+
+LifeDirtyTiles::LifeDirtyTiles()
+: m_tiles_w(0)
+, m_tiles_h(0)
+, m_all_dirty(false)
+{}
+
+void LifeDirtyTiles::reset(int tiles_w, int tiles_h)
+{
+    m_tiles_w   = tiles_w;
+    m_tiles_h   = tiles_h;
+    m_all_dirty = false;
+
+    if (m_bits.get_size() < get_num_of_words())
+    {
+        m_bits.resize(get_num_of_words());
+        m_remaining_bits.resize(get_num_of_words());
+    }
+
+    m_bits.clear_and_zero();
+}
+
+void LifeDirtyTiles::mark(int tile_x, int tile_y)
+{
+    assert(tile_x >= 0 && tile_x < m_tiles_w && tile_y >= 0 && tile_y < m_tiles_h);
+
+    size_t bit_index = (size_t) tile_y * m_tiles_w + tile_x;
+    m_bits[bit_index / 64] |= 1ull << (bit_index % 64);
+}
+
+void LifeDirtyTiles::mark_all()
+{
+    m_all_dirty = true;
+}
+
+void LifeDirtyTiles::copy_from(LifeDirtyTiles& other)
+{
+    reset(other.m_tiles_w, other.m_tiles_h);
+    m_all_dirty = other.m_all_dirty;
+    memcpy(m_bits.get_underlying_buffer(), other.m_bits.get_underlying_buffer(), get_num_of_words() * sizeof(uint64_t));
+}
+
+void LifeDirtyTiles::merge(LifeDirtyTiles& other)
+{
+    if (m_tiles_w != other.m_tiles_w || m_tiles_h != other.m_tiles_h)
+    {
+        reset(other.m_tiles_w, other.m_tiles_h);
+        m_all_dirty = true;
+        return;
+    }
+
+    m_all_dirty |= other.m_all_dirty;
+    for (size_t i = 0; i < get_num_of_words(); i++)
+        m_bits[i] |= other.m_bits[i];
+}
+
+void LifeDirtyTiles::get_rects(Array<LifeTileRect>& rects)
+{
+    size_t max_num_of_rects = max((size_t) m_tiles_w * m_tiles_h, (size_t) 1);
+    if (rects.get_size() < max_num_of_rects)
+        rects.resize(max_num_of_rects);
+
+    rects.clear();
+
+    if (m_all_dirty)
+    {
+        if (m_tiles_w > 0 && m_tiles_h > 0)
+            rects.push({ 0, 0, m_tiles_w, m_tiles_h });
+
+        return;
+    }
+
+    // Greedy: takes the first remaining tile in raster order, grows it right as far as
+    // it can and then down while the whole span stays dirty. Not optimal, but it turns
+    // the usual blobs of activity into a handful of rectangles.
+    memcpy(m_remaining_bits.get_underlying_buffer(), m_bits.get_underlying_buffer(), get_num_of_words() * sizeof(uint64_t));
+    uint64_t* remaining = m_remaining_bits.get_underlying_buffer();
+
+    auto is_remaining = [&](int tile_x, int tile_y)
+    {
+        size_t bit_index = (size_t) tile_y * m_tiles_w + tile_x;
+        return (remaining[bit_index / 64] >> (bit_index % 64)) & 1;
+    };
+
+    for (size_t word_index = 0; word_index < get_num_of_words(); word_index++)
+    {
+        while (remaining[word_index])
+        {
+            size_t bit_index = word_index * 64 + __builtin_ctzll(remaining[word_index]);
+            int x0 = (int) (bit_index % m_tiles_w);
+            int y0 = (int) (bit_index / m_tiles_w);
+
+            int x1 = x0 + 1;
+            while (x1 < m_tiles_w && is_remaining(x1, y0))
+                x1++;
+
+            int y1 = y0 + 1;
+            for (; y1 < m_tiles_h; y1++)
+            {
+                bool is_span_dirty = true;
+                for (int x = x0; x < x1 && is_span_dirty; x++)
+                    is_span_dirty = is_remaining(x, y1);
+
+                if (!is_span_dirty)
+                    break;
+            }
+
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x++)
+                {
+                    size_t taken_index = (size_t) y * m_tiles_w + x;
+                    remaining[taken_index / 64] &= ~(1ull << (taken_index % 64));
+                }
+            }
+
+            rects.push({ x0, y0, x1, y1 });
+        }
+    }
+}
+
+bool LifeDirtyTiles::is_dirty(int tile_x, int tile_y)
+{
+    assert(tile_x >= 0 && tile_x < m_tiles_w && tile_y >= 0 && tile_y < m_tiles_h);
+    if (m_all_dirty)
+        return true;
+
+    size_t bit_index = (size_t) tile_y * m_tiles_w + tile_x;
+    return (m_bits[bit_index / 64] >> (bit_index % 64)) & 1;
+}
+
+bool LifeDirtyTiles::is_all_dirty()
+{
+    return m_all_dirty;
+}
+
+int LifeDirtyTiles::get_tiles_w()
+{
+    return m_tiles_w;
+}
+
+int LifeDirtyTiles::get_tiles_h()
+{
+    return m_tiles_h;
+}
+
+int LifeDirtyTiles::get_num_of_dirty_tiles()
+{
+    if (m_all_dirty)
+        return m_tiles_w * m_tiles_h;
+
+    int num_of_dirty_tiles = 0;
+    for (size_t i = 0; i < get_num_of_words(); i++)
+        num_of_dirty_tiles += __builtin_popcountll(m_bits[i]);
+
+    return num_of_dirty_tiles;
+}
+
+size_t LifeDirtyTiles::get_num_of_words()
+{
+    return ((size_t) m_tiles_w * m_tiles_h + 63) / 64;
+}
+
+/* ------------------------------------- LifeFrame ------------------------------------ */
+
+LifeFrame::LifeFrame()
+: m_x(0)
+, m_y(0)
+, m_width(0)
+, m_height(0)
+, m_level(0)
+, m_words_per_row(0)
+, m_generation(0)
+, m_population(0)
+{}
+
+void LifeFrame::set_region(int64_t x, int64_t y, int width, int height, int level)
+{
+    assert(width > 0 && height > 0);
+    assert(level >= 0 && level < 63);
+
+    int64_t block_mask = ~((1ll << level) - 1);
+    m_x             = x & block_mask;
+    m_y             = y & block_mask;
+    m_width         = width;
+    m_height        = height;
+    m_level         = level;
+    m_words_per_row = (width + LIFE_CELLS_PER_WORD - 1) / LIFE_CELLS_PER_WORD;
+
+    size_t num_of_words = (size_t) m_words_per_row * m_height;
+    if (m_blocks.get_size() < num_of_words)
+        m_blocks.resize(num_of_words);
+
+    m_blocks.clear_and_zero();
+
+    int tiles_w = (m_width  + LIFE_TILE_SIZE - 1) / LIFE_TILE_SIZE;
+    int tiles_h = (m_height + LIFE_TILE_SIZE - 1) / LIFE_TILE_SIZE;
+    m_dirty_tiles.reset(tiles_w, tiles_h);
+    m_dirty_tiles.mark_all();
+}
+
+void LifeFrame::set_stats(uint64_t generation, uint64_t population)
+{
+    m_generation = generation;
+    m_population = population;
+}
+
+void LifeFrame::set_block(int64_t block_x, int64_t block_y)
+{
+    if (block_x < 0 || block_x >= m_width || block_y < 0 || block_y >= m_height)
+        return;
+
+    get_row(block_y)[block_x / LIFE_CELLS_PER_WORD] |= 1ull << (block_x % LIFE_CELLS_PER_WORD);
+}
+
+bool LifeFrame::get_block(int64_t block_x, int64_t block_y)
+{
+    if (block_x < 0 || block_x >= m_width || block_y < 0 || block_y >= m_height)
+        return false;
+
+    return (get_row(block_y)[block_x / LIFE_CELLS_PER_WORD] >> (block_x % LIFE_CELLS_PER_WORD)) & 1;
+}
+
+uint64_t* LifeFrame::get_row(int block_y)
+{
+    assert(block_y >= 0 && block_y < m_height);
+    return &m_blocks.get_underlying_buffer()[(size_t) block_y * m_words_per_row];
+}
+
+int64_t LifeFrame::get_x()
+{
+    return m_x;
+}
+
+int64_t LifeFrame::get_y()
+{
+    return m_y;
+}
+
+int LifeFrame::get_width()
+{
+    return m_width;
+}
+
+int LifeFrame::get_height()
+{
+    return m_height;
+}
+
+int LifeFrame::get_level()
+{
+    return m_level;
+}
+
+int LifeFrame::get_words_per_row()
+{
+    return m_words_per_row;
+}
+
+uint64_t LifeFrame::get_generation()
+{
+    return m_generation;
+}
+
+uint64_t LifeFrame::get_population()
+{
+    return m_population;
+}
+
+LifeDirtyTiles& LifeFrame::get_dirty_tiles()
+{
+    return m_dirty_tiles;
+}
+
+/* ------------------------------------- LifeGrid ------------------------------------- */
+
+LifeGrid::LifeGrid(int width, int height)
+: m_width(width)
+, m_height(height)
+, m_words_per_row(width / LIFE_CELLS_PER_WORD)
+, m_generation(0)
+, m_front(0)
+, m_step_row(life_get_best_kernel().step_row)
+, m_thread_pool(nullptr)
+, m_tiles_w((width  + LIFE_TILE_SIZE - 1) / LIFE_TILE_SIZE)
+, m_tiles_h((height + LIFE_TILE_SIZE - 1) / LIFE_TILE_SIZE)
+{
+    // TODO: Support widths that aren't a multiple of the word size by masking the last word.
+    assert_with_message(width > 0 && width % LIFE_CELLS_PER_WORD == 0, "Width must be a multiple of %d", LIFE_CELLS_PER_WORD);
+    assert(height > 0);
+
+    size_t num_of_words = (size_t) m_words_per_row * m_height;
+    m_buffers[0].resize(num_of_words);
+    m_buffers[1].resize(num_of_words);
+    m_dirty_tiles.resize((size_t) m_tiles_w * m_tiles_h);
+    clear();
+}
+
+void LifeGrid::step(uint64_t generations)
+{
+    int num_of_bands = (m_height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+
+    for (uint64_t generation = 0; generation < generations; generation++)
+    {
+        // Bands only read the front buffer and write their own rows of the back buffer, so
+        // they need no locking. parallel_for returning is the barrier between generations.
+        if (m_thread_pool)
+            m_thread_pool->parallel_for(num_of_bands, step_band, this);
+        else
+            step_rows(0, m_height);
+
+        m_front ^= 1;
+        m_generation++;
+    }
+}
+
+void LifeGrid::clear()
+{
+    m_buffers[0].clear_and_zero();
+    m_buffers[1].clear_and_zero();
+    m_generation = 0;
+    mark_all_tiles_dirty();
+}
+
+void LifeGrid::randomize(uint64_t seed, float density)
+{
+    uint64_t random_state = seed;
+    uint64_t threshold    = (uint64_t) (density * 4294967296.0f);
+
+    uint64_t* cells     = get_front_buffer();
+    size_t num_of_words = (size_t) m_words_per_row * m_height;
+    for (size_t i = 0; i < num_of_words; i++)
+    {
+        uint64_t word = 0;
+        for (int bit = 0; bit < LIFE_CELLS_PER_WORD; bit++)
+        {
+            uint64_t sample = random_next(random_state) >> 32;
+            word |= (uint64_t) (sample < threshold) << bit;
+        }
+
+        cells[i] = word;
+    }
+
+    mark_all_tiles_dirty();
+}
+
+void LifeGrid::set_kernel(LifeKernel kernel)
+{
+    m_step_row = kernel.step_row;
+}
+
+void LifeGrid::set_thread_pool(ThreadPool* thread_pool)
+{
+    m_thread_pool = thread_pool;
+}
+
+bool LifeGrid::get_cell(int64_t x, int64_t y)
+{
+    assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+    uint64_t word = get_row(y)[x / LIFE_CELLS_PER_WORD];
+    return (word >> (x % LIFE_CELLS_PER_WORD)) & 1;
+}
+
+void LifeGrid::set_cell(int64_t x, int64_t y, bool alive)
+{
+    assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+    uint64_t& word = get_row(y)[x / LIFE_CELLS_PER_WORD];
+    uint64_t mask  = 1ull << (x % LIFE_CELLS_PER_WORD);
+
+    if (alive)
+        word |= mask;
+    else
+        word &= ~mask;
+
+    m_dirty_tiles[(y / LIFE_TILE_SIZE) * m_tiles_w + x / LIFE_TILE_SIZE] = TILE_DIRTY;
+}
+
+void LifeGrid::set_run(int64_t x, int64_t y, int64_t length)
+{
+    assert(x >= 0 && length >= 0 && x + length <= m_width && y >= 0 && y < m_height);
+    if (!length)
+        return;
+
+    life_set_bits(get_row(y), x, length);
+
+    uint8_t* dirty_tiles = &m_dirty_tiles[(y / LIFE_TILE_SIZE) * m_tiles_w];
+    for (int64_t tile_x = x / LIFE_TILE_SIZE; tile_x <= (x + length - 1) / LIFE_TILE_SIZE; tile_x++)
+        dirty_tiles[tile_x] = TILE_DIRTY;
+}
+
+void LifeGrid::set_row(int64_t x, int64_t y, const uint64_t* words, int64_t num_of_words)
+{
+    assert(x >= 0 && num_of_words >= 0 && y >= 0 && y < m_height);
+    if (!num_of_words)
+        return;
+
+    // The last word may stick out past the edge, as long as nothing in it is set.
+    uint64_t* row = get_row(y);
+    int shift     = x % LIFE_CELLS_PER_WORD;
+    int64_t first = x / LIFE_CELLS_PER_WORD;
+    for (int64_t i = 0; i < num_of_words; i++)
+    {
+        uint64_t word = words[i];
+        if (!word)
+            continue;
+
+        int64_t word_x = x + i * LIFE_CELLS_PER_WORD;
+        assert(word_x + LIFE_CELLS_PER_WORD - __builtin_clzll(word) <= m_width);
+
+        row[first + i] |= word << shift;
+        if (shift && (word >> (LIFE_CELLS_PER_WORD - shift)))
+            row[first + i + 1] |= word >> (LIFE_CELLS_PER_WORD - shift);
+    }
+
+    int64_t x1 = min<int64_t>(x + num_of_words * LIFE_CELLS_PER_WORD, m_width);
+    uint8_t* dirty_tiles = &m_dirty_tiles[(y / LIFE_TILE_SIZE) * m_tiles_w];
+    for (int64_t tile_x = x / LIFE_TILE_SIZE; tile_x <= (x1 - 1) / LIFE_TILE_SIZE; tile_x++)
+        dirty_tiles[tile_x] = TILE_DIRTY;
+}
+
+void LifeGrid::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1)
+{
+    x0 = 0;
+    y0 = 0;
+    x1 = m_width;
+    y1 = m_height;
+}
+
+// Tiles are one word wide, so a tile's rows are one column of words down the board.
+bool LifeGrid::visit_tiles(LifeTileVisitor visit, void* data)
+{
+    uint64_t* cells = get_front_buffer();
+    for (int tile_y = 0; tile_y < m_tiles_h; tile_y++)
+    {
+        int num_of_rows = min(m_height - tile_y * LIFE_TILE_SIZE, LIFE_TILE_SIZE);
+        for (int tile_x = 0; tile_x < m_tiles_w; tile_x++)
+        {
+            const uint64_t* rows = &cells[(size_t) tile_y * LIFE_TILE_SIZE * m_words_per_row + tile_x];
+            visit(data, tile_x, tile_y, rows, num_of_rows, m_words_per_row);
+        }
+    }
+
+    return true;
+}
+
+bool LifeGrid::visit_changed_tiles(LifeTileVisitor visit, void* data)
+{
+    uint64_t* cells = get_front_buffer();
+    for (int tile_y = 0; tile_y < m_tiles_h; tile_y++)
+    {
+        int num_of_rows      = min(m_height - tile_y * LIFE_TILE_SIZE, LIFE_TILE_SIZE);
+        uint8_t* dirty_tiles = &m_dirty_tiles[(size_t) tile_y * m_tiles_w];
+        for (int tile_x = 0; tile_x < m_tiles_w; tile_x++)
+        {
+            if (!(dirty_tiles[tile_x] & TILE_DIRTY_FOR_VISIT))
+                continue;
+
+            dirty_tiles[tile_x] &= ~TILE_DIRTY_FOR_VISIT;
+            const uint64_t* rows = &cells[(size_t) tile_y * LIFE_TILE_SIZE * m_words_per_row + tile_x];
+            visit(data, tile_x, tile_y, rows, num_of_rows, m_words_per_row);
+        }
+    }
+
+    return true;
+}
+
+void LifeGrid::capture(LifeFrame& frame)
+{
+    frame.set_stats(m_generation, get_population());
+
+    int level          = frame.get_level();
+    int64_t block_size = 1ll << level;
+
+    // When frame tiles line up with ours, only the tiles that changed since the last
+    // capture are dirty. Either way they're clean again from here on.
+    bool is_tile_aligned = level == 0 && frame.get_x() % LIFE_TILE_SIZE == 0 && frame.get_y() % LIFE_TILE_SIZE == 0;
+    if (is_tile_aligned)
+    {
+        LifeDirtyTiles& frame_dirty_tiles = frame.get_dirty_tiles();
+        frame_dirty_tiles.reset(frame_dirty_tiles.get_tiles_w(), frame_dirty_tiles.get_tiles_h());
+
+        int64_t first_tile_x = frame.get_x() / LIFE_TILE_SIZE;
+        int64_t first_tile_y = frame.get_y() / LIFE_TILE_SIZE;
+        for (int tile_y = 0; tile_y < frame_dirty_tiles.get_tiles_h(); tile_y++)
+        {
+            for (int tile_x = 0; tile_x < frame_dirty_tiles.get_tiles_w(); tile_x++)
+            {
+                int64_t grid_tile_x = first_tile_x + tile_x;
+                int64_t grid_tile_y = first_tile_y + tile_y;
+                if (grid_tile_x < 0 || grid_tile_x >= m_tiles_w || grid_tile_y < 0 || grid_tile_y >= m_tiles_h)
+                    continue;
+
+                if (m_dirty_tiles[grid_tile_y * m_tiles_w + grid_tile_x] & TILE_DIRTY_FOR_CAPTURE)
+                    frame_dirty_tiles.mark(tile_x, tile_y);
+            }
+        }
+    }
+
+    uint8_t* dirty_tiles = m_dirty_tiles.get_underlying_buffer();
+    for (size_t i = 0; i < m_dirty_tiles.get_size(); i++)
+        dirty_tiles[i] &= ~TILE_DIRTY_FOR_CAPTURE;
+
+    for (int block_y = 0; block_y < frame.get_height(); block_y++)
+    {
+        int64_t y0 = max<int64_t>(frame.get_y() + block_y * block_size, 0);
+        int64_t y1 = min<int64_t>(frame.get_y() + (block_y + 1) * block_size, m_height);
+        if (y0 >= y1)
+            continue;
+
+        uint64_t* frame_row = frame.get_row(block_y);
+
+        // One cell per block and word aligned, so whole words can be copied across.
+        if (level == 0 && frame.get_x() >= 0 && frame.get_x() % LIFE_CELLS_PER_WORD == 0)
+        {
+            uint64_t* row        = get_row(y0);
+            int64_t first_word   = frame.get_x() / LIFE_CELLS_PER_WORD;
+            int64_t num_of_words = min<int64_t>(frame.get_words_per_row(), m_words_per_row - first_word);
+            for (int64_t i = 0; i < num_of_words; i++)
+                frame_row[i] = row[first_word + i];
+
+            int trailing_blocks = frame.get_width() % LIFE_CELLS_PER_WORD;
+            if (trailing_blocks && num_of_words == frame.get_words_per_row())
+                frame_row[num_of_words - 1] &= ~0ull >> (LIFE_CELLS_PER_WORD - trailing_blocks);
+
+            continue;
+        }
+
+        for (int block_x = 0; block_x < frame.get_width(); block_x++)
+        {
+            int64_t x0 = max<int64_t>(frame.get_x() + block_x * block_size, 0);
+            int64_t x1 = min<int64_t>(frame.get_x() + (block_x + 1) * block_size, m_width);
+            if (x0 >= x1)
+                continue;
+
+            for (int64_t y = y0; y < y1; y++)
+            {
+                if (any_alive_in_span(get_row(y), x0, x1))
+                {
+                    frame.set_block(block_x, block_y);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+uint64_t* LifeGrid::get_row(int y)
+{
+    assert(y >= 0 && y < m_height);
+    return &get_front_buffer()[(size_t) y * m_words_per_row];
+}
+
+uint64_t LifeGrid::get_population()
+{
+    uint64_t population = 0;
+    uint64_t* cells     = get_front_buffer();
+    size_t num_of_words = (size_t) m_words_per_row * m_height;
+    for (size_t i = 0; i < num_of_words; i++)
+        population += __builtin_popcountll(cells[i]);
+
+    return population;
+}
+
+uint64_t LifeGrid::get_generation()
+{
+    return m_generation;
+}
+
+void LifeGrid::set_generation(uint64_t generation)
+{
+    m_generation = generation;
+}
+
+int LifeGrid::get_width()
+{
+    return m_width;
+}
+
+int LifeGrid::get_height()
+{
+    return m_height;
+}
+
+int LifeGrid::get_words_per_row()
+{
+    return m_words_per_row;
+}
+
+uint64_t LifeGrid::get_hash()
+{
+    size_t num_of_words = (size_t) m_words_per_row * m_height;
+    return hash_bytes(get_front_buffer(), num_of_words * sizeof(uint64_t));
+}
+
+void LifeGrid::step_rows(int first_row, int last_row)
+{
+    uint64_t* src = get_front_buffer();
+    uint64_t* dst = get_back_buffer();
+
+    for (int y = first_row; y < last_row; y++)
+    {
+        // Wraps vertically at the edges of the board.
+        int above = y == 0            ? m_height - 1 : y - 1;
+        int below = y == m_height - 1 ? 0            : y + 1;
+
+        uint64_t* src_row = &src[(size_t) y * m_words_per_row];
+        uint64_t* dst_row = &dst[(size_t) y * m_words_per_row];
+        m_step_row(&src[(size_t) above * m_words_per_row], src_row, &src[(size_t) below * m_words_per_row], dst_row, m_words_per_row);
+
+        // A tile is as wide as a word. Both rows are still in cache, so this is cheap next
+        // to the step itself.
+        uint8_t* dirty_tiles = &m_dirty_tiles[(y / LIFE_TILE_SIZE) * m_tiles_w];
+        for (int word_index = 0; word_index < m_words_per_row; word_index++)
+            dirty_tiles[word_index] |= TILE_DIRTY * (src_row[word_index] != dst_row[word_index]);
+    }
+}
+
+void LifeGrid::mark_all_tiles_dirty()
+{
+    memset(m_dirty_tiles.get_underlying_buffer(), TILE_DIRTY, m_dirty_tiles.get_size());
+}
+
+void LifeGrid::step_band(void* grid, int band_index)
+{
+    LifeGrid* life_grid = static_cast<LifeGrid*>(grid);
+
+    int first_row = band_index * BAND_HEIGHT;
+    int last_row  = min(first_row + BAND_HEIGHT, life_grid->m_height);
+    life_grid->step_rows(first_row, last_row);
+}
+
+uint64_t* LifeGrid::get_front_buffer()
+{
+    return m_buffers[m_front].get_underlying_buffer();
+}
+
+uint64_t* LifeGrid::get_back_buffer()
+{
+    return m_buffers[m_front ^ 1].get_underlying_buffer();
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "array.hpp"
+#include "thread_pool.hpp"
+
+// Cells are packed one bit per cell into 64-bit words. Bit i of word w in a row is the
+// cell at x = w * 64 + i, so the least significant bit is the left most cell of a word.
+static const int LIFE_CELLS_PER_WORD = 64;
+static const int LIFE_TILE_SIZE      = 64;
+
+/* -------------------------------- Bit sliced adders -------------------------------- */
+
+// Each bit position of the operands is an independent 1-bit lane, so a single call adds
+// 64 cells worth of neighbour counts at once.
+static inline void life_half_add(uint64_t a, uint64_t b, uint64_t& sum, uint64_t& carry)
+{
+    sum   = a ^ b;
+    carry = a & b;
+}
+
+static inline void life_full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry)
+{
+    uint64_t partial = a ^ b;
+    sum   = partial ^ c;
+    carry = (a & b) | (partial & c);
+}
+
+// Computes the next state of the 64 cells in `center` from the 3x3 block of words around
+// it. The west and east words are only used for the single cell that crosses the word
+// boundary.
+static inline uint64_t life_step_word(uint64_t above_west, uint64_t above, uint64_t above_east,
+                                      uint64_t west,       uint64_t center, uint64_t east,
+                                      uint64_t below_west, uint64_t below, uint64_t below_east)
+{
+    // Neighbour to the west of bit i is bit i-1, so shifting left lines it up with bit i.
+    uint64_t above_l = (above  << 1) | (above_west >> 63);
+    uint64_t above_r = (above  >> 1) | (above_east << 63);
+    uint64_t center_l = (center << 1) | (west       >> 63);
+    uint64_t center_r = (center >> 1) | (east       << 63);
+    uint64_t below_l = (below  << 1) | (below_west >> 63);
+    uint64_t below_r = (below  >> 1) | (below_east << 63);
+
+    // Sum the eight neighbours into ones, twos and fours bit planes.
+    uint64_t above_sum, above_carry;
+    uint64_t below_sum, below_carry;
+    uint64_t center_sum, center_carry;
+    life_full_add(above_l, above, above_r, above_sum, above_carry);
+    life_full_add(below_l, below, below_r, below_sum, below_carry);
+    life_half_add(center_l, center_r, center_sum, center_carry);
+
+    uint64_t ones, ones_carry;
+    life_full_add(above_sum, below_sum, center_sum, ones, ones_carry);
+
+    uint64_t twos_partial, fours_partial;
+    uint64_t twos, fours;
+    life_full_add(above_carry, below_carry, center_carry, twos_partial, fours_partial);
+    life_half_add(twos_partial, ones_carry, twos, fours);
+    fours |= fours_partial;
+
+    // Alive with 3 neighbours, or with 2 neighbours if already alive. Counts of 4 and above
+    // (including 8, which wraps the ones and twos planes to zero) set the fours plane.
+    return twos & ~fours & (ones | center);
+}
+
+/* -------------------------------------- Kernels ------------------------------------- */
+
+// Computes one row of the next generation. `above` and `below` are the neighbouring rows
+// of `row`, already wrapped vertically. Every kernel must produce bit identical output.
+typedef void (*LifeRowKernel)(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row);
+
+struct LifeKernel
+{
+    const char* name;
+    LifeRowKernel step_row;
+};
+
+void life_step_row_scalar(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row);
+
+// Fills `kernels` with every kernel the CPU supports, from slowest to fastest.
+int life_get_available_kernels(LifeKernel* kernels, int capacity);
+
+// The fastest supported kernel. Detected once on the first call.
+LifeKernel life_get_best_kernel();
+
+// Steps the same random boards with every available kernel and compares the hashes
+// against the scalar kernel. Returns false if any of them disagree.
+bool life_self_check(uint64_t seed);
+
+/* ---------------------------------- LifeDirtyTiles ---------------------------------- */
+
+// A rectangle of LIFE_TILE_SIZE x LIFE_TILE_SIZE tiles, [x0, x1) x [y0, y1).
+struct LifeTileRect
+{
+    int x0, y0, x1, y1;
+};
+
+// Which LIFE_TILE_SIZE x LIFE_TILE_SIZE tiles of a frame changed since some earlier frame,
+// so the renderer only has to upload those.
+class LifeDirtyTiles
+{
+    int m_tiles_w;
+    int m_tiles_h;
+    bool m_all_dirty;
+    Array<uint64_t> m_bits;
+    Array<uint64_t> m_remaining_bits;
+
+public:
+    LifeDirtyTiles();
+
+    // Resizes to the given number of tiles, with every tile clean.
+    void reset(int tiles_w, int tiles_h);
+    void mark(int tile_x, int tile_y);
+    void mark_all();
+
+    void copy_from(LifeDirtyTiles& other);
+    // Marks every tile dirty in `other` as well. If they differ in size everything is
+    // marked, there's no telling which tiles line up.
+    void merge(LifeDirtyTiles& other);
+
+    // Covers the dirty tiles with as few rectangles as it cheaply can, in tiles.
+    void get_rects(Array<LifeTileRect>& rects);
+
+    bool is_dirty(int tile_x, int tile_y);
+    bool is_all_dirty();
+    int get_tiles_w();
+    int get_tiles_h();
+    int get_num_of_dirty_tiles();
+
+private:
+    size_t get_num_of_words();
+};
+
+/* ------------------------------------- LifeFrame ------------------------------------ */
+
+// A packed capture of a rectangular region of an engine, used for drawing. Each bit is a
+// square block of (1 << level) cells which is set if any cell in the block is alive, so
+// zoomed out views of huge universes stay a small fixed size.
+class LifeFrame
+{
+    int64_t m_x;
+    int64_t m_y;
+    int m_width;
+    int m_height;
+    int m_level;
+    int m_words_per_row;
+    uint64_t m_generation;
+    uint64_t m_population;
+
+    Array<uint64_t> m_blocks;
+
+    // Engines that can tell what changed since their last capture narrow this down,
+    // otherwise every tile is dirty.
+    LifeDirtyTiles m_dirty_tiles;
+
+public:
+    LifeFrame();
+
+    // Position is in cells and is aligned down to the block size. Size is in blocks.
+    // Marks every tile dirty.
+    void set_region(int64_t x, int64_t y, int width, int height, int level);
+    void set_stats(uint64_t generation, uint64_t population);
+    void set_block(int64_t block_x, int64_t block_y);
+    bool get_block(int64_t block_x, int64_t block_y);
+    uint64_t* get_row(int block_y);
+
+    int64_t get_x();
+    int64_t get_y();
+    int get_width();
+    int get_height();
+    int get_level();
+    int get_words_per_row();
+    uint64_t get_generation();
+    uint64_t get_population();
+    LifeDirtyTiles& get_dirty_tiles();
+};
+
+// Sets bits [x, x + length) of a packed row, whole words at a time in between.
+static inline void life_set_bits(uint64_t* row, int64_t x, int64_t length)
+{
+    if (length <= 0)
+        return;
+
+    int64_t first_word  = x / LIFE_CELLS_PER_WORD;
+    int64_t last_word   = (x + length - 1) / LIFE_CELLS_PER_WORD;
+    uint64_t first_mask = ~0ull << (x % LIFE_CELLS_PER_WORD);
+    uint64_t last_mask  = ~0ull >> (LIFE_CELLS_PER_WORD - 1 - (x + length - 1) % LIFE_CELLS_PER_WORD);
+
+    if (first_word == last_word)
+    {
+        row[first_word] |= first_mask & last_mask;
+        return;
+    }
+
+    row[first_word] |= first_mask;
+    for (int64_t word = first_word + 1; word < last_word; word++)
+        row[word] = ~0ull;
+    row[last_word] |= last_mask;
+}
+
+/* ------------------------------------ LifeEngine ------------------------------------ */
+
+// Called with a LIFE_TILE_SIZE square tile of cells at (tile_x, tile_y), in tiles. Row y of
+// the tile is the word at rows[y * stride], only the first `num_of_rows` rows exist.
+typedef void (*LifeTileVisitor)(void* data, int64_t tile_x, int64_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride);
+
+// Common interface of the simulation engines so the frame loop doesn't care which one is
+// running. Coordinates are 64-bit since some engines are unbounded.
+class LifeEngine
+{
+public:
+    virtual ~LifeEngine() {}
+
+    virtual void step(uint64_t generations) = 0;
+
+    // Kills every cell and goes back to generation zero.
+    virtual void clear() = 0;
+
+    virtual bool get_cell(int64_t x, int64_t y) = 0;
+    virtual void set_cell(int64_t x, int64_t y, bool alive) = 0;
+
+    // Sets `length` cells alive from (x, y) to the right. Engines that keep cells packed
+    // override it to set whole words at a time, pattern loaders write through it.
+    virtual void set_run(int64_t x, int64_t y, int64_t length)
+    {
+        for (int64_t i = 0; i < length; i++)
+            set_cell(x + i, y, true);
+    }
+
+    // Sets the cells of `num_of_words` packed words alive, bit i of word w being the cell at
+    // (x + w * 64 + i, y). Cells already alive stay alive.
+    virtual void set_row(int64_t x, int64_t y, const uint64_t* words, int64_t num_of_words)
+    {
+        for (int64_t word_index = 0; word_index < num_of_words; word_index++)
+        {
+            uint64_t word = words[word_index];
+            while (word)
+            {
+                // The run starts at the lowest set bit, shifted down to bit 0 its length is
+                // the number of trailing ones.
+                int first        = __builtin_ctzll(word);
+                uint64_t shifted = word >> first;
+                int length       = ~shifted ? __builtin_ctzll(~shifted) : LIFE_CELLS_PER_WORD - first;
+
+                set_run(x + word_index * LIFE_CELLS_PER_WORD + first, y, length);
+
+                if (first + length == LIFE_CELLS_PER_WORD)
+                    break;
+                word &= ~0ull << (first + length);
+            }
+        }
+    }
+
+    virtual uint64_t get_population() = 0;
+    virtual uint64_t get_generation() = 0;
+    virtual void set_generation(uint64_t generation) = 0;
+
+    // Smallest rectangle [x0, x1) x [y0, y1) known to contain every live cell.
+    virtual void get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) = 0;
+
+    // Fills the region already set on the frame.
+    virtual void capture(LifeFrame& frame) = 0;
+
+    // Hands every tile that may have live cells to `visit`, straight out of the engine's
+    // own memory. Returns false for engines that don't keep their cells in tiles, which
+    // can't be snapshotted.
+    virtual bool visit_tiles(LifeTileVisitor visit, void* data)
+    {
+        return false;
+    }
+
+    // Like visit_tiles, but only hands out the tiles that may have changed since the last
+    // call, the first call hands out every tile. Tiles the engine has dropped since are
+    // handed out all dead. Returns false for engines that don't keep track.
+    virtual bool visit_changed_tiles(LifeTileVisitor visit, void* data)
+    {
+        return false;
+    }
+};
+
+/* ------------------------------------- LifeGrid ------------------------------------- */
+
+// A fixed size board using the B3/S23 rule. The board wraps around at its edges.
+class LifeGrid : public LifeEngine
+{
+    int m_width;
+    int m_height;
+    int m_words_per_row;
+    uint64_t m_generation;
+
+    // Double buffered so a generation reads the front buffer while writing the back buffer.
+    Array<uint64_t> m_buffers[2];
+    int m_front;
+
+    LifeRowKernel m_step_row;
+
+    // Optional, steps bands of rows in parallel when set.
+    ThreadPool* m_thread_pool;
+
+    // One byte per LIFE_TILE_SIZE square tile, set when any of its cells changed. capture
+    // and visit_changed_tiles each clear their own bit once they've seen it. Bytes rather
+    // than bits so bands can mark their own tiles without atomics.
+    static const uint8_t TILE_DIRTY_FOR_CAPTURE = 1 << 0;
+    static const uint8_t TILE_DIRTY_FOR_VISIT   = 1 << 1;
+    static const uint8_t TILE_DIRTY             = TILE_DIRTY_FOR_CAPTURE | TILE_DIRTY_FOR_VISIT;
+
+    int m_tiles_w;
+    int m_tiles_h;
+    Array<uint8_t> m_dirty_tiles;
+
+public:
+    // A band is a row of tiles, so no two bands share a dirty tile.
+    static const int BAND_HEIGHT = LIFE_TILE_SIZE;
+
+    LifeGrid(int width, int height);
+
+    void step(uint64_t generations = 1) override;
+    void clear() override;
+    void randomize(uint64_t seed, float density);
+    void set_kernel(LifeKernel kernel);
+    void set_thread_pool(ThreadPool* thread_pool);
+
+    bool get_cell(int64_t x, int64_t y) override;
+    void set_cell(int64_t x, int64_t y, bool alive) override;
+    void set_run(int64_t x, int64_t y, int64_t length) override;
+    void set_row(int64_t x, int64_t y, const uint64_t* words, int64_t num_of_words) override;
+    void get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) override;
+    void capture(LifeFrame& frame) override;
+    bool visit_tiles(LifeTileVisitor visit, void* data) override;
+    bool visit_changed_tiles(LifeTileVisitor visit, void* data) override;
+
+    uint64_t* get_row(int y);
+    uint64_t get_population() override;
+    uint64_t get_generation() override;
+    void set_generation(uint64_t generation) override;
+    int get_width();
+    int get_height();
+    int get_words_per_row();
+    uint64_t get_hash();
+
+private:
+    void step_rows(int first_row, int last_row);
+    void mark_all_tiles_dirty();
+    static void step_band(void* grid, int band_index);
+
+    uint64_t* get_front_buffer();
+    uint64_t* get_back_buffer();
+};
@@ -0,0 +1,313 @@
+#include "life.hpp"
+
+// Every vector kernel handles the first and last word of a row with the scalar code, since
+// those are the only words whose neighbours wrap around the board. The interior words are
+// loaded unaligned at offsets -1, 0 and +1 so each lane sees its own west and east words.
+
+static inline void step_edge_words(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row)
+{
+    int last = words_per_row - 1;
+
+    int west = last;
+    int east = last == 0 ? 0 : 1;
+    out[0] = life_step_word(above[west], above[0], above[east],
+                            row[west],   row[0],   row[east],
+                            below[west], below[0], below[east]);
+
+    if (last == 0)
+        return;
+
+    west = last - 1;
+    east = 0;
+    out[last] = life_step_word(above[west], above[last], above[east],
+                               row[west],   row[last],   row[east],
+                               below[west], below[last], below[east]);
+}
+
+static inline void step_interior_words(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int first, int last)
+{
+    for (int x = first; x < last; x++)
+    {
+        out[x] = life_step_word(above[x-1], above[x], above[x+1],
+                                row[x-1],   row[x],   row[x+1],
+                                below[x-1], below[x], below[x+1]);
+    }
+}
+
+void life_step_row_scalar(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row)
+{
+    step_edge_words(above, row, below, out, words_per_row);
+    step_interior_words(above, row, below, out, 1, words_per_row - 1);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* --------------------------------------- SSE2 --------------------------------------- */
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+
+SSE2_TARGET static inline void sse2_full_add(__m128i a, __m128i b, __m128i c, __m128i& sum, __m128i& carry)
+{
+    __m128i partial = _mm_xor_si128(a, b);
+    sum   = _mm_xor_si128(partial, c);
+    carry = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(partial, c));
+}
+
+SSE2_TARGET static inline __m128i sse2_step_words(const uint64_t* above, const uint64_t* row, const uint64_t* below)
+{
+    __m128i above_w  = _mm_loadu_si128((const __m128i*) (above - 1));
+    __m128i above_c  = _mm_loadu_si128((const __m128i*) (above));
+    __m128i above_e  = _mm_loadu_si128((const __m128i*) (above + 1));
+    __m128i center_w = _mm_loadu_si128((const __m128i*) (row - 1));
+    __m128i center_c = _mm_loadu_si128((const __m128i*) (row));
+    __m128i center_e = _mm_loadu_si128((const __m128i*) (row + 1));
+    __m128i below_w  = _mm_loadu_si128((const __m128i*) (below - 1));
+    __m128i below_c  = _mm_loadu_si128((const __m128i*) (below));
+    __m128i below_e  = _mm_loadu_si128((const __m128i*) (below + 1));
+
+    __m128i above_l  = _mm_or_si128(_mm_slli_epi64(above_c, 1),  _mm_srli_epi64(above_w, 63));
+    __m128i above_r  = _mm_or_si128(_mm_srli_epi64(above_c, 1),  _mm_slli_epi64(above_e, 63));
+    __m128i center_l = _mm_or_si128(_mm_slli_epi64(center_c, 1), _mm_srli_epi64(center_w, 63));
+    __m128i center_r = _mm_or_si128(_mm_srli_epi64(center_c, 1), _mm_slli_epi64(center_e, 63));
+    __m128i below_l  = _mm_or_si128(_mm_slli_epi64(below_c, 1),  _mm_srli_epi64(below_w, 63));
+    __m128i below_r  = _mm_or_si128(_mm_srli_epi64(below_c, 1),  _mm_slli_epi64(below_e, 63));
+
+    __m128i above_sum, above_carry;
+    __m128i below_sum, below_carry;
+    sse2_full_add(above_l, above_c, above_r, above_sum, above_carry);
+    sse2_full_add(below_l, below_c, below_r, below_sum, below_carry);
+    __m128i center_sum   = _mm_xor_si128(center_l, center_r);
+    __m128i center_carry = _mm_and_si128(center_l, center_r);
+
+    __m128i ones, ones_carry;
+    sse2_full_add(above_sum, below_sum, center_sum, ones, ones_carry);
+
+    __m128i twos_partial, fours_partial;
+    sse2_full_add(above_carry, below_carry, center_carry, twos_partial, fours_partial);
+    __m128i twos  = _mm_xor_si128(twos_partial, ones_carry);
+    __m128i fours = _mm_or_si128(_mm_and_si128(twos_partial, ones_carry), fours_partial);
+
+    return _mm_andnot_si128(fours, _mm_and_si128(twos, _mm_or_si128(ones, center_c)));
+}
+
+SSE2_TARGET static void life_step_row_sse2(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row)
+{
+    const int lanes = 2;
+    int last = words_per_row - 1;
+
+    int x = 1;
+    for (; x + lanes <= last; x += lanes)
+        _mm_storeu_si128((__m128i*) &out[x], sse2_step_words(&above[x], &row[x], &below[x]));
+
+    step_interior_words(above, row, below, out, x, last);
+    step_edge_words(above, row, below, out, words_per_row);
+}
+
+/* --------------------------------------- AVX2 --------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline void avx2_full_add(__m256i a, __m256i b, __m256i c, __m256i& sum, __m256i& carry)
+{
+    __m256i partial = _mm256_xor_si256(a, b);
+    sum   = _mm256_xor_si256(partial, c);
+    carry = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(partial, c));
+}
+
+AVX2_TARGET static inline __m256i avx2_step_words(const uint64_t* above, const uint64_t* row, const uint64_t* below)
+{
+    __m256i above_w  = _mm256_loadu_si256((const __m256i*) (above - 1));
+    __m256i above_c  = _mm256_loadu_si256((const __m256i*) (above));
+    __m256i above_e  = _mm256_loadu_si256((const __m256i*) (above + 1));
+    __m256i center_w = _mm256_loadu_si256((const __m256i*) (row - 1));
+    __m256i center_c = _mm256_loadu_si256((const __m256i*) (row));
+    __m256i center_e = _mm256_loadu_si256((const __m256i*) (row + 1));
+    __m256i below_w  = _mm256_loadu_si256((const __m256i*) (below - 1));
+    __m256i below_c  = _mm256_loadu_si256((const __m256i*) (below));
+    __m256i below_e  = _mm256_loadu_si256((const __m256i*) (below + 1));
+
+    __m256i above_l  = _mm256_or_si256(_mm256_slli_epi64(above_c, 1),  _mm256_srli_epi64(above_w, 63));
+    __m256i above_r  = _mm256_or_si256(_mm256_srli_epi64(above_c, 1),  _mm256_slli_epi64(above_e, 63));
+    __m256i center_l = _mm256_or_si256(_mm256_slli_epi64(center_c, 1), _mm256_srli_epi64(center_w, 63));
+    __m256i center_r = _mm256_or_si256(_mm256_srli_epi64(center_c, 1), _mm256_slli_epi64(center_e, 63));
+    __m256i below_l  = _mm256_or_si256(_mm256_slli_epi64(below_c, 1),  _mm256_srli_epi64(below_w, 63));
+    __m256i below_r  = _mm256_or_si256(_mm256_srli_epi64(below_c, 1),  _mm256_slli_epi64(below_e, 63));
+
+    __m256i above_sum, above_carry;
+    __m256i below_sum, below_carry;
+    avx2_full_add(above_l, above_c, above_r, above_sum, above_carry);
+    avx2_full_add(below_l, below_c, below_r, below_sum, below_carry);
+    __m256i center_sum   = _mm256_xor_si256(center_l, center_r);
+    __m256i center_carry = _mm256_and_si256(center_l, center_r);
+
+    __m256i ones, ones_carry;
+    avx2_full_add(above_sum, below_sum, center_sum, ones, ones_carry);
+
+    __m256i twos_partial, fours_partial;
+    avx2_full_add(above_carry, below_carry, center_carry, twos_partial, fours_partial);
+    __m256i twos  = _mm256_xor_si256(twos_partial, ones_carry);
+    __m256i fours = _mm256_or_si256(_mm256_and_si256(twos_partial, ones_carry), fours_partial);
+
+    return _mm256_andnot_si256(fours, _mm256_and_si256(twos, _mm256_or_si256(ones, center_c)));
+}
+
+AVX2_TARGET static void life_step_row_avx2(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row)
+{
+    const int lanes = 4;
+    int last = words_per_row - 1;
+
+    int x = 1;
+    for (; x + lanes <= last; x += lanes)
+        _mm256_storeu_si256((__m256i*) &out[x], avx2_step_words(&above[x], &row[x], &below[x]));
+
+    step_interior_words(above, row, below, out, x, last);
+    step_edge_words(above, row, below, out, words_per_row);
+}
+
+/* -------------------------------------- AVX-512 ------------------------------------- */
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+// Ternary logic immediates, the truth table of f(a, b, c) indexed by (a << 2 | b << 1 | c).
+static const int TERNARY_XOR3     = 0x96;
+static const int TERNARY_MAJORITY = 0xE8;
+
+AVX512_TARGET static inline void avx512_full_add(__m512i a, __m512i b, __m512i c, __m512i& sum, __m512i& carry)
+{
+    sum   = _mm512_ternarylogic_epi64(a, b, c, TERNARY_XOR3);
+    carry = _mm512_ternarylogic_epi64(a, b, c, TERNARY_MAJORITY);
+}
+
+AVX512_TARGET static inline __m512i avx512_step_words(const uint64_t* above, const uint64_t* row, const uint64_t* below)
+{
+    __m512i above_w  = _mm512_loadu_si512(above - 1);
+    __m512i above_c  = _mm512_loadu_si512(above);
+    __m512i above_e  = _mm512_loadu_si512(above + 1);
+    __m512i center_w = _mm512_loadu_si512(row - 1);
+    __m512i center_c = _mm512_loadu_si512(row);
+    __m512i center_e = _mm512_loadu_si512(row + 1);
+    __m512i below_w  = _mm512_loadu_si512(below - 1);
+    __m512i below_c  = _mm512_loadu_si512(below);
+    __m512i below_e  = _mm512_loadu_si512(below + 1);
+
+    __m512i above_l  = _mm512_or_si512(_mm512_slli_epi64(above_c, 1),  _mm512_srli_epi64(above_w, 63));
+    __m512i above_r  = _mm512_or_si512(_mm512_srli_epi64(above_c, 1),  _mm512_slli_epi64(above_e, 63));
+    __m512i center_l = _mm512_or_si512(_mm512_slli_epi64(center_c, 1), _mm512_srli_epi64(center_w, 63));
+    __m512i center_r = _mm512_or_si512(_mm512_srli_epi64(center_c, 1), _mm512_slli_epi64(center_e, 63));
+    __m512i below_l  = _mm512_or_si512(_mm512_slli_epi64(below_c, 1),  _mm512_srli_epi64(below_w, 63));
+    __m512i below_r  = _mm512_or_si512(_mm512_srli_epi64(below_c, 1),  _mm512_slli_epi64(below_e, 63));
+
+    __m512i above_sum, above_carry;
+    __m512i below_sum, below_carry;
+    avx512_full_add(above_l, above_c, above_r, above_sum, above_carry);
+    avx512_full_add(below_l, below_c, below_r, below_sum, below_carry);
+    __m512i center_sum   = _mm512_xor_si512(center_l, center_r);
+    __m512i center_carry = _mm512_and_si512(center_l, center_r);
+
+    __m512i ones, ones_carry;
+    avx512_full_add(above_sum, below_sum, center_sum, ones, ones_carry);
+
+    __m512i twos_partial, fours_partial;
+    avx512_full_add(above_carry, below_carry, center_carry, twos_partial, fours_partial);
+    __m512i twos  = _mm512_xor_si512(twos_partial, ones_carry);
+    __m512i fours = _mm512_or_si512(_mm512_and_si512(twos_partial, ones_carry), fours_partial);
+
+    return _mm512_andnot_si512(fours, _mm512_and_si512(twos, _mm512_or_si512(ones, center_c)));
+}
+
+AVX512_TARGET static void life_step_row_avx512(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words_per_row)
+{
+    const int lanes = 8;
+    int last = words_per_row - 1;
+
+    int x = 1;
+    for (; x + lanes <= last; x += lanes)
+        _mm512_storeu_si512(&out[x], avx512_step_words(&above[x], &row[x], &below[x]));
+
+    step_interior_words(above, row, below, out, x, last);
+    step_edge_words(above, row, below, out, words_per_row);
+}
+
+#endif
+
+/* ------------------------------------- Dispatch ------------------------------------- */
+
+int life_get_available_kernels(LifeKernel* kernels, int capacity)
+{
+    int count = 0;
+    if (count < capacity)
+        kernels[count++] = { "scalar", life_step_row_scalar };
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Reads the CPUID feature bits, including whether the OS saves the wider registers.
+    __builtin_cpu_init();
+
+    if (count < capacity && __builtin_cpu_supports("sse2"))
+        kernels[count++] = { "sse2", life_step_row_sse2 };
+
+    if (count < capacity && __builtin_cpu_supports("avx2"))
+        kernels[count++] = { "avx2", life_step_row_avx2 };
+
+    if (count < capacity && __builtin_cpu_supports("avx512f"))
+        kernels[count++] = { "avx512", life_step_row_avx512 };
+#endif
+
+    return count;
+}
+
+LifeKernel life_get_best_kernel()
+{
+    static bool have_checked = false;
+    static LifeKernel best_kernel;
+
+    if (!have_checked)
+    {
+        enum { kernels_capacity = 8 };
+        LifeKernel kernels[kernels_capacity];
+        int num_of_kernels = life_get_available_kernels(kernels, kernels_capacity);
+
+        best_kernel  = kernels[num_of_kernels-1];
+        have_checked = true;
+    }
+
+    return best_kernel;
+}
+
+bool life_self_check(uint64_t seed)
+{
+    enum { kernels_capacity = 8 };
+    LifeKernel kernels[kernels_capacity];
+    int num_of_kernels = life_get_available_kernels(kernels, kernels_capacity);
+
+    // Widths chosen to cover single word rows and every remainder of the vector loops.
+    struct { int w, h; } board_sizes[] = { {64, 64}, {128, 33}, {192, 70}, {576, 97}, {1088, 256}, {4096, 512} };
+    int generations  = 100;
+    float density    = 0.35f;
+    bool all_matched = true;
+
+    for (size_t i = 0; i < array_size(board_sizes); i++)
+    {
+        int w = board_sizes[i].w;
+        int h = board_sizes[i].h;
+        uint64_t reference_hash = 0;
+
+        for (int k = 0; k < num_of_kernels; k++)
+        {
+            LifeGrid grid(w, h);
+            grid.set_kernel(kernels[k]);
+            grid.randomize(seed, density);
+            grid.step(generations);
+
+            uint64_t hash = grid.get_hash();
+            if (k == 0)
+                reference_hash = hash;
+
+            bool matched = hash == reference_hash;
+            all_matched &= matched;
+
+            printf("[SELF CHECK]: %4dx%-4d %-8s %016llx %s\n", w, h, kernels[k].name, (unsigned long long) hash, matched ? "OK" : "MISMATCH");
+        }
+    }
+
+    return all_matched;
+}
@@ -0,0 +1,422 @@
+#include "macrocell.hpp"
+
+// Level of the blocks an engine is read in, one word wide and a tile high.
+static const int BLOCK_LEVEL = 6;
+static const int BLOCK_SIZE  = 1 << BLOCK_LEVEL;
+
+Macrocell::Macrocell()
+{
+    clear();
+}
+
+void Macrocell::clear()
+{
+    m_nodes.clear();
+    m_buckets.resize(1024);
+    m_buckets.clear_and_zero();
+
+    // Index 0 stands for an empty square of any level.
+    MacrocellNode empty = {};
+    m_nodes.push(empty);
+
+    m_root       = NODE_EMPTY;
+    m_root_level = LEAF_LEVEL;
+    m_generation = 0;
+}
+
+uint32_t Macrocell::add_leaf(uint64_t bits)
+{
+    if (!bits)
+        return NODE_EMPTY;
+
+    MacrocellNode node = {};
+    node.bits          = bits;
+    node.population    = __builtin_popcountll(bits);
+    node.level         = LEAF_LEVEL;
+    return add(node);
+}
+
+uint32_t Macrocell::add_node(int level, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    assert(level > LEAF_LEVEL && level <= MAX_LEVEL);
+
+    // Not from the population, which wraps around for universes full enough.
+    if (!nw && !ne && !sw && !se)
+        return NODE_EMPTY;
+
+    MacrocellNode node = {};
+    node.nw            = nw;
+    node.ne            = ne;
+    node.sw            = sw;
+    node.se            = se;
+    node.population    = m_nodes[nw].population + m_nodes[ne].population + m_nodes[sw].population + m_nodes[se].population;
+    node.level         = level;
+    return add(node);
+}
+
+void Macrocell::set_root(uint32_t root, int level)
+{
+    assert(root < m_nodes.get_used());
+    assert(level >= LEAF_LEVEL && level <= MAX_LEVEL);
+    assert(root == NODE_EMPTY || m_nodes[root].level == level);
+
+    m_root       = root;
+    m_root_level = level;
+}
+
+void Macrocell::set_generation(uint64_t generation)
+{
+    m_generation = generation;
+}
+
+/* ------------------------------------- Engines -------------------------------------- */
+
+// Joins the blocks read from the engine into the square of `level` at (x, y). Squares that
+// miss the blocks are empty without looking any further.
+static uint32_t build_from_blocks(Macrocell& macrocell, Array<uint32_t>& blocks, int64_t blocks_x, int64_t blocks_y,
+                                  int64_t blocks_w, int64_t blocks_h, int level, int64_t x, int64_t y)
+{
+    int64_t size = 1ll << level;
+    if (x + size <= blocks_x || y + size <= blocks_y ||
+        x >= blocks_x + blocks_w * BLOCK_SIZE || y >= blocks_y + blocks_h * BLOCK_SIZE)
+    {
+        return Macrocell::NODE_EMPTY;
+    }
+
+    if (level == BLOCK_LEVEL)
+        return blocks[(y - blocks_y) / BLOCK_SIZE * blocks_w + (x - blocks_x) / BLOCK_SIZE];
+
+    int64_t half = size / 2;
+    uint32_t nw  = build_from_blocks(macrocell, blocks, blocks_x, blocks_y, blocks_w, blocks_h, level - 1, x,        y);
+    uint32_t ne  = build_from_blocks(macrocell, blocks, blocks_x, blocks_y, blocks_w, blocks_h, level - 1, x + half, y);
+    uint32_t sw  = build_from_blocks(macrocell, blocks, blocks_x, blocks_y, blocks_w, blocks_h, level - 1, x,        y + half);
+    uint32_t se  = build_from_blocks(macrocell, blocks, blocks_x, blocks_y, blocks_w, blocks_h, level - 1, x + half, y + half);
+    return macrocell.add_node(level, nw, ne, sw, se);
+}
+
+void Macrocell::capture(LifeEngine& engine)
+{
+    clear();
+    m_generation = engine.get_generation();
+    if (engine.get_population() == 0)
+        return;
+
+    int64_t x0, y0, x1, y1;
+    engine.get_bounds(x0, y0, x1, y1);
+
+    // Blocks line up with the quadrants of any root of a higher level.
+    int64_t blocks_x = x0 & ~(int64_t) (BLOCK_SIZE - 1);
+    int64_t blocks_y = y0 & ~(int64_t) (BLOCK_SIZE - 1);
+    int64_t blocks_w = (x1 - blocks_x + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int64_t blocks_h = (y1 - blocks_y + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    assert_with_message(blocks_w * BLOCK_SIZE <= INT32_MAX, "Engine is %lld cells wide, too wide to capture", (long long) (x1 - x0));
+
+    Array<uint32_t> blocks(blocks_w * blocks_h);
+    LifeFrame frame;
+    for (int64_t block_y = 0; block_y < blocks_h; block_y++)
+    {
+        frame.set_region(blocks_x, blocks_y + block_y * BLOCK_SIZE, blocks_w * BLOCK_SIZE, BLOCK_SIZE, 0);
+        engine.capture(frame);
+
+        for (int64_t block_x = 0; block_x < blocks_w; block_x++)
+        {
+            // Leaves first, then joined into levels 4, 5 and 6 in place.
+            uint32_t nodes[8][8];
+            for (int leaf_y = 0; leaf_y < 8; leaf_y++)
+            {
+                for (int leaf_x = 0; leaf_x < 8; leaf_x++)
+                {
+                    uint64_t bits = 0;
+                    for (int row = 0; row < 8; row++)
+                    {
+                        uint64_t word = frame.get_row(leaf_y * 8 + row)[block_x];
+                        bits |= ((word >> (leaf_x * 8)) & 0xFF) << (row * 8);
+                    }
+
+                    nodes[leaf_y][leaf_x] = add_leaf(bits);
+                }
+            }
+
+            for (int level = LEAF_LEVEL + 1, count = 4; level <= BLOCK_LEVEL; level++, count /= 2)
+            {
+                for (int y = 0; y < count; y++)
+                {
+                    for (int x = 0; x < count; x++)
+                    {
+                        nodes[y][x] = add_node(level, nodes[y * 2][x * 2],     nodes[y * 2][x * 2 + 1],
+                                                      nodes[y * 2 + 1][x * 2], nodes[y * 2 + 1][x * 2 + 1]);
+                    }
+                }
+            }
+
+            blocks[block_y * blocks_w + block_x] = nodes[0][0];
+        }
+    }
+
+    // The smallest root centred on the origin that holds every block.
+    int level = BLOCK_LEVEL + 1;
+    while (-(1ll << (level - 1)) > blocks_x || -(1ll << (level - 1)) > blocks_y ||
+           (1ll << (level - 1)) < blocks_x + blocks_w * BLOCK_SIZE || (1ll << (level - 1)) < blocks_y + blocks_h * BLOCK_SIZE)
+    {
+        level++;
+    }
+
+    int64_t half = 1ll << (level - 1);
+    m_root       = build_from_blocks(*this, blocks, blocks_x, blocks_y, blocks_w, blocks_h, level, -half, -half);
+    m_root_level = level;
+}
+
+static void write_node(Macrocell& macrocell, LifeEngine& engine, uint32_t node, int64_t x, int64_t y)
+{
+    if (node == Macrocell::NODE_EMPTY)
+        return;
+
+    MacrocellNode n = macrocell.get_node(node);
+    if (n.level == Macrocell::LEAF_LEVEL)
+    {
+        for (int row = 0; row < 8; row++)
+        {
+            uint64_t word = (n.bits >> (row * 8)) & 0xFF;
+            if (word)
+                engine.set_row(x, y + row, &word, 1);
+        }
+
+        return;
+    }
+
+    int64_t half = 1ll << (n.level - 1);
+    write_node(macrocell, engine, n.nw, x,        y);
+    write_node(macrocell, engine, n.ne, x + half, y);
+    write_node(macrocell, engine, n.sw, x,        y + half);
+    write_node(macrocell, engine, n.se, x + half, y + half);
+}
+
+void Macrocell::write_to(LifeEngine& engine, int64_t x, int64_t y)
+{
+    int64_t half = 1ll << (m_root_level - 1);
+    write_node(*this, engine, m_root, x - half, y - half);
+}
+
+/* ---------------------------------------- Files ------------------------------------- */
+
+bool Macrocell::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1)
+{
+    if (m_root == NODE_EMPTY)
+        return false;
+
+    // Bounds of every node relative to its top left, worked out children first, which is
+    // index order.
+    struct NodeBounds
+    {
+        int64_t x0, y0, x1, y1;
+    };
+
+    size_t num_of_nodes = m_nodes.get_used();
+    Array<NodeBounds> bounds(num_of_nodes);
+    for (size_t i = 1; i < num_of_nodes; i++)
+    {
+        MacrocellNode& node = m_nodes[i];
+        NodeBounds b        = { INT64_MAX, INT64_MAX, INT64_MIN, INT64_MIN };
+
+        if (node.level == LEAF_LEVEL)
+        {
+            for (int cell = 0; cell < 64; cell++)
+            {
+                if ((node.bits >> cell) & 1)
+                {
+                    b.x0 = min<int64_t>(b.x0, cell % 8);
+                    b.y0 = min<int64_t>(b.y0, cell / 8);
+                    b.x1 = max<int64_t>(b.x1, cell % 8 + 1);
+                    b.y1 = max<int64_t>(b.y1, cell / 8 + 1);
+                }
+            }
+        }
+        else
+        {
+            int64_t half         = 1ll << (node.level - 1);
+            uint32_t children[4] = { node.nw, node.ne, node.sw, node.se };
+            for (int q = 0; q < 4; q++)
+            {
+                if (children[q] == NODE_EMPTY)
+                    continue;
+
+                NodeBounds child  = bounds[children[q]];
+                int64_t offset_x  = (q & 1) ? half : 0;
+                int64_t offset_y  = (q >> 1) ? half : 0;
+                b.x0 = min(b.x0, child.x0 + offset_x);
+                b.y0 = min(b.y0, child.y0 + offset_y);
+                b.x1 = max(b.x1, child.x1 + offset_x);
+                b.y1 = max(b.y1, child.y1 + offset_y);
+            }
+        }
+
+        bounds[i] = b;
+    }
+
+    int64_t half = 1ll << (m_root_level - 1);
+    NodeBounds b = bounds[m_root];
+    x0 = b.x0 - half;
+    y0 = b.y0 - half;
+    x1 = b.x1 - half;
+    y1 = b.y1 - half;
+    return true;
+}
+
+bool Macrocell::save(const char* filepath)
+{
+    FileReplacement replacement;
+    if (!replacement.open(filepath))
+        return false;
+
+    FILE* file = replacement.get_file();
+
+    // Only the nodes reachable from the root are written. Parents come after their children
+    // so one pass from the top down finds them all.
+    size_t num_of_nodes = m_nodes.get_used();
+    Array<uint32_t> file_indices(num_of_nodes);
+    file_indices.clear_and_zero();
+    if (m_root != NODE_EMPTY)
+        file_indices[m_root] = 1;
+
+    for (size_t i = num_of_nodes - 1; i > 0; i--)
+    {
+        MacrocellNode& node = m_nodes[i];
+        if (!file_indices[i] || node.level == LEAF_LEVEL)
+            continue;
+
+        file_indices[node.nw] = 1;
+        file_indices[node.ne] = 1;
+        file_indices[node.sw] = 1;
+        file_indices[node.se] = 1;
+    }
+
+    file_indices[NODE_EMPTY] = 0;
+
+    fprintf(file, "[M2] (game-of-life-wasm)\n#R B3/S23\n");
+    if (m_generation)
+        fprintf(file, "#G %llu\n", (unsigned long long) m_generation);
+
+    // Lines are numbered from 1, 0 is the empty square.
+    uint32_t num_of_lines = 0;
+    for (size_t i = 1; i < num_of_nodes; i++)
+    {
+        if (!file_indices[i])
+            continue;
+
+        file_indices[i] = ++num_of_lines;
+        MacrocellNode& node = m_nodes[i];
+
+        if (node.level != LEAF_LEVEL)
+        {
+            fprintf(file, "%d %u %u %u %u\n", node.level, file_indices[node.nw], file_indices[node.ne],
+                    file_indices[node.sw], file_indices[node.se]);
+            continue;
+        }
+
+        // Each row up to its last live cell then $, trailing empty rows are left out.
+        char line[8 * 9 + 2];
+        int length = 0;
+        for (int row = 0; row < 8 && (node.bits >> (row * 8)); row++)
+        {
+            uint64_t row_bits = (node.bits >> (row * 8)) & 0xFF;
+            for (int x = 0; row_bits >> x; x++)
+                line[length++] = (row_bits >> x) & 1 ? '*' : '.';
+
+            line[length++] = '$';
+        }
+
+        line[length++] = '\n';
+        fwrite(line, 1, length, file);
+    }
+
+    return replacement.commit();
+}
+
+/* -------------------------------------- Getters ------------------------------------- */
+
+MacrocellNode& Macrocell::get_node(uint32_t node)
+{
+    return m_nodes[node];
+}
+
+size_t Macrocell::get_num_of_nodes()
+{
+    return m_nodes.get_used();
+}
+
+uint32_t Macrocell::get_root()
+{
+    return m_root;
+}
+
+int Macrocell::get_root_level()
+{
+    return m_root_level;
+}
+
+uint64_t Macrocell::get_population()
+{
+    return m_nodes[m_root].population;
+}
+
+uint64_t Macrocell::get_generation()
+{
+    return m_generation;
+}
+
+/* ------------------------------------ Hash consing ---------------------------------- */
+
+uint32_t Macrocell::add(const MacrocellNode& node)
+{
+    MacrocellNode* nodes = m_nodes.get_underlying_buffer();
+    uint32_t bucket      = hash_node(node) & (m_buckets.get_size() - 1);
+
+    for (uint32_t i = m_buckets[bucket]; i != NODE_EMPTY; i = nodes[i].next)
+    {
+        MacrocellNode& other = nodes[i];
+        if (other.level == node.level && other.bits == node.bits &&
+            other.nw == node.nw && other.ne == node.ne && other.sw == node.sw && other.se == node.se)
+        {
+            return i;
+        }
+    }
+
+    assert_with_message(m_nodes.get_used() < UINT32_MAX, "Macrocell has too many nodes");
+    uint32_t index = m_nodes.get_used();
+
+    MacrocellNode added = node;
+    added.next          = m_buckets[bucket];
+    m_buckets[bucket]   = index;
+    m_nodes.push(added);
+
+    // Keeps the chains about one node long.
+    if (m_nodes.get_used() > m_buckets.get_size())
+        grow_buckets();
+
+    return index;
+}
+
+void Macrocell::grow_buckets()
+{
+    m_buckets.resize(m_buckets.get_size() * 2);
+    m_buckets.clear_and_zero();
+
+    MacrocellNode* nodes = m_nodes.get_underlying_buffer();
+    uint32_t bucket_mask = m_buckets.get_size() - 1;
+    for (size_t i = 1; i < m_nodes.get_used(); i++)
+    {
+        uint32_t bucket   = hash_node(nodes[i]) & bucket_mask;
+        nodes[i].next     = m_buckets[bucket];
+        m_buckets[bucket] = i;
+    }
+}
+
+uint32_t Macrocell::hash_node(const MacrocellNode& node)
+{
+    uint64_t hash = node.level;
+    hash = hash * 0x9E3779B97F4A7C15ull + node.nw;
+    hash = hash * 0x9E3779B97F4A7C15ull + node.ne;
+    hash = hash * 0x9E3779B97F4A7C15ull + node.sw;
+    hash = hash * 0x9E3779B97F4A7C15ull + node.se;
+    return (uint32_t) hash_u64(hash ^ node.bits);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "life.hpp"
+
+struct MacrocellNode
+{
+    // Quadrants of the nodes above the leaves, Macrocell::NODE_EMPTY where there are no
+    // live cells.
+    uint32_t nw, ne, sw, se;
+
+    // The 8x8 cells of a leaf, bit (y * 8 + x) being the cell at (x, y).
+    uint64_t bits;
+
+    uint64_t population;
+    uint32_t next;
+    uint8_t level;
+};
+
+// A universe as a quadtree whose nodes are hash consed, so each distinct square of cells
+// is stored once however many times it repeats. This is what Golly's macrocell (.mc)
+// format stores on disk, one line per distinct node, which keeps huge patterns with
+// regular structure down to kilobytes.
+//
+// Leaves are 8x8 squares of cells, level 3, and a node of level k is a square of
+// (1 << k) cells. As in Golly the root is centred on the origin.
+class Macrocell
+{
+    Array<MacrocellNode> m_nodes;
+    Array<uint32_t> m_buckets;
+    uint32_t m_root;
+    int m_root_level;
+    uint64_t m_generation;
+
+public:
+    static const uint32_t NODE_EMPTY = 0;
+    static const int LEAF_LEVEL      = 3;
+    static const int MAX_LEVEL       = 62;
+
+    Macrocell();
+
+    // Drops every node, leaving an empty universe.
+    void clear();
+
+    // Nodes are only ever added after their children, so indices of children are always
+    // lower than their parent's. Both return NODE_EMPTY for a square with nothing alive.
+    uint32_t add_leaf(uint64_t bits);
+    uint32_t add_node(int level, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+
+    // `level` is the size of the universe, which the root may be empty at.
+    void set_root(uint32_t root, int level);
+    void set_generation(uint64_t generation);
+
+    // Replaces the tree with the live cells of an engine, in the engine's coordinates.
+    // Reads the engine a band of rows at a time through LifeEngine::capture, so it has to
+    // be stopped. Only meant for the flat engines, it visits every cell of their bounds.
+    void capture(LifeEngine& engine);
+
+    // Sets the live cells in `engine` with the origin landing on (x, y).
+    void write_to(LifeEngine& engine, int64_t x, int64_t y);
+
+    // Smallest rectangle [x0, x1) x [y0, y1) around the live cells. False if there are
+    // none.
+    bool get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1);
+
+    // Replaces the file in one go with a FileReplacement.
+    bool save(const char* filepath);
+
+    MacrocellNode& get_node(uint32_t node);
+    size_t get_num_of_nodes();
+    uint32_t get_root();
+    int get_root_level();
+    uint64_t get_population();
+    uint64_t get_generation();
+
+private:
+    uint32_t add(const MacrocellNode& node);
+    void grow_buckets();
+
+    static uint32_t hash_node(const MacrocellNode& node);
+};
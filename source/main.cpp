@@ -1,34 +1,402 @@
 #include "renderer.hpp"
 #include "window.hpp"
+#include "life.hpp"
+#include "hashlife.hpp"
+#include "tiled_life.hpp"
+#include "thread_pool.hpp"
+#include "benchmarks.hpp"
+#include "simulation.hpp"
+#include "pattern.hpp"
+#include "snapshot.hpp"
+#include "history.hpp"
 
 /*
     TODOS:
     
-    HIGH PRIORITY
-    Renderer should batch draw calls.
-
     MEDIUM PRIORITY
     Create platform abstractions for:
         Keyboard management.
         Mouse management.
-        
-    LOW PRIORITY
-    Renderer should handle z ordering gracefully.
 */
 
-int main()
+enum class EngineType
+{
+    ENGINE_GRID,
+    ENGINE_HASHLIFE,
+    ENGINE_TILED
+};
+
+enum Layer : uint8_t
+{
+    LAYER_BOARD,
+    LAYER_HUD
+};
+
+enum class RenderMode
+{
+    RENDER_GRID,
+    RENDER_QUADS
+};
+
+struct Options
+{
+    EngineType engine_type;
+    RenderMode render_mode;
+    uint64_t generations_per_step;
+    uint64_t steps_per_second;
+    size_t hashlife_memory_budget;
+    int num_of_threads;
+    const char* benchmark;
+    const char* pattern_filepath;
+    const char* save_macrocell_filepath;
+    const char* snapshot_filepath;
+    uint64_t snapshot_interval;
+    const char* restore_filepath;
+    size_t history_memory_budget;
+};
+
+static Options parse_options(int argc, char** argv)
+{
+    Options options                 = {};
+    options.engine_type             = EngineType::ENGINE_GRID;
+    options.render_mode             = RenderMode::RENDER_GRID;
+    options.generations_per_step    = 1;
+    options.steps_per_second        = 60;
+    options.hashlife_memory_budget  = 256ull << 20;
+    options.num_of_threads          = 0;
+    options.benchmark               = nullptr;
+    options.pattern_filepath        = nullptr;
+    options.save_macrocell_filepath = nullptr;
+    options.snapshot_filepath       = nullptr;
+    options.snapshot_interval       = 0;
+    options.restore_filepath        = nullptr;
+    options.history_memory_budget   = 256ull << 20;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+
+        if (strcmp(argument, "--self-check") == 0)
+        {
+            uint64_t self_check_seed = 0xBB67AE8584CAA73Bull;
+            bool passed = life_self_check(self_check_seed);
+            printf("%s\n", passed ? "SELF CHECK PASSED" : "SELF CHECK FAILED");
+            exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        else if (strcmp(argument, "--engine=grid") == 0)
+        {
+            options.engine_type = EngineType::ENGINE_GRID;
+        }
+        else if (strcmp(argument, "--engine=hashlife") == 0)
+        {
+            options.engine_type = EngineType::ENGINE_HASHLIFE;
+        }
+        else if (strcmp(argument, "--engine=tiled") == 0)
+        {
+            options.engine_type = EngineType::ENGINE_TILED;
+        }
+        else if (strcmp(argument, "--render=grid") == 0)
+        {
+            options.render_mode = RenderMode::RENDER_GRID;
+        }
+        else if (strcmp(argument, "--render=quads") == 0)
+        {
+            options.render_mode = RenderMode::RENDER_QUADS;
+        }
+        else if (strncmp(argument, "--generations-per-step=", strlen("--generations-per-step=")) == 0)
+        {
+            options.generations_per_step = strtoull(argument + strlen("--generations-per-step="), nullptr, 10);
+        }
+        else if (strncmp(argument, "--steps-per-second=", strlen("--steps-per-second=")) == 0)
+        {
+            options.steps_per_second = strtoull(argument + strlen("--steps-per-second="), nullptr, 10);
+        }
+        else if (strncmp(argument, "--hashlife-memory-mb=", strlen("--hashlife-memory-mb=")) == 0)
+        {
+            options.hashlife_memory_budget = strtoull(argument + strlen("--hashlife-memory-mb="), nullptr, 10) << 20;
+        }
+        else if (strncmp(argument, "--threads=", strlen("--threads=")) == 0)
+        {
+            options.num_of_threads = atoi(argument + strlen("--threads="));
+        }
+        else if (strncmp(argument, "--benchmark=", strlen("--benchmark=")) == 0)
+        {
+            options.benchmark = argument + strlen("--benchmark=");
+        }
+        else if (strncmp(argument, "--pattern=", strlen("--pattern=")) == 0)
+        {
+            options.pattern_filepath = argument + strlen("--pattern=");
+        }
+        else if (strncmp(argument, "--save-macrocell=", strlen("--save-macrocell=")) == 0)
+        {
+            options.save_macrocell_filepath = argument + strlen("--save-macrocell=");
+        }
+        else if (strncmp(argument, "--snapshot=", strlen("--snapshot=")) == 0)
+        {
+            options.snapshot_filepath = argument + strlen("--snapshot=");
+        }
+        else if (strncmp(argument, "--snapshot-every=", strlen("--snapshot-every=")) == 0)
+        {
+            options.snapshot_interval = strtoull(argument + strlen("--snapshot-every="), nullptr, 10);
+        }
+        else if (strncmp(argument, "--restore=", strlen("--restore=")) == 0)
+        {
+            options.restore_filepath = argument + strlen("--restore=");
+        }
+        else if (strncmp(argument, "--history-mb=", strlen("--history-mb=")) == 0)
+        {
+            options.history_memory_budget = strtoull(argument + strlen("--history-mb="), nullptr, 10) << 20;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argument);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (options.restore_filepath && options.pattern_filepath)
+    {
+        fprintf(stderr, "--restore and --pattern both say where to start from, pick one\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.snapshot_interval && !options.snapshot_filepath)
+    {
+        fprintf(stderr, "--snapshot-every needs a --snapshot file to write to\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bool has_snapshots = options.snapshot_filepath || options.restore_filepath;
+    if (has_snapshots && options.engine_type == EngineType::ENGINE_HASHLIFE)
+    {
+        fprintf(stderr, "Snapshots need --engine=grid or --engine=tiled, HashLife is saved with --save-macrocell\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return options;
+}
+
+// Copies a random soup into an unbounded engine, centred on the origin.
+static void seed_soup(LifeEngine& engine, int soup_width, int soup_height, uint64_t soup_seed, float soup_density)
+{
+    LifeGrid soup(soup_width, soup_height);
+    soup.randomize(soup_seed, soup_density);
+    for (int y = 0; y < soup_height; y++)
+    {
+        for (int x = 0; x < soup_width; x++)
+        {
+            if (soup.get_cell(x, y))
+                engine.set_cell(x - soup_width / 2, y - soup_height / 2, true);
+        }
+    }
+}
+
+static void exit_with_pattern_error(const char* filepath, PatternInfo& info)
+{
+    if (info.error)
+        fprintf(stderr, "Could not load pattern %s:%zu: %s\n", filepath, info.error_line, info.error);
+    else
+        fprintf(stderr, "Could not open pattern: %s\n", filepath);
+
+    exit(EXIT_FAILURE);
+}
+
+// Decodes the pattern into the engine with its top left at (x, y).
+static void load_pattern(File& file, const char* filepath, PatternInfo& info, LifeEngine& engine, int64_t x, int64_t y)
+{
+    double start_time = get_time_in_seconds();
+    if (!pattern_load(file, engine, x, y, info))
+        exit_with_pattern_error(filepath, info);
+
+    double time = get_time_in_seconds() - start_time;
+    printf("[STARTUP]: Pattern %s, %s %lldx%lld, %llu cells in %.2f ms (%.1f MB/s)\n",
+           filepath, pattern_get_format_name(info.format), (long long) info.width, (long long) info.height,
+           (unsigned long long) info.num_of_cells, time * 1000, file.get_size() / time / (1024 * 1024));
+}
+
+// Hands the quadtree to HashLife as it is, the cells are never written out one by one.
+static void load_macrocell(File& file, const char* filepath, PatternInfo& info, HashLife& hashlife)
+{
+    double start_time = get_time_in_seconds();
+
+    Macrocell macrocell;
+    if (!pattern_read_macrocell(file, macrocell, info))
+        exit_with_pattern_error(filepath, info);
+
+    if (!hashlife.set_macrocell(macrocell))
+    {
+        fprintf(stderr, "Pattern %s doesn't fit in the HashLife memory budget, try a bigger --hashlife-memory-mb\n", filepath);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[STARTUP]: Pattern %s, macrocell %lldx%lld, %zu nodes, %llu cells in %.2f ms\n",
+           filepath, (long long) info.width, (long long) info.height, macrocell.get_num_of_nodes() - 1,
+           (unsigned long long) info.num_of_cells, (get_time_in_seconds() - start_time) * 1000);
+}
+
+// Writes the universe out as it was when the simulation stopped.
+static void save_macrocell(LifeEngine& engine, EngineType engine_type, const char* filepath)
+{
+    double start_time = get_time_in_seconds();
+
+    Macrocell macrocell;
+    if (engine_type == EngineType::ENGINE_HASHLIFE)
+        static_cast<HashLife&>(engine).get_macrocell(macrocell);
+    else
+        macrocell.capture(engine);
+
+    if (!macrocell.save(filepath))
+    {
+        fprintf(stderr, "Could not save macrocell: %s\n", filepath);
+        return;
+    }
+
+    printf("Saved %s, %zu nodes, %llu cells in %.2f ms\n", filepath, macrocell.get_num_of_nodes() - 1,
+           (unsigned long long) macrocell.get_population(), (get_time_in_seconds() - start_time) * 1000);
+}
+
+// Sets the snapshot's cells in the engine offset by (x, y), and carries on from its
+// generation.
+static void restore_snapshot(File& file, const char* filepath, SnapshotInfo& info, LifeEngine& engine, int64_t x, int64_t y)
 {
+    double start_time = get_time_in_seconds();
+    snapshot_restore(file, engine, x, y, info);
+
+    double time = get_time_in_seconds() - start_time;
+    printf("[STARTUP]: Snapshot %s, generation %llu, %llu tiles, %llu cells in %.2f ms (%.1f MB/s)\n",
+           filepath, (unsigned long long) info.generation, (unsigned long long) info.num_of_tiles,
+           (unsigned long long) info.num_of_cells, time * 1000, file.get_size() / time / (1024 * 1024));
+}
+
+// The last snapshot is written on this thread once the simulation has stopped, after any
+// checkpoint still being written in the background.
+static void save_snapshot(SnapshotWriter& writer, LifeEngine& engine, const char* filepath)
+{
+    writer.wait();
+
+    double start_time = get_time_in_seconds();
+    if (!snapshot_save(engine, filepath))
+    {
+        fprintf(stderr, "Could not save snapshot: %s\n", filepath);
+        return;
+    }
+
+    printf("Saved snapshot %s at generation %llu in %.2f ms, after %zu checkpoints (%zu skipped while writing)\n",
+           filepath, (unsigned long long) engine.get_generation(), (get_time_in_seconds() - start_time) * 1000,
+           writer.get_num_of_saved(), writer.get_num_of_skipped());
+}
+
+// Fits the frame to the window, centred, with square blocks.
+static void get_frame_placement(LifeFrame& frame, int window_w, int window_h, float& block_size, float& offset_x, float& offset_y)
+{
+    block_size = min(window_w / (float) frame.get_width(), window_h / (float) frame.get_height());
+    offset_x   = (window_w - frame.get_width()  * block_size) / 2;
+    offset_y   = (window_h - frame.get_height() * block_size) / 2;
+}
+
+// Scratch for the grid texture's uploads, kept from frame to frame so it only grows.
+struct GridUploads
+{
+    Array<LifeTileRect> tile_rects;
+    Array<Vec4<int>> upload_rects;
+};
+
+// Turns the frame's dirty tiles into rects of bytes and rows of the packed cells.
+static void get_dirty_upload_rects(LifeFrame& frame, Array<LifeTileRect>& tile_rects, Array<Vec4<int>>& upload_rects)
+{
+    frame.get_dirty_tiles().get_rects(tile_rects);
+    upload_rects.clear();
+
+    int bytes_per_tile = LIFE_TILE_SIZE / 8;
+    int bytes_per_row  = frame.get_words_per_row() * sizeof(uint64_t);
+    for (size_t i = 0; i < tile_rects.get_used(); i++)
+    {
+        LifeTileRect tile_rect = tile_rects[i];
+
+        Vec4<int> upload_rect = {};
+        upload_rect.x0 = tile_rect.x0 * bytes_per_tile;
+        upload_rect.y0 = tile_rect.y0 * LIFE_TILE_SIZE;
+        upload_rect.x1 = min(tile_rect.x1 * bytes_per_tile, bytes_per_row);
+        upload_rect.y1 = min(tile_rect.y1 * LIFE_TILE_SIZE, frame.get_height());
+        upload_rects.push(upload_rect);
+    }
+}
+
+static void draw_life_frame(Renderer& renderer, LifeFrame& frame, bool is_new_frame, RenderMode render_mode, GridUploads& grid_uploads,
+                            int window_w, int window_h)
+{
+    float block_size, offset_x, offset_y;
+    get_frame_placement(frame, window_w, window_h, block_size, offset_x, offset_y);
+
+    if (render_mode == RenderMode::RENDER_GRID)
+    {
+        Array<Vec4<int>>& upload_rects = grid_uploads.upload_rects;
+
+        // The texture already holds this frame if it isn't new. The first frame is always
+        // new and all dirty, so the rects have a buffer by the time none are passed.
+        if (is_new_frame)
+            get_dirty_upload_rects(frame, grid_uploads.tile_rects, upload_rects);
+        else
+            upload_rects.clear();
+
+        Vec2<float> pan = { -offset_x / block_size, -offset_y / block_size };
+        int bytes_per_row = frame.get_words_per_row() * sizeof(uint64_t);
+        renderer.draw_grid(frame.get_row(0), bytes_per_row, frame.get_width(), frame.get_height(), pan, block_size, COLOR_WHITE,
+                           upload_rects.get_underlying_buffer(), upload_rects.get_used());
+        return;
+    }
+
+    for (int y = 0; y < frame.get_height(); y++)
+    {
+        uint64_t* row = frame.get_row(y);
+        for (int word_index = 0; word_index < frame.get_words_per_row(); word_index++)
+        {
+            // Walks the set bits only, most of the board is usually dead.
+            uint64_t word = row[word_index];
+            while (word)
+            {
+                int x = word_index * LIFE_CELLS_PER_WORD + __builtin_ctzll(word);
+                word &= word - 1;
+
+                Vec4<float> block_rect = { offset_x + x * block_size,       offset_y + y * block_size,
+                                           offset_x + (x + 1) * block_size, offset_y + (y + 1) * block_size };
+                renderer.draw_rect(block_rect, COLOR_WHITE);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options = parse_options(argc, argv);
+
+    if (options.benchmark)
+    {
+        bool found = run_benchmark(options.benchmark, options.num_of_threads);
+        if (!found)
+            fprintf(stderr, "Unknown benchmark: %s\n", options.benchmark);
+
+        exit(found ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    double startup_start_time = get_time_in_seconds();
+
     // TODO: Someway to pre-determine the correct bitmap dimensions
     //       to hold the font glpyh data.
-    int font_bitmap_width    = 1000;
-    int font_bitmap_height   = 1000;
-    int font_bitmap_channels = 4;
-    Bitmap<uint32_t> font_bitmap(font_bitmap_width, font_bitmap_height, font_bitmap_channels);
+    int font_bitmap_width    = 512;
+    int font_bitmap_height   = 512;
+    int font_bitmap_channels = 1;
+    Bitmap<uint8_t> font_bitmap(font_bitmap_width, font_bitmap_height, font_bitmap_channels);
     
-    float font_size           = 100;
+    // Distance fields at this size stay sharp from well under the HUD's text sizes to
+    // several times over.
+    float font_size           = 32;
     const char* font_filepath = "./assets/JetBrainsMono-Regular.ttf";
     int codepoint_range[]     = {0, 127};
-    Font font(font_bitmap, codepoint_range, font_size, font_filepath);
+    double font_start_time    = get_time_in_seconds();
+    Font font(font_bitmap, codepoint_range, font_size, font_filepath, FontType::FONT_SDF);
+    printf("[STARTUP]: Font %s in %.2f ms\n", font.is_from_cache() ? "loaded from cache" : "rasterized and cached",
+           (get_time_in_seconds() - font_start_time) * 1000);
 
     Renderer renderer(font);
     
@@ -48,17 +416,217 @@ int main()
     renderer.init();
     renderer.set_frame_size(renderer_frame_width, renderer_frame_height);
 
+    uint32_t image_texture = renderer.load_texture("./assets/image.png");
+
+    int soup_width     = 256;
+    int soup_height    = 144;
+    uint64_t soup_seed = 0x6A09E667F3BCC908ull;
+    float soup_density = 0.3f;
+
+    // A pattern replaces the random soup.
+    File pattern_file;
+    PatternInfo pattern_info = {};
+    if (options.pattern_filepath)
+    {
+        if (!pattern_file.open(options.pattern_filepath, FILE_ACCESS_SEQUENTIAL) || !pattern_get_info(pattern_file, pattern_info))
+            exit_with_pattern_error(options.pattern_filepath, pattern_info);
+    }
+
+    // Or a snapshot carries on a run from where it was saved.
+    File snapshot_file;
+    SnapshotInfo snapshot_info = {};
+    if (options.restore_filepath)
+    {
+        if (!snapshot_file.open(options.restore_filepath, FILE_ACCESS_SEQUENTIAL) || !snapshot_get_info(snapshot_file, snapshot_info))
+        {
+            fprintf(stderr, "Could not restore snapshot %s: %s\n", options.restore_filepath,
+                    snapshot_info.error ? snapshot_info.error : "Could not open it");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Only the grid steps on more than one thread.
+    ThreadPool* thread_pool = nullptr;
+
+    LifeEngine* engine = nullptr;
+    switch (options.engine_type)
+    {
+        case EngineType::ENGINE_GRID:
+        {
+            // Grows to fit the pattern, which is centred on it, or the snapshot. A snapshot of
+            // the grid comes back at the size it was saved at.
+            int64_t content_width  = options.restore_filepath ? snapshot_info.x1 - snapshot_info.x0 : pattern_info.width;
+            int64_t content_height = options.restore_filepath ? snapshot_info.y1 - snapshot_info.y0 : pattern_info.height;
+
+            int64_t max_grid_size = 32768;
+            if (content_width > max_grid_size || content_height > max_grid_size)
+            {
+                fprintf(stderr, "%s is %lldx%lld, too big for --engine=grid, try --engine=tiled\n",
+                        options.restore_filepath ? "Snapshot" : "Pattern", (long long) content_width, (long long) content_height);
+                exit(EXIT_FAILURE);
+            }
+
+            int grid_width  = max((int) content_width, soup_width);
+            int grid_height = max((int) content_height, soup_height);
+            grid_width      = (grid_width + LIFE_CELLS_PER_WORD - 1) / LIFE_CELLS_PER_WORD * LIFE_CELLS_PER_WORD;
+
+            LifeGrid* grid = new LifeGrid(grid_width, grid_height);
+            if (options.restore_filepath)
+                restore_snapshot(snapshot_file, options.restore_filepath, snapshot_info, *grid, -snapshot_info.x0, -snapshot_info.y0);
+            else if (options.pattern_filepath)
+                load_pattern(pattern_file, options.pattern_filepath, pattern_info, *grid,
+                             (grid_width - pattern_info.width) / 2, (grid_height - pattern_info.height) / 2);
+            else
+                grid->randomize(soup_seed, soup_density);
+
+            thread_pool = new ThreadPool(options.num_of_threads);
+            grid->set_thread_pool(thread_pool);
+            printf("Using the %s life kernel on %d threads\n", life_get_best_kernel().name, thread_pool->get_num_of_threads());
+            engine = grid;
+        } break;
+
+        case EngineType::ENGINE_HASHLIFE:
+        {
+            // Every other step size would have the memoized results worked out again.
+            uint64_t generations_per_step = 1;
+            while (generations_per_step * 2 <= options.generations_per_step)
+                generations_per_step *= 2;
+
+            if (generations_per_step != options.generations_per_step)
+            {
+                printf("Rounding --generations-per-step down to %llu for HashLife\n", (unsigned long long) generations_per_step);
+                options.generations_per_step = generations_per_step;
+            }
+
+            HashLife* hashlife = new HashLife(options.hashlife_memory_budget);
+            if (options.pattern_filepath && pattern_info.format == PATTERN_MACROCELL)
+                load_macrocell(pattern_file, options.pattern_filepath, pattern_info, *hashlife);
+
+            engine = hashlife;
+        } break;
+
+        case EngineType::ENGINE_TILED:
+        {
+            engine = new TiledLife();
+        } break;
+    }
+
+    bool is_seeded = options.engine_type == EngineType::ENGINE_GRID ||
+                     (options.engine_type == EngineType::ENGINE_HASHLIFE && options.pattern_filepath && pattern_info.format == PATTERN_MACROCELL);
+    if (!is_seeded)
+    {
+        if (options.restore_filepath)
+            restore_snapshot(snapshot_file, options.restore_filepath, snapshot_info, *engine, 0, 0);
+        else if (options.pattern_filepath)
+            load_pattern(pattern_file, options.pattern_filepath, pattern_info, *engine,
+                         -pattern_info.width / 2, -pattern_info.height / 2);
+        else
+            seed_soup(*engine, soup_width, soup_height, soup_seed, soup_density);
+    }
+
+    // The pattern was decoded straight out of the mapping, nothing else needs it.
+    pattern_file.close();
+    snapshot_file.close();
+
+    // HashLife skips ahead too far for a generation by generation history to be of use.
+    bool has_history = options.history_memory_budget && options.engine_type != EngineType::ENGINE_HASHLIFE;
+    LifeHistory history(options.history_memory_budget);
+
+    SnapshotWriter snapshot_writer;
+    Simulation simulation(*engine, options.generations_per_step, options.steps_per_second);
+    simulation.set_view_size(window.get_width(), window.get_height());
+    if (options.snapshot_interval)
+        simulation.set_snapshots(&snapshot_writer, options.snapshot_filepath, options.snapshot_interval);
+    if (has_history)
+        simulation.set_history(&history);
+    simulation.start();
+
+    double fps_start_time   = get_time_in_seconds();
+    int fps_frame_count     = 0;
+    float frames_per_second = 0;
+
+    size_t fps_upload_bytes      = 0;
+    float upload_bytes_per_frame = 0;
+    size_t fps_draw_calls        = 0;
+    float draw_calls_per_frame   = 0;
+    bool is_first_frame          = true;
+
+    // Laid out again only when what they say changes, the stats only every half second.
+    Text generation_text(font, 40);
+    Text stats_text(font, 20);
+    GridUploads grid_uploads;
+
     while (window.is_open())
     {
-        renderer.clear(COLOR_RED);
-        renderer.draw_rect({ 300, 100, 400, 200 }, COLOR_BLACK);
-        renderer.draw_rect({ 100, 100, 200, 200 }, "./assets/image.png");
-        renderer.draw_text(100, 300, 50, "Hello, %s", "Bob");
+        simulation.set_view_size(window.get_width(), window.get_height());
+        bool is_new_frame;
+        LifeFrame& frame = simulation.get_latest_frame(is_new_frame);
+
+        renderer.clear(COLOR_BLACK);
+        renderer.set_layer(LAYER_BOARD);
+
+        draw_life_frame(renderer, frame, is_new_frame, options.render_mode, grid_uploads, window.get_width(), window.get_height());
+
+        // The HUD goes over the board whatever order things are drawn in.
+        renderer.set_layer(LAYER_HUD);
+        renderer.draw_rect({ 10, 10, 60, 60 }, image_texture);
+        generation_text.set_text("Generation %llu%s", (unsigned long long) frame.get_generation(), simulation.is_paused() ? " (paused)" : "");
+        stats_text.set_text("%.0f gen/s \u00B7 %.0f fps \u00B7 %.1f KB uploaded/frame \u00B7 %.0f draw calls/frame",
+                            simulation.get_generations_per_second(), frames_per_second, upload_bytes_per_frame / 1024.0f,
+                            draw_calls_per_frame);
+        renderer.draw_text(70, 50, generation_text);
+        renderer.draw_text(70, 90, stats_text);
+        renderer.draw_text(70, 115, 20, "%zu stream buffer fence waits", renderer.get_num_of_fence_waits());
+        if (has_history)
+        {
+            renderer.draw_text(70, 140, 20, "History from generation %llu to %llu in %.1f MB, left and right to step, space to pause",
+                               (unsigned long long) history.get_oldest_generation(), (unsigned long long) history.get_newest_generation(),
+                               history.get_memory_used() / (1024.0f * 1024.0f));
+        }
 
         window.swap_buffers();
         window.poll_events();
+
+        // Without a history there's nothing to step back to, right still steps forward.
+        int num_of_seek_steps = window.get_num_of_presses(KEY_RIGHT) - (has_history ? window.get_num_of_presses(KEY_LEFT) : 0);
+        if (num_of_seek_steps)
+            simulation.seek(num_of_seek_steps);
+        if (window.get_num_of_presses(KEY_SPACE) % 2)
+            simulation.set_paused(!simulation.is_paused());
+
+        if (is_first_frame)
+        {
+            printf("[STARTUP]: First frame after %.2f ms\n", (get_time_in_seconds() - startup_start_time) * 1000);
+            is_first_frame = false;
+        }
+
+        fps_upload_bytes += renderer.take_grid_bytes_uploaded();
+        fps_draw_calls   += renderer.take_num_of_draw_calls();
+        fps_frame_count++;
+        double current_time = get_time_in_seconds();
+        if (current_time - fps_start_time >= 0.5)
+        {
+            frames_per_second      = fps_frame_count / (current_time - fps_start_time);
+            upload_bytes_per_frame = fps_upload_bytes / (float) fps_frame_count;
+            draw_calls_per_frame   = fps_draw_calls / (float) fps_frame_count;
+            fps_start_time         = current_time;
+            fps_frame_count        = 0;
+            fps_upload_bytes       = 0;
+            fps_draw_calls         = 0;
+        }
     }
 
+    // The engine must outlive the thread stepping it.
+    simulation.stop();
+    if (options.snapshot_filepath)
+        save_snapshot(snapshot_writer, *engine, options.snapshot_filepath);
+
+    if (options.save_macrocell_filepath)
+        save_macrocell(*engine, options.engine_type, options.save_macrocell_filepath);
+
+    delete engine;
+    delete thread_pool;
+
     printf("EXIT_SUCCESS\n");
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,221 @@
+#include "utils.hpp"
+
+static const size_t MAX_POOL_ALIGNMENT = 16;
+
+/* ----------------------------------- HeapAllocator ----------------------------------- */
+
+void* HeapAllocator::allocate(size_t size, size_t alignment)
+{
+    void* memory = nullptr;
+    if (alignment <= alignof(max_align_t))
+        memory = malloc(size);
+    else if (posix_memalign(&memory, alignment, size) != 0)
+        memory = nullptr;
+
+    assert_with_message(memory || size == 0, "Out of memory allocating %zu bytes", size);
+    return memory;
+}
+
+void HeapAllocator::deallocate(void* memory, size_t size)
+{
+    free(memory);
+}
+
+/* --------------------------------------- Arena --------------------------------------- */
+
+Arena::Arena(size_t block_size, Allocator& backing)
+: m_backing(backing)
+, m_block_size(block_size)
+, m_current(nullptr)
+, m_used(0)
+, m_peak_used(0)
+{}
+
+Arena::~Arena()
+{
+    while (m_current)
+    {
+        Block* previous = m_current->previous;
+        release_block(m_current);
+        m_current = previous;
+    }
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+
+    // Offsets are from the block header so the alignment holds for the actual address.
+    size_t offset = 0;
+    if (m_current)
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_current + 1);
+        offset = align_up(base + m_current->used, alignment) - base;
+    }
+
+    if (!m_current || offset + size > m_current->size)
+    {
+        add_block(size + alignment);
+
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_current + 1);
+        offset = align_up(base, alignment) - base;
+    }
+
+    uint8_t* memory = reinterpret_cast<uint8_t*>(m_current + 1) + offset;
+    m_used         += offset + size - m_current->used;
+    m_current->used = offset + size;
+    m_peak_used     = max(m_peak_used, m_used);
+
+    return memory;
+}
+
+void Arena::deallocate(void* memory, size_t size)
+{
+}
+
+void Arena::reset()
+{
+    while (m_current && m_current->previous)
+    {
+        Block* previous = m_current->previous;
+        release_block(m_current);
+        m_current = previous;
+    }
+
+    if (m_current && m_current->size != m_block_size)
+    {
+        release_block(m_current);
+        m_current = nullptr;
+    }
+
+    if (m_current)
+        m_current->used = 0;
+
+    m_used = 0;
+}
+
+size_t Arena::get_used()
+{
+    return m_used;
+}
+
+size_t Arena::get_peak_used()
+{
+    return m_peak_used;
+}
+
+void Arena::add_block(size_t min_size)
+{
+    // Anything bigger than a block gets a block of its own.
+    size_t size  = max(min_size, m_block_size);
+    Block* block = static_cast<Block*>(m_backing.allocate(sizeof(Block) + size, alignof(max_align_t)));
+
+    block->previous = m_current;
+    block->size     = size;
+    block->used     = 0;
+    m_current       = block;
+}
+
+void Arena::release_block(Block* block)
+{
+    m_backing.deallocate(block, sizeof(Block) + block->size);
+}
+
+/* --------------------------------------- Pool --------------------------------------- */
+
+Pool::Pool(size_t object_size, size_t objects_per_block, Allocator& backing)
+: m_backing(backing)
+, m_slot_size(align_up(max(object_size, sizeof(void*)), MAX_POOL_ALIGNMENT))
+, m_slots_per_block(objects_per_block)
+, m_blocks(nullptr)
+, m_free_list(nullptr)
+, m_num_of_allocated(0)
+{
+    assert(objects_per_block > 0);
+}
+
+Pool::~Pool()
+{
+    assert_with_message(m_num_of_allocated == 0, "%zu objects still allocated from the pool", m_num_of_allocated);
+
+    size_t block_size = MAX_POOL_ALIGNMENT + m_slot_size * m_slots_per_block;
+    while (m_blocks)
+    {
+        Block* previous = m_blocks->previous;
+        m_backing.deallocate(m_blocks, block_size);
+        m_blocks = previous;
+    }
+}
+
+void* Pool::allocate(size_t size, size_t alignment)
+{
+    assert_with_message(size <= m_slot_size, "%zu bytes don't fit in a %zu byte pool slot", size, m_slot_size);
+    assert(alignment <= MAX_POOL_ALIGNMENT);
+
+    if (!m_free_list)
+        add_block();
+
+    void* slot  = m_free_list;
+    m_free_list = *static_cast<void**>(slot);
+    m_num_of_allocated++;
+
+    return slot;
+}
+
+void Pool::deallocate(void* memory, size_t size)
+{
+    if (!memory)
+        return;
+
+    assert(m_num_of_allocated > 0);
+
+    *static_cast<void**>(memory) = m_free_list;
+    m_free_list = memory;
+    m_num_of_allocated--;
+}
+
+size_t Pool::get_num_of_allocated()
+{
+    return m_num_of_allocated;
+}
+
+void Pool::add_block()
+{
+    // The header takes a whole alignment unit so the slots after it stay aligned.
+    size_t block_size = MAX_POOL_ALIGNMENT + m_slot_size * m_slots_per_block;
+    Block* block = static_cast<Block*>(m_backing.allocate(block_size, MAX_POOL_ALIGNMENT));
+
+    block->previous = m_blocks;
+    m_blocks        = block;
+
+    uint8_t* slots = reinterpret_cast<uint8_t*>(block) + MAX_POOL_ALIGNMENT;
+    for (size_t i = m_slots_per_block; i-- > 0;)
+    {
+        void* slot = slots + i * m_slot_size;
+        *static_cast<void**>(slot) = m_free_list;
+        m_free_list = slot;
+    }
+}
+
+/* ------------------------------------- Instances ------------------------------------- */
+
+static const size_t PERMANENT_ARENA_BLOCK_SIZE = 8 * 1024 * 1024;
+static const size_t FRAME_ARENA_BLOCK_SIZE     = 4 * 1024 * 1024;
+
+Allocator& get_heap_allocator()
+{
+    static HeapAllocator heap_allocator;
+    return heap_allocator;
+}
+
+Arena& get_permanent_arena()
+{
+    static Arena permanent_arena(PERMANENT_ARENA_BLOCK_SIZE, get_heap_allocator());
+    return permanent_arena;
+}
+
+Arena& get_frame_arena()
+{
+    static Arena frame_arena(FRAME_ARENA_BLOCK_SIZE, get_heap_allocator());
+    return frame_arena;
+}
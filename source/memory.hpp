@@ -0,0 +1,138 @@
+#pragma once
+
+// Everything that needs memory gets it through an Allocator so the strategy can change
+// per use: long lived data goes in the permanent arena, scratch data for a frame in the
+// frame arena, and objects of one size that come and go in a Pool. Only the heap
+// allocator talks to the system, which is the one place a freestanding build has to
+// replace.
+
+/* ------------------------------------- Allocator ------------------------------------- */
+
+class Allocator
+{
+public:
+    virtual ~Allocator() {}
+
+    virtual void* allocate(size_t size, size_t alignment) = 0;
+
+    // `size` must be what was passed to allocate.
+    virtual void deallocate(void* memory, size_t size) = 0;
+};
+
+class HeapAllocator : public Allocator
+{
+public:
+    void* allocate(size_t size, size_t alignment) override;
+    void deallocate(void* memory, size_t size) override;
+};
+
+/* --------------------------------------- Arena --------------------------------------- */
+
+// Linear allocator. Allocating bumps an offset into the current block and a new block is
+// taken from the backing allocator once it's full. Nothing is freed on its own, reset
+// releases everything at once. Not thread safe.
+class Arena : public Allocator
+{
+    struct Block
+    {
+        Block* previous;
+        size_t size;
+        size_t used;
+    };
+
+    Allocator& m_backing;
+    size_t m_block_size;
+    Block* m_current;
+
+    size_t m_used;
+    size_t m_peak_used;
+
+public:
+    Arena(size_t block_size, Allocator& backing);
+    ~Arena();
+
+    void* allocate(size_t size, size_t alignment) override;
+
+    // Does nothing, the memory comes back on reset.
+    void deallocate(void* memory, size_t size) override;
+
+    // Everything allocated so far becomes invalid. The first block is kept for reuse if
+    // it's the normal size, so an arena reset every frame stops touching the backing
+    // allocator once it has warmed up.
+    void reset();
+
+    size_t get_used();
+    size_t get_peak_used();
+
+private:
+    void add_block(size_t min_size);
+    void release_block(Block* block);
+};
+
+/* --------------------------------------- Pool --------------------------------------- */
+
+// Hands out fixed size slots. Freed slots go on a free list threaded through the slots
+// themselves and are reused first, new blocks of slots come from the backing allocator.
+// Not thread safe.
+class Pool : public Allocator
+{
+    struct Block
+    {
+        Block* previous;
+    };
+
+    Allocator& m_backing;
+    size_t m_slot_size;
+    size_t m_slots_per_block;
+    Block* m_blocks;
+    void* m_free_list;
+
+    size_t m_num_of_allocated;
+
+public:
+    Pool(size_t object_size, size_t objects_per_block, Allocator& backing);
+    ~Pool();
+
+    // `size` can't be more than the object size and alignment is at most 16.
+    void* allocate(size_t size, size_t alignment) override;
+    void deallocate(void* memory, size_t size) override;
+
+    size_t get_num_of_allocated();
+
+private:
+    void add_block();
+};
+
+/* ------------------------------------- Instances ------------------------------------- */
+
+Allocator& get_heap_allocator();
+
+// Lives until exit. For things created once at startup, only use on the main thread.
+Arena& get_permanent_arena();
+
+// Reset after every frame is presented, see Window::swap_buffers. Only use on the main
+// thread, and never hold onto anything from it past the current frame.
+Arena& get_frame_arena();
+
+static inline size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Constructs a T in memory from `allocator`. Pair with destroy and the same allocator.
+template<typename T, typename... Args>
+static inline T* create(Allocator& allocator, Args&&... args)
+{
+    void* memory = allocator.allocate(sizeof(T), alignof(T));
+    return new (memory) T(static_cast<Args&&>(args)...);
+}
+
+template<typename T>
+static inline void destroy(Allocator& allocator, T* object)
+{
+    if (!object)
+        return;
+
+    object->~T();
+    allocator.deallocate(object, sizeof(T));
+}
@@ -0,0 +1,799 @@
+#include "pattern.hpp"
+
+// Counts and coordinates past this are treated as a broken file rather than overflowing.
+static const int64_t MAX_PATTERN_SIZE = 1ll << 40;
+
+struct PatternReader
+{
+    const char* cursor;
+    const char* end;
+    size_t line;
+};
+
+/* -------------------------------------- Sinks --------------------------------------- */
+
+// Decoders hand cells to a sink either as runs, or as a word of packed cells starting at
+// x for the plaintext decoder, which reads eight cells at a time.
+
+// Only finds the bounding box, for the formats without a header.
+struct PatternBounds
+{
+    int64_t x0, y0, x1, y1;
+    bool is_empty;
+
+    bool emit(int64_t x, int64_t y, int64_t length)
+    {
+        if (is_empty)
+        {
+            x0 = x;
+            y0 = y;
+            x1 = x + length;
+            y1 = y + 1;
+            is_empty = false;
+            return true;
+        }
+
+        x0 = min(x0, x);
+        y0 = min(y0, y);
+        x1 = max(x1, x + length);
+        y1 = max(y1, y + 1);
+        return true;
+    }
+
+    bool emit_bits(int64_t x, int64_t y, uint64_t bits)
+    {
+        if (!bits)
+            return true;
+
+        int64_t first = x + __builtin_ctzll(bits);
+        int64_t last  = x + LIFE_CELLS_PER_WORD - 1 - __builtin_clzll(bits);
+        return emit(first, y, last - first + 1);
+    }
+};
+
+// Writes into the engine a row at a time. Cells are set in a packed copy of the row being
+// decoded, which goes to the engine in one set_row call once the decoder moves on to
+// another row, so the engine gets whole words instead of a call per run. Patterns too
+// wide for the copy are written run by run.
+class PatternWriter
+{
+    static const int64_t MAX_ROW_WORDS = 1 << 20;
+
+    LifeEngine& m_engine;
+    const PatternInfo& m_info;
+    int64_t m_x;
+    int64_t m_y;
+    uint64_t m_num_of_cells;
+
+    Array<uint64_t> m_row;
+    bool m_has_row;
+    int64_t m_row_y;
+    int64_t m_first_word;
+    int64_t m_last_word;
+
+public:
+    PatternWriter(LifeEngine& engine, const PatternInfo& info, int64_t x, int64_t y)
+    : m_engine(engine)
+    , m_info(info)
+    , m_x(x)
+    , m_y(y)
+    , m_num_of_cells(0)
+    , m_has_row(false)
+    , m_row_y(0)
+    , m_first_word(INT64_MAX)
+    , m_last_word(-1)
+    {
+        // Two extra words, unaligned packed cells can spill into the next one.
+        int64_t num_of_words = info.width / LIFE_CELLS_PER_WORD + 2;
+        if (num_of_words <= MAX_ROW_WORDS)
+        {
+            m_row.resize(num_of_words);
+            m_has_row = true;
+        }
+    }
+
+    bool emit(int64_t run_x, int64_t run_y, int64_t length)
+    {
+        run_x -= m_info.origin_x;
+        run_y -= m_info.origin_y;
+        if (run_x < 0 || run_y < 0 || run_x + length > m_info.width || run_y >= m_info.height)
+            return false;
+
+        m_num_of_cells += length;
+        if (!m_has_row)
+        {
+            m_engine.set_run(m_x + run_x, m_y + run_y, length);
+            return true;
+        }
+
+        move_to_row(run_y);
+        life_set_bits(m_row.get_underlying_buffer(), run_x, length);
+        m_first_word = min(m_first_word, run_x / LIFE_CELLS_PER_WORD);
+        m_last_word  = max(m_last_word, (run_x + length - 1) / LIFE_CELLS_PER_WORD);
+        return true;
+    }
+
+    bool emit_bits(int64_t bits_x, int64_t bits_y, uint64_t bits)
+    {
+        if (!bits)
+            return true;
+
+        int64_t first = bits_x + __builtin_ctzll(bits);
+        int64_t last  = bits_x + LIFE_CELLS_PER_WORD - 1 - __builtin_clzll(bits);
+        bits_x -= m_info.origin_x;
+        bits_y -= m_info.origin_y;
+        if (first < m_info.origin_x || last - m_info.origin_x >= m_info.width || bits_y < 0 || bits_y >= m_info.height)
+            return false;
+
+        // Only the bits before the origin, which are all clear, can be shifted out.
+        if (bits_x < 0)
+        {
+            bits   = bits >> -bits_x;
+            bits_x = 0;
+        }
+
+        m_num_of_cells += __builtin_popcountll(bits);
+        if (!m_has_row)
+        {
+            m_engine.set_row(m_x + bits_x, m_y + bits_y, &bits, 1);
+            return true;
+        }
+
+        move_to_row(bits_y);
+
+        uint64_t* row = m_row.get_underlying_buffer();
+        int64_t word  = bits_x / LIFE_CELLS_PER_WORD;
+        int shift     = bits_x % LIFE_CELLS_PER_WORD;
+        row[word] |= bits << shift;
+        if (shift)
+            row[word + 1] |= bits >> (LIFE_CELLS_PER_WORD - shift);
+
+        m_first_word = min(m_first_word, word);
+        m_last_word  = max(m_last_word, shift ? word + 1 : word);
+        return true;
+    }
+
+    // Writes out the row still being decoded.
+    void flush()
+    {
+        if (m_first_word > m_last_word)
+            return;
+
+        uint64_t* words      = m_row.get_underlying_buffer() + m_first_word;
+        int64_t num_of_words = m_last_word - m_first_word + 1;
+        m_engine.set_row(m_x + m_first_word * LIFE_CELLS_PER_WORD, m_y + m_row_y, words, num_of_words);
+        memset(words, 0, num_of_words * sizeof(uint64_t));
+
+        m_first_word = INT64_MAX;
+        m_last_word  = -1;
+    }
+
+    uint64_t get_num_of_cells()
+    {
+        return m_num_of_cells;
+    }
+
+private:
+    void move_to_row(int64_t row_y)
+    {
+        if (row_y == m_row_y)
+            return;
+
+        flush();
+        m_row_y = row_y;
+    }
+};
+
+/* -------------------------------------- Parsing ------------------------------------- */
+
+static bool fail(PatternReader& reader, PatternInfo& info, const char* error)
+{
+    info.error      = error;
+    info.error_line = reader.line;
+    return false;
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool starts_with(PatternReader& reader, const char* prefix)
+{
+    size_t length = strlen(prefix);
+    return (size_t) (reader.end - reader.cursor) >= length && memcmp(reader.cursor, prefix, length) == 0;
+}
+
+static void skip_spaces(PatternReader& reader)
+{
+    while (reader.cursor < reader.end && (*reader.cursor == ' ' || *reader.cursor == '\t' || *reader.cursor == '\r'))
+        reader.cursor++;
+}
+
+// Leaves the cursor at the start of the next line.
+static void skip_line(PatternReader& reader)
+{
+    const void* newline = memchr(reader.cursor, '\n', reader.end - reader.cursor);
+    reader.cursor = newline ? static_cast<const char*>(newline) + 1 : reader.end;
+    reader.line++;
+}
+
+static bool parse_integer(PatternReader& reader, int64_t& value)
+{
+    skip_spaces(reader);
+
+    bool is_negative = reader.cursor < reader.end && *reader.cursor == '-';
+    if (reader.cursor < reader.end && (*reader.cursor == '-' || *reader.cursor == '+'))
+        reader.cursor++;
+
+    if (reader.cursor == reader.end || !is_digit(*reader.cursor))
+        return false;
+
+    value = 0;
+    while (reader.cursor < reader.end && is_digit(*reader.cursor))
+    {
+        value = value * 10 + (*reader.cursor++ - '0');
+        if (value > MAX_PATTERN_SIZE)
+            return false;
+    }
+
+    if (is_negative)
+        value = -value;
+
+    return true;
+}
+
+static bool expect(PatternReader& reader, char c)
+{
+    skip_spaces(reader);
+    if (reader.cursor == reader.end || *reader.cursor != c)
+        return false;
+
+    reader.cursor++;
+    return true;
+}
+
+/* ---------------------------------------- RLE --------------------------------------- */
+
+// Skips the # comment lines and reads "x = <width>, y = <height>" off the header. The rule
+// is ignored, patterns are always run as B3/S23.
+static bool read_rle_header(PatternReader& reader, PatternInfo& info)
+{
+    while (reader.cursor < reader.end && (*reader.cursor == '#' || *reader.cursor == '\n' || *reader.cursor == '\r'))
+        skip_line(reader);
+
+    int64_t width, height;
+    bool is_header = expect(reader, 'x') && expect(reader, '=') && parse_integer(reader, width) && expect(reader, ',') &&
+                     expect(reader, 'y') && expect(reader, '=') && parse_integer(reader, height);
+    if (!is_header || width < 0 || height < 0)
+        return fail(reader, info, "Missing or broken \"x = ..., y = ...\" header");
+
+    skip_line(reader);
+
+    info.width    = width;
+    info.height   = height;
+    info.origin_x = 0;
+    info.origin_y = 0;
+    return true;
+}
+
+// One pass over the body. Counts are accumulated digit by digit and applied to the tag
+// that follows, so each byte is looked at once.
+template<typename Sink>
+static bool decode_rle_body(PatternReader& reader, PatternInfo& info, Sink& sink)
+{
+    const char* cursor = reader.cursor;
+    const char* end    = reader.end;
+
+    int64_t x     = 0;
+    int64_t y     = 0;
+    int64_t count = 0;
+
+    while (cursor < end)
+    {
+        char c = *cursor++;
+        if (is_digit(c))
+        {
+            count = count * 10 + (c - '0');
+            if (count > MAX_PATTERN_SIZE)
+                break;
+
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\r')
+            continue;
+
+        if (c == '\n')
+        {
+            reader.line++;
+            continue;
+        }
+
+        int64_t run = count ? count : 1;
+        count = 0;
+
+        switch (c)
+        {
+            case 'b':
+            case '.':
+            {
+                x += run;
+            } break;
+
+            case '$':
+            {
+                x  = 0;
+                y += run;
+            } break;
+
+            case '!':
+            {
+                reader.cursor = cursor;
+                return true;
+            } break;
+
+            default:
+            {
+                // o is alive, multi state patterns use other letters for their live states.
+                bool is_alive = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+                if (!is_alive)
+                {
+                    reader.cursor = cursor;
+                    return fail(reader, info, "Unexpected character");
+                }
+
+                if (!sink.emit(x, y, run))
+                {
+                    reader.cursor = cursor;
+                    return fail(reader, info, "Cells outside the size given in the header");
+                }
+
+                x += run;
+            } break;
+        }
+    }
+
+    reader.cursor = cursor;
+    if (count > MAX_PATTERN_SIZE)
+        return fail(reader, info, "Run is too long");
+
+    // Plenty of files in the wild are missing the final !.
+    return true;
+}
+
+/* ------------------------------------- Life 1.06 ------------------------------------ */
+
+// Cells are usually listed row by row, so neighbours on a row are merged into runs.
+template<typename Sink>
+static bool decode_life_106(PatternReader& reader, PatternInfo& info, Sink& sink)
+{
+    int64_t run_x      = 0;
+    int64_t run_y      = 0;
+    int64_t run_length = 0;
+
+    // The "#Life 1.06" line.
+    skip_line(reader);
+
+    while (reader.cursor < reader.end)
+    {
+        skip_spaces(reader);
+        if (reader.cursor == reader.end)
+            break;
+
+        if (*reader.cursor == '\n' || *reader.cursor == '#')
+        {
+            skip_line(reader);
+            continue;
+        }
+
+        int64_t x, y;
+        if (!parse_integer(reader, x) || !parse_integer(reader, y))
+            return fail(reader, info, "Expected an \"x y\" coordinate");
+
+        skip_spaces(reader);
+        if (reader.cursor < reader.end && *reader.cursor != '\n')
+            return fail(reader, info, "Unexpected character");
+
+        skip_line(reader);
+
+        if (run_length && y == run_y && x == run_x + run_length)
+        {
+            run_length++;
+            continue;
+        }
+
+        if (run_length && !sink.emit(run_x, run_y, run_length))
+            return fail(reader, info, "Cells outside the pattern");
+
+        run_x      = x;
+        run_y      = y;
+        run_length = 1;
+    }
+
+    if (run_length && !sink.emit(run_x, run_y, run_length))
+        return fail(reader, info, "Cells outside the pattern");
+
+    return true;
+}
+
+/* ------------------------------------- Plaintext ------------------------------------ */
+
+// High bit of each byte of `chunk` that equals `c`. Exact, no borrows between bytes.
+static inline uint64_t match_bytes(uint64_t chunk, char c)
+{
+    uint64_t x = chunk ^ (0x0101010101010101ull * (uint8_t) c);
+    return ~(((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) & 0x8080808080808080ull;
+}
+
+// Eight bytes of plaintext to eight bits, byte i to bit i. Little endian, so byte i of the
+// chunk is the i-th character.
+static inline uint64_t gather_byte_flags(uint64_t flags)
+{
+    return ((flags >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+// Rows are read eight characters at a time into words of 64 cells, which go to the sink
+// whole. Chunks with anything but cells in them, like a trailing \r, take the slow path.
+template<typename Sink>
+static bool decode_plaintext(PatternReader& reader, PatternInfo& info, Sink& sink)
+{
+    const char* end = reader.end;
+    int64_t y       = 0;
+
+    while (reader.cursor < end)
+    {
+        if (*reader.cursor == '!')
+        {
+            skip_line(reader);
+            continue;
+        }
+
+        const char* cursor   = reader.cursor;
+        const void* newline  = memchr(cursor, '\n', end - cursor);
+        const char* line_end = newline ? static_cast<const char*>(newline) : end;
+
+        int64_t word_x = 0;
+        int bit        = 0;
+        uint64_t word  = 0;
+        while (cursor < line_end)
+        {
+            bool is_chunk_read = false;
+            if (bit % 8 == 0 && line_end - cursor >= 8)
+            {
+                uint64_t chunk;
+                memcpy(&chunk, cursor, sizeof(chunk));
+                uint64_t alive = match_bytes(chunk, 'O') | match_bytes(chunk, '*');
+                uint64_t dead  = match_bytes(chunk, '.');
+
+                is_chunk_read = (alive | dead) == 0x8080808080808080ull;
+                if (is_chunk_read)
+                {
+                    word   |= gather_byte_flags(alive) << bit;
+                    bit    += 8;
+                    cursor += 8;
+                }
+            }
+
+            if (!is_chunk_read)
+            {
+                char c = *cursor++;
+                if (c == 'O' || c == '*')
+                    word |= 1ull << bit++;
+                else if (c == '.')
+                    bit++;
+                else if (c != '\r' && c != ' ' && c != '\t')
+                    return fail(reader, info, "Unexpected character");
+            }
+
+            if (bit == LIFE_CELLS_PER_WORD)
+            {
+                if (!sink.emit_bits(word_x, y, word))
+                    return fail(reader, info, "Cells outside the pattern");
+
+                word_x += LIFE_CELLS_PER_WORD;
+                word    = 0;
+                bit     = 0;
+            }
+        }
+
+        if (!sink.emit_bits(word_x, y, word))
+            return fail(reader, info, "Cells outside the pattern");
+
+        reader.cursor = line_end;
+        skip_line(reader);
+        y++;
+    }
+
+    return true;
+}
+
+/* ------------------------------------- Macrocell ------------------------------------ */
+
+// Leaves are rows of . and * each ended by $, with trailing dead cells and rows left out.
+// Other nodes are "<level> <nw> <ne> <sw> <se>", where quadrants are the number of an
+// earlier node line counting from 1, or 0 when empty. The last node is the root. The rule
+// is ignored like it is for RLE.
+static bool read_macrocell(PatternReader& reader, PatternInfo& info, Macrocell& macrocell)
+{
+    macrocell.clear();
+
+    // The "[M2]" line.
+    skip_line(reader);
+
+    // Node and level of every node line so far, line 0 being the empty square.
+    Array<uint32_t> line_nodes;
+    Array<uint8_t> line_levels;
+    line_nodes.push(Macrocell::NODE_EMPTY);
+    line_levels.push(0);
+
+    while (reader.cursor < reader.end)
+    {
+        skip_spaces(reader);
+        if (reader.cursor == reader.end)
+            break;
+
+        char first = *reader.cursor;
+        if (first == '\n')
+        {
+            skip_line(reader);
+            continue;
+        }
+
+        if (first == '#')
+        {
+            if (starts_with(reader, "#G"))
+            {
+                reader.cursor += strlen("#G");
+                skip_spaces(reader);
+
+                // Generations go well past the sizes parse_integer allows.
+                uint64_t generation = 0;
+                bool is_generation  = reader.cursor < reader.end && is_digit(*reader.cursor);
+                while (reader.cursor < reader.end && is_digit(*reader.cursor))
+                {
+                    uint64_t digit = *reader.cursor++ - '0';
+                    is_generation  = is_generation && generation <= (UINT64_MAX - digit) / 10;
+                    generation     = generation * 10 + digit;
+                }
+
+                if (!is_generation)
+                    return fail(reader, info, "Broken \"#G <generation>\" line");
+
+                macrocell.set_generation(generation);
+            }
+
+            skip_line(reader);
+            continue;
+        }
+
+        if (first == '.' || first == '*' || first == '$')
+        {
+            uint64_t bits = 0;
+            int x         = 0;
+            int y         = 0;
+            for (; reader.cursor < reader.end && *reader.cursor != '\n'; reader.cursor++)
+            {
+                char c = *reader.cursor;
+                if (c == '$')
+                {
+                    x = 0;
+                    y++;
+                }
+                else if (c == '.' || c == '*')
+                {
+                    if (x >= 8 || y >= 8)
+                        return fail(reader, info, "Leaf cells outside their 8x8 square");
+
+                    if (c == '*')
+                        bits |= 1ull << (y * 8 + x);
+                    x++;
+                }
+                else if (c != '\r' && c != ' ' && c != '\t')
+                {
+                    return fail(reader, info, "Unexpected character");
+                }
+            }
+
+            line_nodes.push(macrocell.add_leaf(bits));
+            line_levels.push(Macrocell::LEAF_LEVEL);
+            skip_line(reader);
+            continue;
+        }
+
+        int64_t level;
+        int64_t quadrants[4];
+        bool is_node = parse_integer(reader, level) && parse_integer(reader, quadrants[0]) && parse_integer(reader, quadrants[1]) &&
+                       parse_integer(reader, quadrants[2]) && parse_integer(reader, quadrants[3]);
+        if (!is_node)
+            return fail(reader, info, "Expected a leaf or a \"<level> <nw> <ne> <sw> <se>\" node");
+
+        // Multi state rules have leaves of level 1 with a state per cell instead.
+        if (level <= Macrocell::LEAF_LEVEL || level > Macrocell::MAX_LEVEL)
+            return fail(reader, info, level == 1 ? "Only two state macrocells are supported" : "Node level out of range");
+
+        uint32_t quadrant_nodes[4];
+        for (int q = 0; q < 4; q++)
+        {
+            if (quadrants[q] < 0 || (size_t) quadrants[q] >= line_nodes.get_used())
+                return fail(reader, info, "Node refers to a line that isn't before it");
+
+            if (quadrants[q] && line_levels[quadrants[q]] != level - 1)
+                return fail(reader, info, "Node's quadrants aren't one level below it");
+
+            quadrant_nodes[q] = line_nodes[quadrants[q]];
+        }
+
+        skip_spaces(reader);
+        if (reader.cursor < reader.end && *reader.cursor != '\n')
+            return fail(reader, info, "Unexpected character");
+
+        line_nodes.push(macrocell.add_node(level, quadrant_nodes[0], quadrant_nodes[1], quadrant_nodes[2], quadrant_nodes[3]));
+        line_levels.push((uint8_t) level);
+        skip_line(reader);
+    }
+
+    size_t root_line = line_nodes.get_used() - 1;
+    if (root_line)
+        macrocell.set_root(line_nodes[root_line], line_levels[root_line]);
+
+    return true;
+}
+
+/* --------------------------------------- API ---------------------------------------- */
+
+template<typename Sink>
+static bool decode(PatternReader& reader, PatternInfo& info, Sink& sink)
+{
+    switch (info.format)
+    {
+        case PATTERN_RLE:       return read_rle_header(reader, info) && decode_rle_body(reader, info, sink);
+        case PATTERN_LIFE_106:  return decode_life_106(reader, info, sink);
+        case PATTERN_PLAINTEXT: return decode_plaintext(reader, info, sink);
+
+        // Read whole into a Macrocell rather than decoded cell by cell.
+        case PATTERN_MACROCELL: invalid_code_path;
+    }
+
+    invalid_code_path;
+}
+
+static PatternReader get_reader(File& file)
+{
+    PatternReader reader = {};
+    reader.cursor = static_cast<const char*>(file.get_data());
+    reader.end    = reader.cursor + file.get_size();
+    reader.line   = 1;
+    return reader;
+}
+
+bool pattern_get_info(File& file, PatternInfo& info)
+{
+    info = {};
+    PatternReader reader = get_reader(file);
+
+    if (starts_with(reader, "[M2]"))
+    {
+        info.format = PATTERN_MACROCELL;
+    }
+    else if (starts_with(reader, "#Life 1.06"))
+    {
+        info.format = PATTERN_LIFE_106;
+    }
+    else if (starts_with(reader, "#Life"))
+    {
+        return fail(reader, info, "Only Life 1.06 of the #Life formats is supported");
+    }
+    else
+    {
+        // RLE starts with # comments and then its header, plaintext with ! comments or
+        // straight away with cells.
+        PatternReader start = reader;
+        while (reader.cursor < reader.end && (*reader.cursor == '#' || *reader.cursor == '\n' || *reader.cursor == '\r'))
+            skip_line(reader);
+        skip_spaces(reader);
+
+        char first = reader.cursor < reader.end ? *reader.cursor : '\0';
+        if (first == 'x')
+            info.format = PATTERN_RLE;
+        else if (first == '!' || first == '.' || first == 'O' || first == '*')
+            info.format = PATTERN_PLAINTEXT;
+        else
+            return fail(reader, info, "Unknown pattern format");
+
+        reader = start;
+    }
+
+    if (info.format == PATTERN_RLE)
+        return read_rle_header(reader, info);
+
+    if (info.format == PATTERN_MACROCELL)
+    {
+        Macrocell macrocell;
+        if (!read_macrocell(reader, info, macrocell))
+            return false;
+
+        int64_t x0, y0, x1, y1;
+        if (macrocell.get_bounds(x0, y0, x1, y1))
+        {
+            info.origin_x = x0;
+            info.origin_y = y0;
+            info.width    = x1 - x0;
+            info.height   = y1 - y0;
+        }
+
+        return true;
+    }
+
+    PatternBounds bounds = {};
+    bounds.is_empty      = true;
+    if (!decode(reader, info, bounds))
+        return false;
+
+    if (!bounds.is_empty)
+    {
+        info.origin_x = bounds.x0;
+        info.origin_y = bounds.y0;
+        info.width    = bounds.x1 - bounds.x0;
+        info.height   = bounds.y1 - bounds.y0;
+    }
+
+    return true;
+}
+
+bool pattern_load(File& file, LifeEngine& engine, int64_t x, int64_t y, PatternInfo& info)
+{
+    PatternReader reader = get_reader(file);
+
+    info.error      = nullptr;
+    info.error_line = 0;
+
+    // The tree is small however large the pattern is, so it's read whole and then written
+    // out leaf by leaf.
+    if (info.format == PATTERN_MACROCELL)
+    {
+        Macrocell macrocell;
+        if (!read_macrocell(reader, info, macrocell))
+            return false;
+
+        macrocell.write_to(engine, x - info.origin_x, y - info.origin_y);
+        info.num_of_cells = macrocell.get_population();
+        return true;
+    }
+
+    PatternWriter writer(engine, info, x, y);
+
+    bool result = decode(reader, info, writer);
+    writer.flush();
+
+    info.num_of_cells = writer.get_num_of_cells();
+    return result;
+}
+
+bool pattern_read_macrocell(File& file, Macrocell& macrocell, PatternInfo& info)
+{
+    assert(info.format == PATTERN_MACROCELL);
+
+    PatternReader reader = get_reader(file);
+    info.error      = nullptr;
+    info.error_line = 0;
+
+    if (!read_macrocell(reader, info, macrocell))
+        return false;
+
+    info.num_of_cells = macrocell.get_population();
+    return true;
+}
+
+const char* pattern_get_format_name(PatternFormat format)
+{
+    switch (format)
+    {
+        case PATTERN_RLE:       return "RLE";
+        case PATTERN_LIFE_106:  return "Life 1.06";
+        case PATTERN_PLAINTEXT: return "plaintext";
+        case PATTERN_MACROCELL: return "macrocell";
+    }
+
+    invalid_code_path;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "macrocell.hpp"
+
+enum PatternFormat
+{
+    // Run length encoded, the usual format for large patterns. "x = 3, y = 3" header, then
+    // rows of <count>b for dead and <count>o for live cells, separated by $ and ended by !.
+    PATTERN_RLE,
+
+    // "#Life 1.06" then one "x y" line per live cell.
+    PATTERN_LIFE_106,
+
+    // Plaintext, also known as .cells. One line per row, . for dead and O for live cells,
+    // comment lines start with !.
+    PATTERN_PLAINTEXT,
+
+    // Golly's macrocell format, "[M2]" then a hash consed quadtree one node per line. See
+    // Macrocell.
+    PATTERN_MACROCELL,
+};
+
+struct PatternInfo
+{
+    PatternFormat format;
+
+    // Bounding box of the pattern. RLE has it in its header, the other formats are
+    // decoded once without writing anything to find it.
+    int64_t width;
+    int64_t height;
+
+    // Where the bounding box starts in the file's own coordinates. Only Life 1.06 and
+    // macrocells have coordinates that aren't relative to the top left.
+    int64_t origin_x;
+    int64_t origin_y;
+
+    // Live cells written by pattern_load.
+    uint64_t num_of_cells;
+
+    // Why the last call failed, and on which line.
+    const char* error;
+    size_t error_line;
+};
+
+// Works out the format from the contents and the size of the pattern.
+bool pattern_get_info(File& file, PatternInfo& info);
+
+// Decodes the pattern straight into `engine` with its top left at (x, y). `info` must come
+// from pattern_get_info on the same file. Only the row being decoded is kept, packed, and
+// goes to the engine with LifeEngine::set_row once the decoder moves on to another one, so
+// memory use is at most a row however tall the pattern is. Patterns wider than 1M words
+// (8 MB) a row skip the copy and write each run or word as it's decoded. Cells outside the
+// size from the header are an error rather than being written past it.
+bool pattern_load(File& file, LifeEngine& engine, int64_t x, int64_t y, PatternInfo& info);
+
+// Reads a macrocell file into a quadtree as it is, for the engines that can take one
+// without every cell being written out.
+bool pattern_read_macrocell(File& file, Macrocell& macrocell, PatternInfo& info);
+
+const char* pattern_get_format_name(PatternFormat format);
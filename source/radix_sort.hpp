@@ -0,0 +1,69 @@
+#pragma once
+
+// Sorts `count` 64-bit keys together with a 32-bit value each, e.g. the index of what the
+// key belongs to. Least significant byte first, one counting pass per byte, so it's
+// stable and linear in `count`. Bytes that are the same in every key are skipped, which
+// for sort keys built from a few small fields is most of them.
+//
+// The scratch buffers must hold `count` entries. The result always ends up back in
+// `keys` and `values`.
+static inline void radix_sort(uint64_t* keys, uint32_t* values, size_t count, uint64_t* scratch_keys, uint32_t* scratch_values)
+{
+    static const int RADIX_BITS    = 8;
+    static const int RADIX_SIZE    = 1 << RADIX_BITS;
+    static const int NUM_OF_PASSES = 64 / RADIX_BITS;
+
+    if (count < 2)
+        return;
+
+    // Every histogram in one go, saves reading the keys once per pass.
+    size_t histograms[NUM_OF_PASSES][RADIX_SIZE] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = keys[i];
+        for (int pass = 0; pass < NUM_OF_PASSES; pass++)
+            histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+
+    uint64_t* src_keys   = keys;
+    uint32_t* src_values = values;
+    uint64_t* dst_keys   = scratch_keys;
+    uint32_t* dst_values = scratch_values;
+
+    for (int pass = 0; pass < NUM_OF_PASSES; pass++)
+    {
+        size_t* histogram = histograms[pass];
+        int shift         = pass * RADIX_BITS;
+
+        if (histogram[(src_keys[0] >> shift) & (RADIX_SIZE - 1)] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < RADIX_SIZE; digit++)
+        {
+            size_t digit_count = histogram[digit];
+            histogram[digit]   = offset;
+            offset            += digit_count;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t destination      = histogram[(src_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            dst_keys[destination]   = src_keys[i];
+            dst_values[destination] = src_values[i];
+        }
+
+        uint64_t* swap_keys   = src_keys;
+        uint32_t* swap_values = src_values;
+        src_keys   = dst_keys;
+        src_values = dst_values;
+        dst_keys   = swap_keys;
+        dst_values = swap_values;
+    }
+
+    if (src_keys != keys)
+    {
+        memcpy(keys,   src_keys,   count * sizeof(uint64_t));
+        memcpy(values, src_values, count * sizeof(uint32_t));
+    }
+}
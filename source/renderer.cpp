@@ -1,95 +1,341 @@
 #include "renderer.hpp"
 #include "shaders.hpp"
 #include "utils.hpp"
+#include "radix_sort.hpp"
 
-Font::Font(Bitmap<uint32_t>& bitmap, int codepoint_range[2], float font_size, const char* filepath)
+Font::Font(Bitmap<uint8_t>& bitmap, int codepoint_range[2], float font_size, const char* filepath, FontType type)
 : m_bitmap(bitmap)
+, m_pixels(nullptr)
+, m_is_from_cache(false)
 , m_font_size(font_size)
 , m_filepath(filepath)
+, m_type(type)
 , m_first_codepoint(codepoint_range[0])
 , m_last_codepoint(codepoint_range[1])
+, m_atlas(nullptr)
+, m_atlas_page(-1)
+, m_atlas_page_size(bitmap.get_width())
+, m_font_file(filepath)
+, m_font_info()
+, m_lazy_region()
+, m_lazy_cell_size(0)
+, m_lazy_cells_per_row(0)
+, m_lazy_glyph_slots(64)
+, m_frame_index(0)
+, m_epoch(0)
 {
+    assert(m_bitmap.get_channels() == 1);
 
-    int grayscale_channels      = 1;
-    int grayscale_bitmap_width  = m_bitmap.get_width();
-    int grayscale_bitmap_height = m_bitmap.get_height();
-    Bitmap<uint8_t> grayscale_bitmap(grayscale_bitmap_width, grayscale_bitmap_height, grayscale_channels);
+    int num_of_codepoints = m_last_codepoint - m_first_codepoint + 1;
+    m_packedchars.resize(num_of_codepoints);
+
+    char cache_filepath[1024];
+    snprintf(cache_filepath, sizeof(cache_filepath), "%s.fontcache", filepath);
+
+    FontCacheKey cache_key    = {};
+    cache_key.font_file_hash  = FontCache::hash_font_file(m_font_file);
+    cache_key.font_type       = (int) m_type;
+    cache_key.font_size       = font_size;
+    cache_key.first_codepoint = m_first_codepoint;
+    cache_key.last_codepoint  = m_last_codepoint;
+    cache_key.bitmap_width    = m_bitmap.get_width();
+    cache_key.bitmap_height   = m_bitmap.get_height();
 
-    stbtt_pack_context pack_context        = {};
-    uint8_t* grayscale_bitmap_pixels = static_cast<uint8_t*>(grayscale_bitmap.get_pixel_buffer());
-    int grayscale_bitmap_stride            = grayscale_bitmap.get_stride();
-    int padding                            = 1;
+    if (m_cache.open(cache_filepath, cache_key))
+    {
+        memcpy(m_packedchars.get_underlying_buffer(), m_cache.get_glyphs(), num_of_codepoints * sizeof(stbtt_packedchar));
+        m_pixels        = m_cache.get_pixels();
+        m_is_from_cache = true;
+        return;
+    }
+
+    const uint8_t* font_data = static_cast<const uint8_t*>(m_font_file.get_data());
+
+    switch (m_type)
+    {
+        case FontType::FONT_BITMAP: rasterize_bitmap(font_data, num_of_codepoints); break;
+        case FontType::FONT_SDF:    rasterize_sdf(font_data, num_of_codepoints);    break;
+    }
+
+    m_pixels = m_bitmap.get_pixel_buffer();
+
+    // Not having a cache only makes the next launch slower.
+    if (!FontCache::save(cache_filepath, cache_key, m_packedchars.get_underlying_buffer(), num_of_codepoints, m_pixels))
+        fprintf(stderr, "Could not write font cache: %s\n", cache_filepath);
+}
+
+void Font::rasterize_bitmap(const uint8_t* font_data, int num_of_codepoints)
+{
+    stbtt_pack_context pack_context = {};
+    int padding                     = 1;
 
     stbtt_PackBegin(&pack_context,
-                    grayscale_bitmap_pixels,
-                    grayscale_bitmap_width,
-                    grayscale_bitmap_height,
-                    grayscale_bitmap_stride,
+                    m_bitmap.get_pixel_buffer(),
+                    m_bitmap.get_width(),
+                    m_bitmap.get_height(),
+                    m_bitmap.get_stride(),
                     padding,
                     nullptr);
 
-    File font_file(filepath);;
-    uint8_t* font_data = static_cast<uint8_t*>(font_file.get_data());
-    int font_index           = 0;
-    int num_of_codepoints    = m_last_codepoint - m_first_codepoint + 1;
-    m_packedchars.resize(num_of_codepoints);
-
+    int font_index = 0;
     stbtt_PackFontRange(&pack_context,
                         font_data,
                         font_index,
-                        font_size,
+                        m_font_size,
                         m_first_codepoint,
                         num_of_codepoints,
                         m_packedchars.get_underlying_buffer());
     
     stbtt_PackEnd(&pack_context);
+}
 
-    m_bitmap.copy_grayscale_as_rgba(grayscale_bitmap);
+// Same layout as rasterize_bitmap produces, the offsets and rects just include the
+// padding the fields extend into, so text is laid out the same way either way.
+void Font::rasterize_sdf(const uint8_t* font_data, int num_of_codepoints)
+{
+    stbtt_fontinfo font_info = {};
+    int font_offset = stbtt_GetFontOffsetForIndex(font_data, 0);
+    int result      = stbtt_InitFont(&font_info, font_data, font_offset);
+    assert_with_message(result, "Failed to read font %s", m_filepath);
+
+    float scale            = stbtt_ScaleForPixelHeight(&font_info, m_font_size);
+    float pixel_dist_scale = (float) SDF_ON_EDGE_VALUE / SDF_PADDING;
+
+    int bitmap_width  = m_bitmap.get_width();
+    int bitmap_height = m_bitmap.get_height();
+    uint8_t* pixels   = m_bitmap.get_pixel_buffer();
+
+    stbrp_context packer = {};
+    Array<stbrp_node> packer_nodes(bitmap_width, get_frame_arena());
+    stbrp_init_target(&packer, bitmap_width, bitmap_height, packer_nodes.get_underlying_buffer(), bitmap_width);
+
+    for (int i = 0; i < num_of_codepoints; i++)
+    {
+        int codepoint = m_first_codepoint + i;
+
+        stbtt_packedchar& glyph = m_packedchars[i];
+        glyph = {};
+
+        int advance, left_side_bearing;
+        stbtt_GetCodepointHMetrics(&font_info, codepoint, &advance, &left_side_bearing);
+        glyph.xadvance = advance * scale;
+
+        int glyph_w, glyph_h, glyph_x_offset, glyph_y_offset;
+        uint8_t* field = stbtt_GetCodepointSDF(&font_info, scale, codepoint, SDF_PADDING, SDF_ON_EDGE_VALUE, pixel_dist_scale,
+                                               &glyph_w, &glyph_h, &glyph_x_offset, &glyph_y_offset);
+
+        // Nothing to draw for whitespace.
+        if (!field)
+            continue;
+
+        stbrp_rect rect = {};
+        rect.w = glyph_w + 1;
+        rect.h = glyph_h + 1;
+        bool is_packed = stbrp_pack_rects(&packer, &rect, 1);
+        assert_with_message(is_packed, "The glyphs of %s don't fit in a %dx%d bitmap", m_filepath, bitmap_width, bitmap_height);
+
+        for (int y = 0; y < glyph_h; y++)
+            memcpy(&pixels[(size_t) (rect.y + y) * bitmap_width + rect.x], &field[y * glyph_w], glyph_w);
+
+        stbtt_FreeSDF(field, nullptr);
+
+        glyph.x0    = rect.x;
+        glyph.y0    = rect.y;
+        glyph.x1    = rect.x + glyph_w;
+        glyph.y1    = rect.y + glyph_h;
+        glyph.xoff  = glyph_x_offset;
+        glyph.yoff  = glyph_y_offset;
+        glyph.xoff2 = glyph_x_offset + glyph_w;
+        glyph.yoff2 = glyph_y_offset + glyph_h;
+    }
 }
 
-Font::~Font()
+FontType Font::get_type()
 {
-    memset(this, 0, sizeof(*this));
+    return m_type;
 }
 
-Bitmap<uint32_t>& Font::get_bitmap()
+bool Font::is_from_cache()
 {
-    return m_bitmap;
+    return m_is_from_cache;
+}
+
+void Font::place_in_atlas(TextureAtlas& atlas)
+{
+    if (is_placed_in_atlas())
+        return;
+
+    int bitmap_width = m_bitmap.get_width();
+
+    m_atlas_page_size = atlas.get_page_size();
+
+    // Tallest first, the order stb_rect_pack itself uses, which packs the glyphs about as
+    // tightly as the bitmap they were rasterized into.
+    size_t num_of_glyphs = m_packedchars.get_size();
+    Array<uint32_t> glyph_order(num_of_glyphs, get_frame_arena());
+    for (size_t i = 0; i < num_of_glyphs; i++)
+    {
+        size_t j = i;
+        int glyph_h = m_packedchars[i].y1 - m_packedchars[i].y0;
+        while (j > 0 && m_packedchars[glyph_order[j - 1]].y1 - m_packedchars[glyph_order[j - 1]].y0 < glyph_h)
+        {
+            glyph_order[j] = glyph_order[j - 1];
+            j--;
+        }
+
+        glyph_order[j] = (uint32_t) i;
+    }
+
+    for (size_t i = 0; i < num_of_glyphs; i++)
+    {
+        stbtt_packedchar& glyph = m_packedchars[glyph_order[i]];
+        int glyph_w = glyph.x1 - glyph.x0;
+        int glyph_h = glyph.y1 - glyph.y0;
+
+        // Nothing to draw for whitespace.
+        if (glyph_w == 0 || glyph_h == 0)
+            continue;
+
+        AtlasRegion region;
+        const uint8_t* glyph_pixels = &m_pixels[(size_t) glyph.y0 * bitmap_width + glyph.x0];
+        bool is_inserted = atlas.insert(glyph_w, glyph_h, glyph_pixels, bitmap_width, region);
+        assert_with_message(is_inserted, "No room in the atlas for the glyphs of %s", m_filepath);
+
+        if (m_atlas_page == -1)
+            m_atlas_page = region.page;
+
+        assert_with_message(region.page == m_atlas_page, "The glyphs of %s don't fit on one atlas page", m_filepath);
+
+        glyph.x0 = region.x0;
+        glyph.y0 = region.y0;
+        glyph.x1 = region.x1;
+        glyph.y1 = region.y1;
+    }
+
+    if (m_atlas_page == -1)
+        m_atlas_page = 0;
+
+    m_atlas = &atlas;
+
+    // Cells fit the tallest glyph of the font plus the fields' padding, and a texel of
+    // clear border so filtering doesn't pick up the neighbouring cell.
+    int glyph_padding = m_type == FontType::FONT_SDF ? SDF_PADDING : 0;
+    m_lazy_cell_size  = (int) (m_font_size * 1.25f) + 1 + glyph_padding * 2 + 1;
+
+    bool is_reserved = atlas.reserve(LAZY_GLYPH_REGION_SIZE, LAZY_GLYPH_REGION_SIZE, m_lazy_region) &&
+                       m_lazy_region.page == m_atlas_page;
+    if (!is_reserved)
+    {
+        // The region can't be released, but this only happens with fonts too large for the
+        // atlas, where every glyph outside the range falls back instead.
+        fprintf(stderr, "No room in the atlas for glyphs outside the range of %s\n", m_filepath);
+        m_lazy_cell_size = 0;
+        return;
+    }
+
+    m_lazy_cells_per_row = LAZY_GLYPH_REGION_SIZE / m_lazy_cell_size;
+    m_lazy_glyphs.resize(m_lazy_cells_per_row * m_lazy_cells_per_row);
+    m_lazy_cell_pixels.resize(m_lazy_cell_size * m_lazy_cell_size);
+}
+
+bool Font::is_placed_in_atlas()
+{
+    return m_atlas_page != -1;
+}
+
+int Font::get_atlas_page()
+{
+    assert_with_message(m_atlas_page != -1, "Font %s was never placed in an atlas", m_filepath);
+    return m_atlas_page;
+}
+
+int Font::get_atlas_page_size()
+{
+    return m_atlas_page_size;
+}
+
+Text::Text(Font& font, float text_size, Allocator& allocator)
+: m_font(&font)
+, m_text_size(text_size)
+, m_size({ 0, text_size })
+, m_length(0)
+, m_glyph_quads(TEXT_MAX, allocator)
+, m_has_lazy_glyphs(false)
+, m_font_epoch(0)
+{
+    m_string[0] = '\0';
 }
 
 Text::Text(Font& font, float text_size, const char* format, ...)
-: m_text_size(text_size)
-, m_font(font)
+: Text(font, text_size)
 {
     va_list va_list;
     va_start(va_list, format);
-    init_text_with_va_list(font, text_size, format, va_list);
+    set_text_with_va_list(format, va_list);
     va_end(va_list);
 }
 
-Text::Text(Font& font, float text_size, const char* format, va_list va_list)
-: m_text_size(text_size)
-, m_font(font)
+bool Text::set_text(const char* format, ...)
 {
-    init_text_with_va_list(font, text_size, format, va_list);
+    va_list va_list;
+    va_start(va_list, format);
+    bool is_laid_out = set_text_with_va_list(format, va_list);
+    va_end(va_list);
+
+    return is_laid_out;
 }
 
-void Text::init_text_with_va_list(Font& font, float text_size, const char* format, va_list va_list)
+bool Text::set_text_with_va_list(const char* format, va_list va_list)
 {
-    Array<char> buffer(TEXT_MAX);
-    m_length = vsnprintf(buffer.get_underlying_buffer(), TEXT_MAX-1, format, va_list);
-    m_glyph_rects.resize(m_length);
-    m_glyph_tex_coords.resize(m_length);
+    char string[TEXT_MAX];
+    int length = vsnprintf(string, TEXT_MAX, format, va_list);
+    return set(*m_font, m_text_size, string, min(max(length, 0), TEXT_MAX - 1));
+}
+
+bool Text::set_size(float text_size)
+{
+    return set(*m_font, text_size, m_string, m_length);
+}
 
-    float x       = 0;
-    float y       = 0;
-    float scaling = text_size / font.get_font_size();
+bool Text::set(Font& font, float text_size, const char* string, int length)
+{
+    assert(length >= 0 && length < TEXT_MAX);
+
+    bool is_same = m_font == &font && m_text_size == text_size && m_length == length &&
+                   memcmp(m_string, string, length) == 0;
+    if (is_same)
+        return false;
+
+    // `string` may be this text's own.
+    memmove(m_string, string, length);
+    m_string[length] = '\0';
+    m_length         = length;
+    m_font           = &font;
+    m_text_size      = text_size;
+
+    layout();
+    return true;
+}
 
-    // TODO: If we support unicode then we'll have to alter this slightly.
-    for (size_t i = 0; i < m_length; i++) 
+void Text::layout()
+{
+    assert_with_message(m_font->is_placed_in_atlas(), "Text laid out before its font was given to the renderer");
+    m_glyph_quads.clear();
+    m_has_lazy_glyphs = false;
+
+    float x         = 0;
+    float y         = 0;
+    float scaling   = m_text_size / m_font->get_font_size();
+    float page_size = (float) m_font->get_atlas_page_size();
+    uint16_t flags  = m_font->get_type() == FontType::FONT_SDF ? QUAD_FLAG_SDF : 0;
+
+    const char* cursor     = m_string;
+    const char* string_end = m_string + m_length;
+    while (cursor < string_end)
     {
-        char character         = buffer[i];
-        stbtt_packedchar glyph = m_font.get_glyph(character);
+        uint32_t codepoint     = utf8_next(cursor, string_end);
+        stbtt_packedchar glyph = m_font->get_glyph(codepoint);
+        m_has_lazy_glyphs     |= !m_font->is_in_range(codepoint);
 
         float glyph_x_offset   = glyph.xoff * scaling;
         float glyph_y_offset   = glyph.yoff * scaling;
@@ -97,61 +343,86 @@ void Text::init_text_with_va_list(Font& font, float text_size, const char* forma
         float glyph_height     = (glyph.y1 - glyph.y0) * scaling;
         float glyph_x_advance  = glyph.xadvance * scaling;
 
-        /* ------------------------------- Glyph screen position ------------------------------ */
-        Vec4<float> glyph_rect = {};
+        QuadInstance quad = {};
+        quad.color        = 0xFFFFFFFF;
+        quad.flags        = flags;
 
-        glyph_rect.x0 = x + glyph_x_offset;
-        glyph_rect.x1 = glyph_rect.x0 + glyph_width;
+        /* ------------------------------- Glyph screen position ------------------------------ */
+        quad.rect.x0 = x + glyph_x_offset;
+        quad.rect.x1 = quad.rect.x0 + glyph_width;
         x += glyph_x_advance;
 
-        glyph_rect.y0 = y + glyph_y_offset;
-        glyph_rect.y1 = glyph_rect.y0 + glyph_height;
-
-        m_glyph_rects.push(glyph_rect);
+        quad.rect.y0 = y + glyph_y_offset;
+        quad.rect.y1 = quad.rect.y0 + glyph_height;
 
         /* --------------------------- Glpyh texture sample position -------------------------- */
-        Vec4<float> glyph_tex_coord = {};
-        glyph_tex_coord.s0 = (float) glyph.x0 / font.get_bitmap().get_width();
-        glyph_tex_coord.s1 = (float) glyph.x1 / font.get_bitmap().get_width();
-        glyph_tex_coord.t0 = (float) glyph.y0 / font.get_bitmap().get_height();
-        glyph_tex_coord.t1 = (float) glyph.y1 / font.get_bitmap().get_height();
-
-        m_glyph_tex_coords.push(glyph_tex_coord);
+        quad.tex_rect[0] = tex_coord_to_unorm16(glyph.x0 / page_size);
+        quad.tex_rect[1] = tex_coord_to_unorm16(glyph.y0 / page_size);
+        quad.tex_rect[2] = tex_coord_to_unorm16(glyph.x1 / page_size);
+        quad.tex_rect[3] = tex_coord_to_unorm16(glyph.y1 / page_size);
+
+        // Whitespace has nothing to draw.
+        if (glyph_width > 0 && glyph_height > 0)
+            m_glyph_quads.push(quad);
     }
 
-    Vec4<float> first_glyph = m_glyph_rects.first();
-    Vec4<float> last_glyph  = m_glyph_rects.last();
+    m_size.w = x;
+    m_size.h = m_text_size;
 
-    m_size.w                = last_glyph.x1 - first_glyph.x0;
-    m_size.h                = text_size;
+    // Only now, loading the glyphs above may have evicted others.
+    m_font_epoch = m_font->get_epoch();
 }
 
-void Text::adjust_text(float x, float y)
+void Text::prepare_to_draw()
 {
-    for (size_t i = 0; i < m_length; i++)
+    if (m_font_epoch != m_font->get_epoch())
     {
-        Vec4<float>& glyph_rect = m_glyph_rects[i];
-        glyph_rect.x0 += x;
-        glyph_rect.x1 += x;
+        layout();
+        return;
+    }
 
-        glyph_rect.y0 += y;
-        glyph_rect.y1 += y;
+    // Marks the on demand glyphs as drawn this frame, so they aren't evicted from under it.
+    if (m_has_lazy_glyphs)
+    {
+        const char* cursor     = m_string;
+        const char* string_end = m_string + m_length;
+        while (cursor < string_end)
+        {
+            uint32_t codepoint = utf8_next(cursor, string_end);
+            if (!m_font->is_in_range(codepoint))
+                m_font->get_glyph(codepoint);
+        }
     }
 }
 
+const char* Text::get_string()
+{
+    return m_string;
+}
+
 int Text::get_length()
 {
     return m_length;
 }
 
-Array<Vec4<float>>& Text::get_glyph_rects()
+float Text::get_text_size()
+{
+    return m_text_size;
+}
+
+float Text::get_width()
 {
-    return m_glyph_rects;
+    return m_size.w;
 }
 
-Array<Vec4<float>>& Text::get_glyph_tex_coords()
+Font& Text::get_font()
 {
-    return m_glyph_tex_coords;
+    return *m_font;
+}
+
+Array<QuadInstance>& Text::get_glyph_quads()
+{
+    return m_glyph_quads;
 }
 
 static void glewErrorAndExit(GLenum error_code)
@@ -161,19 +432,212 @@ static void glewErrorAndExit(GLenum error_code)
 }
 
 Renderer::Renderer(Font& font)
-: m_font(font)
+: m_font(&font)
 , m_vertex_array(0)
-, m_vertex_buffer(0)
 , m_program(0)
-, m_texture(0)
+, m_grid_program(0)
+, m_grid_texture(0)
+, m_grid_texture_size({0, 0})
+, m_grid_bytes_uploaded(0)
+, m_quads(get_permanent_arena())
+, m_quad_atlas_pages(get_permanent_arena())
+, m_sort_keys(get_permanent_arena())
+, m_sort_indices(get_permanent_arena())
+, m_scratch_sort_keys(get_permanent_arena())
+, m_scratch_sort_indices(get_permanent_arena())
+, m_batches(get_permanent_arena())
+, m_atlas(ATLAS_PAGE_SIZE, GL_RGBA8, GL_RGBA, 4, GL_NEAREST)
+, m_glyph_atlas(GLYPH_ATLAS_PAGE_SIZE, GL_R8, GL_RED, 1, GL_LINEAR)
+, m_textures(m_atlas)
+, m_white_region()
+, m_layer(0)
+, m_num_of_draw_calls(0)
+, m_text_pool(sizeof(Text), TEXT_CACHE_CAPACITY, get_permanent_arena())
+, m_text_cache(TEXT_CACHE_CAPACITY, get_permanent_arena())
+, m_text_cache_slots(TEXT_CACHE_CAPACITY)
+, m_frame_index(0)
 , m_frame_size({0, 0})
 { }
 
-stbtt_packedchar Font::get_glyph(char c)
+Renderer::~Renderer()
+{
+    for (CachedText& cached_text : m_text_cache)
+        destroy(m_text_pool, cached_text.text);
+}
+
+stbtt_packedchar Font::get_glyph(uint32_t codepoint)
+{
+    if (is_in_range(codepoint))
+        return m_packedchars[codepoint - m_first_codepoint];
+
+    uint32_t* slot = m_lazy_glyph_slots.find(codepoint);
+    if (slot)
+    {
+        LazyGlyph& lazy_glyph       = m_lazy_glyphs[*slot];
+        lazy_glyph.last_drawn_frame = m_frame_index;
+        return lazy_glyph.glyph;
+    }
+
+    stbtt_packedchar glyph;
+    if (!load_lazy_glyph(codepoint, glyph))
+        return get_fallback_glyph();
+
+    return glyph;
+}
+
+bool Font::is_in_range(uint32_t codepoint)
+{
+    return codepoint >= (uint32_t) m_first_codepoint && codepoint <= (uint32_t) m_last_codepoint;
+}
+
+uint64_t Font::get_epoch()
+{
+    return m_epoch;
+}
+
+void Font::end_frame()
+{
+    m_frame_index++;
+}
+
+// The font's missing glyph box if it's in the range, a question mark otherwise.
+stbtt_packedchar Font::get_fallback_glyph()
+{
+    if (is_in_range(0))
+        return m_packedchars[0 - m_first_codepoint];
+
+    if (is_in_range('?'))
+        return m_packedchars['?' - m_first_codepoint];
+
+    return {};
+}
+
+bool Font::load_lazy_glyph(uint32_t codepoint, stbtt_packedchar& glyph)
+{
+    assert_with_message(m_atlas, "Font %s was never placed in an atlas", m_filepath);
+    if (!m_lazy_cell_size)
+        return false;
+
+    if (!m_font_info.data)
+    {
+        const uint8_t* font_data = static_cast<const uint8_t*>(m_font_file.get_data());
+        int result = stbtt_InitFont(&m_font_info, font_data, stbtt_GetFontOffsetForIndex(font_data, 0));
+        assert_with_message(result, "Failed to read font %s", m_filepath);
+    }
+
+    if (!stbtt_FindGlyphIndex(&m_font_info, codepoint))
+        return false;
+
+    // Rasterized before a slot is found, a glyph that doesn't fit mustn't evict another.
+    if (!rasterize_lazy_glyph(codepoint, glyph))
+        return false;
+
+    uint32_t slot;
+    if (!find_free_lazy_slot(slot))
+        return false;
+
+    int cell_x = m_lazy_region.x0 + (slot % m_lazy_cells_per_row) * m_lazy_cell_size;
+    int cell_y = m_lazy_region.y0 + (slot / m_lazy_cells_per_row) * m_lazy_cell_size;
+
+    // The whole cell goes up, so what was left of an evicted glyph is cleared too.
+    m_atlas->upload(m_atlas_page, cell_x, cell_y, m_lazy_cell_size, m_lazy_cell_size,
+                    m_lazy_cell_pixels.get_underlying_buffer(), 0);
+
+    glyph.x0 += cell_x;
+    glyph.y0 += cell_y;
+    glyph.x1 += cell_x;
+    glyph.y1 += cell_y;
+
+    if (slot == m_lazy_glyphs.get_used())
+        m_lazy_glyphs.push({});
+
+    m_lazy_glyphs[slot] = { codepoint, glyph, m_frame_index };
+    m_lazy_glyph_slots.insert(codepoint, slot);
+    return true;
+}
+
+// Takes an unused cell if there is one, otherwise evicts the glyph drawn least recently,
+// as long as it wasn't drawn this frame, its quads may still be waiting to be drawn.
+bool Font::find_free_lazy_slot(uint32_t& slot)
+{
+    if (!m_lazy_glyphs.is_full())
+    {
+        slot = (uint32_t) m_lazy_glyphs.get_used();
+        return true;
+    }
+
+    slot = 0;
+    for (uint32_t i = 1; i < m_lazy_glyphs.get_used(); i++)
+    {
+        if (m_lazy_glyphs[i].last_drawn_frame < m_lazy_glyphs[slot].last_drawn_frame)
+            slot = i;
+    }
+
+    if (m_lazy_glyphs[slot].last_drawn_frame == m_frame_index)
+        return false;
+
+    m_lazy_glyph_slots.remove(m_lazy_glyphs[slot].codepoint);
+    m_epoch++;
+    return true;
+}
+
+// Rasterizes into the top left of the cleared cell pixels, with the rect relative to the
+// cell. Glyphs too large for a cell fail.
+bool Font::rasterize_lazy_glyph(uint32_t codepoint, stbtt_packedchar& glyph)
 {
-    int char_index = static_cast<int>(c);
-    assert(char_index >= m_first_codepoint && char_index <= m_last_codepoint);
-    return m_packedchars[char_index];
+    float scale = stbtt_ScaleForPixelHeight(&m_font_info, m_font_size);
+    m_lazy_cell_pixels.clear_and_zero();
+    uint8_t* cell_pixels = m_lazy_cell_pixels.get_underlying_buffer();
+
+    glyph = {};
+
+    int advance, left_side_bearing;
+    stbtt_GetCodepointHMetrics(&m_font_info, codepoint, &advance, &left_side_bearing);
+    glyph.xadvance = advance * scale;
+
+    int glyph_w = 0, glyph_h = 0, glyph_x_offset = 0, glyph_y_offset = 0;
+    switch (m_type)
+    {
+        case FontType::FONT_BITMAP:
+        {
+            int x0, y0, x1, y1;
+            stbtt_GetCodepointBitmapBox(&m_font_info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+            glyph_w        = x1 - x0;
+            glyph_h        = y1 - y0;
+            glyph_x_offset = x0;
+            glyph_y_offset = y0;
+
+            if (glyph_w >= m_lazy_cell_size || glyph_h >= m_lazy_cell_size)
+                return false;
+
+            stbtt_MakeCodepointBitmap(&m_font_info, cell_pixels, glyph_w, glyph_h, m_lazy_cell_size, scale, scale, codepoint);
+        } break;
+
+        case FontType::FONT_SDF:
+        {
+            float pixel_dist_scale = (float) SDF_ON_EDGE_VALUE / SDF_PADDING;
+            uint8_t* field = stbtt_GetCodepointSDF(&m_font_info, scale, codepoint, SDF_PADDING, SDF_ON_EDGE_VALUE,
+                                                   pixel_dist_scale, &glyph_w, &glyph_h, &glyph_x_offset, &glyph_y_offset);
+            if (!field)
+                break;
+
+            bool fits = glyph_w < m_lazy_cell_size && glyph_h < m_lazy_cell_size;
+            for (int y = 0; fits && y < glyph_h; y++)
+                memcpy(&cell_pixels[y * m_lazy_cell_size], &field[y * glyph_w], glyph_w);
+
+            stbtt_FreeSDF(field, nullptr);
+            if (!fits)
+                return false;
+        } break;
+    }
+
+    glyph.x1    = glyph_w;
+    glyph.y1    = glyph_h;
+    glyph.xoff  = glyph_x_offset;
+    glyph.yoff  = glyph_y_offset;
+    glyph.xoff2 = glyph_x_offset + glyph_w;
+    glyph.yoff2 = glyph_y_offset + glyph_h;
+    return true;
 }
 
 float Font::get_font_size()
@@ -194,39 +658,75 @@ void Renderer::init()
     glGenVertexArrays(1, &m_vertex_array);
     glBindVertexArray(m_vertex_array);
 
-    glGenBuffers(1, &m_vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    // Reserving space on the CPU and GPU for quad data.
+    // Once we've reached the capacity of the buffer it is flushed (See: Renderer::flush),
+    // every quad of a flush is written straight into the stream buffer in draw order and
+    // drawn from ranges of it.
+    size_t quad_buffer_size_in_bytes = QUAD_BUFFER_CAPACITY * sizeof(QuadInstance);
+    m_quad_stream.init(GL_ARRAY_BUFFER, quad_buffer_size_in_bytes, QUAD_STREAM_SEGMENTS);
+
+    m_quads.resize(QUAD_BUFFER_CAPACITY);
+    m_quad_atlas_pages.resize(QUAD_BUFFER_CAPACITY);
+    m_sort_keys.resize(QUAD_BUFFER_CAPACITY);
+    m_sort_indices.resize(QUAD_BUFFER_CAPACITY);
+    m_scratch_sort_keys.resize(QUAD_BUFFER_CAPACITY);
+    m_scratch_sort_indices.resize(QUAD_BUFFER_CAPACITY);
+    // A batch only ends once it holds TEXTURE_SLOTS textures, which takes at least that
+    // many quads.
+    m_batches.resize(QUAD_BUFFER_CAPACITY / TEXTURE_SLOTS + 1);
 
-    // Reserving space on the CPU and GPU for quad data.e
-    // Once we've reached the capacity of the buffer it is flushed (See: Renderer::flush)
-    // and a draw call is issued on the GPU.
-    
-    // TODO: Use one buffer and use ranges & layers instead.
-    //       Will be more important to do this once we run into Z ordering problems.
+    glActiveTexture(GL_TEXTURE0);
 
-    m_colored_quads.resize(QUAD_BUFFER_CAPACITY);
-    m_textured_quads.resize(QUAD_BUFFER_CAPACITY);
-    m_text_quads.resize(QUAD_BUFFER_CAPACITY);
+    // The white texel goes in first so it's on the first page, where most images end up
+    // too.
+    uint32_t white_pixel = 0xFFFFFFFF;
+    bool is_inserted     = m_atlas.insert(1, 1, &white_pixel, 0, m_white_region);
+    assert(is_inserted);
 
-    size_t quad_buffer_size_in_bytes = QUAD_BUFFER_CAPACITY * sizeof(Quad);
-    glBufferData(GL_ARRAY_BUFFER, quad_buffer_size_in_bytes, nullptr, GL_DYNAMIC_DRAW);
+    m_font->place_in_atlas(m_glyph_atlas);
 
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &m_texture);
+    // Every attribute advances once per quad, see set_instance_attributes for where they
+    // point.
+    for (GLuint attribute = 0; attribute < 4; attribute++)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    set_instance_attributes(0);
 
-    // TODO: Make this code more robust so that the vertex buffer layout stays
-    //       in sync with the "Vertex" type.
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, position));
+    glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+    glGenTextures(1, &m_grid_texture);
+    glBindTexture(GL_TEXTURE_2D, m_grid_texture);
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, color));
+    // Integer textures can't be filtered.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, tex_coords));
+    m_grid_program = create_program(grid_vertex_source, grid_fragment_source);
+    glUseProgram(m_grid_program);
+    glUniform1i(glGetUniformLocation(m_grid_program, "grid"), GRID_TEXTURE_UNIT);
 
     m_program = create_program(vertex_source, fragment_source);
     glUseProgram(m_program);
+
+    GLint texture_units[TEXTURE_SLOTS];
+    for (int slot = 0; slot < TEXTURE_SLOTS; slot++)
+        texture_units[slot] = slot;
+
+    glUniform1iv(get_uniform_location("samplers"), TEXTURE_SLOTS, texture_units);
+}
+
+void Renderer::set_font(Font& font)
+{
+    m_font = &font;
+
+    // Before init there's no context to upload with yet, init places it instead.
+    if (m_program)
+        m_font->place_in_atlas(m_glyph_atlas);
 }
 
 void Renderer::set_frame_size(float w, float h)
@@ -247,55 +747,55 @@ void Renderer::clear(Color color)
 
 void Renderer::draw_rect(Vec4<float> rect, Color color, const char* filepath, Vec4<float> tex_coords, QuadType type)
 {
-    Quad quad = {};
-    Vertex* vertices = quad.vertices;
-
-    vertices[0].position = { rect.x0, rect.y0 };
-    vertices[1].position = { rect.x1, rect.y0 };
-    vertices[2].position = { rect.x0, rect.y1 };
-    vertices[3].position = { rect.x1, rect.y0 };
-    vertices[4].position = { rect.x0, rect.y1 };
-    vertices[5].position = { rect.x1, rect.y1 };
+    QuadInstance quad = {};
+    quad.rect = rect;
 
-    for (int i = 0; i < VERTCIES_PER_QUAD; i++)
-        vertices[i].color = color;
-
-    vertices[0].tex_coords = { tex_coords.s0, tex_coords.t0 };
-    vertices[1].tex_coords = { tex_coords.s1, tex_coords.t0 };
-    vertices[2].tex_coords = { tex_coords.s0, tex_coords.t1 };
-    vertices[3].tex_coords = { tex_coords.s1, tex_coords.t0 };
-    vertices[4].tex_coords = { tex_coords.s0, tex_coords.t1 };
-    vertices[5].tex_coords = { tex_coords.s1, tex_coords.t1 };
+    uint32_t r = (uint32_t) (color.r * 255 + 0.5f);
+    uint32_t g = (uint32_t) (color.g * 255 + 0.5f);
+    uint32_t b = (uint32_t) (color.b * 255 + 0.5f);
+    uint32_t a = (uint32_t) (color.a * 255 + 0.5f);
+    quad.color = (a << 24) | (b << 16) | (g << 8) | (r << 0);
 
+    int atlas_page = 0;
     switch (type)
     {
         case QuadType::QUAD_COLORED:
         {
-            push_quad_colored(quad);
+            // Every corner samples the middle of the white texel.
+            Vec4<float> white_tex_coords = get_atlas_tex_coords(m_white_region);
+            tex_coords.s0 = tex_coords.s1 = (white_tex_coords.s0 + white_tex_coords.s1) / 2;
+            tex_coords.t0 = tex_coords.t1 = (white_tex_coords.t0 + white_tex_coords.t1) / 2;
+            atlas_page    = m_white_region.page;
         } break;
 
         case QuadType::QUAD_TEXTURED:
         {
-            // TODO: Batch this when our asset strategy is completed.
-            int desired_channels = 4;
-            int image_w, image_h, image_channels;
-            uint8_t* image_data = stbi_load(filepath, &image_w, &image_h, &image_channels, desired_channels);
-            assert(image_data);
-            assert(desired_channels == image_channels);
-
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_w, image_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-            stbi_image_free(image_data);
-
-            // TODO: Don't immediately flush when sophisticated batch rendering is implemented.
-            push_quad_textured(quad);
-            flush_textured();
+            // The tex coords are relative to the image, they're mapped into its region.
+            AtlasRegion region        = m_textures.get_region(m_textures.get_texture_id(filepath));
+            Vec4<float> region_coords = get_atlas_tex_coords(region);
+            float region_w            = region_coords.s1 - region_coords.s0;
+            float region_h            = region_coords.t1 - region_coords.t0;
+            tex_coords.s0             = region_coords.s0 + tex_coords.s0 * region_w;
+            tex_coords.s1             = region_coords.s0 + tex_coords.s1 * region_w;
+            tex_coords.t0             = region_coords.t0 + tex_coords.t0 * region_h;
+            tex_coords.t1             = region_coords.t0 + tex_coords.t1 * region_h;
+            atlas_page                = region.page;
         } break;
-        
+
         case QuadType::QUAD_TEXT:
         {
-            push_quad_text(quad);
+            atlas_page = GLYPH_ATLAS_FIRST_PAGE + m_font->get_atlas_page();
+            if (m_font->get_type() == FontType::FONT_SDF)
+                quad.flags = QUAD_FLAG_SDF;
         } break;
     }
+
+    quad.tex_rect[0] = tex_coord_to_unorm16(tex_coords.s0);
+    quad.tex_rect[1] = tex_coord_to_unorm16(tex_coords.t0);
+    quad.tex_rect[2] = tex_coord_to_unorm16(tex_coords.s1);
+    quad.tex_rect[3] = tex_coord_to_unorm16(tex_coords.t1);
+
+    push_quad(quad, atlas_page);
 }
 
 void Renderer::draw_rect(Vec4<float> rect, Color color)
@@ -305,51 +805,189 @@ void Renderer::draw_rect(Vec4<float> rect, Color color)
 
 void Renderer::draw_rect(Vec4<float> rect, const char* filepath)
 {
-    // TODO: Find out what the best parameters to use here.
-    //       This will be dependent on our assset packing strategy.
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
     draw_rect(rect, COLOR_WHITE, filepath, { 0, 0, 1, 1 }, QuadType::QUAD_TEXTURED);
 }
 
-void Renderer::draw_text(float x, float y, float text_size ,const char* format, ...)
+void Renderer::draw_rect(Vec4<float> rect, uint32_t texture_id)
 {
+    assert_with_message(texture_id < m_textures.get_num_of_textures(), "Texture %u was never loaded", texture_id);
+
+    AtlasRegion region        = m_textures.get_region(texture_id);
+    Vec4<float> region_coords = get_atlas_tex_coords(region);
+
+    QuadInstance quad = {};
+    quad.rect         = rect;
+    quad.tex_rect[0]  = tex_coord_to_unorm16(region_coords.s0);
+    quad.tex_rect[1]  = tex_coord_to_unorm16(region_coords.t0);
+    quad.tex_rect[2]  = tex_coord_to_unorm16(region_coords.s1);
+    quad.tex_rect[3]  = tex_coord_to_unorm16(region_coords.t1);
+    quad.color        = 0xFFFFFFFF;
+
+    push_quad(quad, region.page);
+}
+
+uint32_t Renderer::load_texture(const char* filepath)
+{
+    return m_textures.get_texture_id(filepath);
+}
+
+void Renderer::draw_text(float x, float y, float text_size, const char* format, ...)
+{
+    char string[Text::TEXT_MAX];
+
     va_list va_list;
     va_start(va_list, format);
-    Text text = Text(m_font, text_size, format, va_list);
+    int length = vsnprintf(string, Text::TEXT_MAX, format, va_list);
     va_end(va_list);
 
+    Text& text = get_cached_text(text_size, string, min(max(length, 0), Text::TEXT_MAX - 1));
     draw_text(x, y, text);
 }
 
 void Renderer::draw_text(float x, float y, Text& text)
 {
-    // TODO: Find out what the best parameters to use here.
-    //       This will be dependent on our assset packing strategy.
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
-    text.adjust_text(x, y);
-    Bitmap<uint32_t>& font_bitmap = m_font.get_bitmap();
+    Font& font = text.get_font();
+    assert_with_message(font.is_placed_in_atlas(), "Text drawn with a font that isn't the renderer's");
+    uint32_t atlas_page = GLYPH_ATLAS_FIRST_PAGE + font.get_atlas_page();
 
-    Array<Vec4<float>>& glyph_rects       = text.get_glyph_rects();
-    Array<Vec4<float>>& glyph_text_coords = text.get_glyph_tex_coords();
+    text.prepare_to_draw();
 
-    for (size_t i = 0; i < text.get_length(); i++)
+    Array<QuadInstance>& glyph_quads = text.get_glyph_quads();
+    for (size_t i = 0; i < glyph_quads.get_used(); i++)
     {
-        Vec4<float> glyph_rect = glyph_rects[i];
-        Vec4<float> glyph_tex_coord = glyph_text_coords[i];
-        draw_rect(glyph_rect, COLOR_WHITE, nullptr, glyph_tex_coord, QuadType::QUAD_TEXT);
+        QuadInstance quad = glyph_quads[i];
+        quad.rect.x0 += x;
+        quad.rect.x1 += x;
+        quad.rect.y0 += y;
+        quad.rect.y1 += y;
+        push_quad(quad, atlas_page);
     }
 }
 
+void Renderer::end_frame()
+{
+    flush();
+    m_frame_index++;
+    m_font->end_frame();
+}
+
+Text& Renderer::get_cached_text(float text_size, const char* string, int length)
+{
+    Font* font    = m_font;
+    uint64_t hash = hash_bytes(string, length);
+    hash          = hash_bytes(&text_size, sizeof(text_size), hash);
+    hash          = hash_bytes(&font, sizeof(font), hash);
+
+    uint32_t slot;
+    uint32_t* cached_slot = m_text_cache_slots.find(hash);
+    if (cached_slot)
+    {
+        slot = *cached_slot;
+    }
+    else if (!m_text_cache.is_full())
+    {
+        slot = (uint32_t) m_text_cache.get_used();
+        m_text_cache.push({ create<Text>(m_text_pool, *m_font, text_size, get_permanent_arena()), hash, 0 });
+        m_text_cache_slots.insert(hash, slot);
+    }
+    else
+    {
+        slot = 0;
+        for (uint32_t i = 1; i < m_text_cache.get_used(); i++)
+        {
+            if (m_text_cache[i].last_drawn_frame < m_text_cache[slot].last_drawn_frame)
+                slot = i;
+        }
+
+        m_text_cache_slots.remove(m_text_cache[slot].hash);
+        m_text_cache_slots.insert(hash, slot);
+        m_text_cache[slot].hash = hash;
+    }
+
+    // Lays it out if the slot is new, reused, or shared by a different string with the
+    // same hash, and does nothing otherwise.
+    CachedText& cached_text      = m_text_cache[slot];
+    cached_text.last_drawn_frame = m_frame_index;
+    cached_text.text->set(*m_font, text_size, string, length);
+
+    return *cached_text.text;
+}
+
+void Renderer::draw_grid(const void* cells, int bytes_per_row, int width, int height, Vec2<float> pan, float zoom, Color color,
+                         const Vec4<int>* dirty_rects, int num_of_dirty_rects)
+{
+    assert(bytes_per_row * 8 >= width);
+    if (width <= 0 || height <= 0)
+        return;
+
+    flush();
+
+    glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t dirty_area = 0;
+    for (int i = 0; dirty_rects && i < num_of_dirty_rects; i++)
+        dirty_area += (size_t) (dirty_rects[i].x1 - dirty_rects[i].x0) * (dirty_rects[i].y1 - dirty_rects[i].y0);
+
+    size_t grid_area    = (size_t) bytes_per_row * height;
+    bool is_full_upload = !dirty_rects || num_of_dirty_rects > GRID_MAX_DIRTY_RECTS ||
+                          dirty_area * 100 > grid_area * GRID_MAX_DIRTY_AREA_PERCENTAGE;
+
+    // Only reallocates the texture when the grid changes size, which also means the old
+    // contents are gone.
+    if (m_grid_texture_size.w != bytes_per_row || m_grid_texture_size.h != height)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, bytes_per_row, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, cells);
+        m_grid_texture_size    = { bytes_per_row, height };
+        m_grid_bytes_uploaded += grid_area;
+    }
+    else if (is_full_upload)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, bytes_per_row, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, cells);
+        m_grid_bytes_uploaded += grid_area;
+    }
+    else
+    {
+        // Rows of a rect are picked out of the full grid by the row length.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bytes_per_row);
+
+        const uint8_t* cell_bytes = static_cast<const uint8_t*>(cells);
+        for (int i = 0; i < num_of_dirty_rects; i++)
+        {
+            Vec4<int> rect = dirty_rects[i];
+            assert(rect.x0 >= 0 && rect.x1 <= bytes_per_row && rect.y0 >= 0 && rect.y1 <= height);
+
+            const uint8_t* first_byte = &cell_bytes[(size_t) rect.y0 * bytes_per_row + rect.x0];
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0,
+                            GL_RED_INTEGER, GL_UNSIGNED_BYTE, first_byte);
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        m_grid_bytes_uploaded += dirty_area;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUseProgram(m_grid_program);
+    glUniform2f(glGetUniformLocation(m_grid_program, "frame_size"), m_frame_size.w, m_frame_size.h);
+    glUniform2f(glGetUniformLocation(m_grid_program, "pan"), pan.x, pan.y);
+    glUniform1f(glGetUniformLocation(m_grid_program, "zoom"), zoom);
+    glUniform2i(glGetUniformLocation(m_grid_program, "grid_size"), width, height);
+    glUniform4f(glGetUniformLocation(m_grid_program, "cell_color"), color.r, color.g, color.b, color.a);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(m_program);
+}
+
+size_t Renderer::take_grid_bytes_uploaded()
+{
+    size_t grid_bytes_uploaded = m_grid_bytes_uploaded;
+    m_grid_bytes_uploaded      = 0;
+    return grid_bytes_uploaded;
+}
+
 const char* Renderer::get_shader_type_string(GLenum type)
 {
     switch (type)
@@ -401,109 +1039,136 @@ GLint Renderer::get_uniform_location(const char* name)
     return location;
 }
 
-void Renderer::flush()
+void Renderer::set_layer(uint8_t layer)
 {
-    flush_colored();
-    flush_textured();
-    flush_text();
+    m_layer = layer;
 }
 
-void Renderer::flush_colored()
+size_t Renderer::take_num_of_draw_calls()
 {
-    // TODO: Code deduplication between flush methods
-
-    set_uniform("is_textured", false);
-    
-    Quad* quad_buffer                = m_colored_quads.get_underlying_buffer(); 
-    size_t quad_buffer_size_in_bytes = m_colored_quads.get_used_amount_in_bytes();
-    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_buffer_size_in_bytes, quad_buffer);
-
-    size_t quad_buffer_used          = m_colored_quads.get_used();
-    size_t num_of_vertices           = quad_buffer_used * VERTCIES_PER_QUAD;
-    glDrawArrays(GL_TRIANGLES, 0, num_of_vertices);
+    size_t num_of_draw_calls = m_num_of_draw_calls;
+    m_num_of_draw_calls      = 0;
+    return num_of_draw_calls;
+}
 
-    m_colored_quads.clear();
+size_t Renderer::get_num_of_fence_waits()
+{
+    return m_quad_stream.get_num_of_fence_waits();
 }
 
-void Renderer::flush_textured()
+void Renderer::flush()
 {
-    // TODO: Code deduplication between flush methods
+    size_t num_of_quads = m_quads.get_used();
+    if (num_of_quads > 0)
+    {
+        radix_sort(m_sort_keys.get_underlying_buffer(), m_sort_indices.get_underlying_buffer(), num_of_quads,
+                   m_scratch_sort_keys.get_underlying_buffer(), m_scratch_sort_indices.get_underlying_buffer());
 
-    set_uniform("is_textured", true);
+        size_t stream_offset;
+        void* stream_data = m_quad_stream.begin_write(num_of_quads * sizeof(QuadInstance), stream_offset);
+        build_batches(num_of_quads, static_cast<QuadInstance*>(stream_data));
+        m_quad_stream.end_write();
 
-    // TODO: Once more sophisticated batch rendering is implemented then we can 
-    //       remove this check.
-    assert(m_textured_quads.get_used() <= 1);
-    
-    Quad* quad_buffer                = m_textured_quads.get_underlying_buffer(); 
-    size_t quad_buffer_size_in_bytes = m_textured_quads.get_used_amount_in_bytes();
-    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_buffer_size_in_bytes, quad_buffer);
+        size_t first_stream_instance = stream_offset / sizeof(QuadInstance);
+
+        for (size_t batch_index = 0; batch_index < m_batches.get_used(); batch_index++)
+        {
+            QuadBatch& batch = m_batches[batch_index];
+            for (int slot = 0; slot < batch.num_of_textures; slot++)
+                bind_texture(slot, batch.atlas_pages[slot]);
+
+            // GLES has no base instance, so the attributes are pointed at the batch instead.
+            set_instance_attributes(first_stream_instance + batch.first);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, VERTICES_PER_QUAD, batch.count);
+            m_num_of_draw_calls++;
+        }
+
+        m_quad_stream.fence();
 
-    size_t quad_buffer_used          = m_textured_quads.get_used();
-    size_t num_of_vertices           = quad_buffer_used * VERTCIES_PER_QUAD;
-    glDrawArrays(GL_TRIANGLES, 0, num_of_vertices);
+        glActiveTexture(GL_TEXTURE0);
+    }
 
-    m_textured_quads.clear();
+    m_quads.clear();
 }
 
-void Renderer::flush_text()
+// Lays the quads out in draw order and splits them into batches of at most TEXTURE_SLOTS
+// distinct textures, giving every quad the slot its texture is bound to. `sorted_quads`
+// is usually mapped GPU memory, so it's only ever written, front to back.
+void Renderer::build_batches(size_t num_of_quads, QuadInstance* sorted_quads)
 {
-    // TODO: Code deduplication between flush methods
-
-    set_uniform("is_textured", true);
+    m_batches.clear();
 
-    // Uploading font texture to GPU
-    Bitmap<uint32_t>& font_bitmap = m_font.get_bitmap();
-    uint32_t* font_bitmap_pixels  = font_bitmap.get_pixel_buffer();
-    float font_bitmap_width       = font_bitmap.get_width();
-    float font_bitmap_height      = font_bitmap.get_height();
+    QuadBatch batch = {};
+    for (size_t i = 0; i < num_of_quads; i++)
+    {
+        uint32_t quad_index = m_sort_indices[i];
+        QuadInstance quad   = m_quads[quad_index];
+        uint32_t atlas_page = m_quad_atlas_pages[quad_index];
 
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGBA,
-                 font_bitmap_width,
-                 font_bitmap_height,
-                 0,
-                 GL_RGBA,
-                 GL_UNSIGNED_BYTE,
-                 font_bitmap_pixels);
-    
-    Quad* quad_buffer                = m_text_quads.get_underlying_buffer(); 
-    size_t quad_buffer_size_in_bytes = m_text_quads.get_used_amount_in_bytes();
-    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_buffer_size_in_bytes, quad_buffer);
+        int slot = 0;
+        while (slot < batch.num_of_textures && batch.atlas_pages[slot] != atlas_page)
+            slot++;
 
-    size_t quad_buffer_used          = m_text_quads.get_used();
-    size_t num_of_vertices           = quad_buffer_used * VERTCIES_PER_QUAD;
-    glDrawArrays(GL_TRIANGLES, 0, num_of_vertices);
+        if (slot == batch.num_of_textures)
+        {
+            if (batch.num_of_textures == TEXTURE_SLOTS)
+            {
+                m_batches.push(batch);
+                batch       = {};
+                batch.first = i;
+                slot        = 0;
+            }
+
+            batch.atlas_pages[batch.num_of_textures++] = atlas_page;
+        }
+
+        quad.texture_slot = slot;
+        sorted_quads[i]   = quad;
+        batch.count++;
+    }
 
-    m_text_quads.clear();
+    m_batches.push(batch);
 }
 
-void Renderer::push_quad_colored(Quad quad)
+void Renderer::bind_texture(int slot, uint32_t atlas_page)
 {
-    // TODO: Deduplicate code on push_quad methods.
-    if (m_colored_quads.get_used() == m_colored_quads.get_size())
-        flush_colored();
+    glActiveTexture(GL_TEXTURE0 + slot);
 
-    m_colored_quads.push(quad);
+    if (atlas_page >= GLYPH_ATLAS_FIRST_PAGE)
+        glBindTexture(GL_TEXTURE_2D, m_glyph_atlas.get_page_texture(atlas_page - GLYPH_ATLAS_FIRST_PAGE));
+    else
+        glBindTexture(GL_TEXTURE_2D, m_atlas.get_page_texture(atlas_page));
 }
 
-void Renderer::push_quad_textured(Quad quad)
+Vec4<float> Renderer::get_atlas_tex_coords(AtlasRegion region)
 {
-    // TODO: Deduplicate code on push_quad methods.
-    if (m_textured_quads.get_used() == m_textured_quads.get_size())
-        flush_textured();
+    float page_size = (float) m_atlas.get_page_size();
+    return { region.x0 / page_size, region.y0 / page_size, region.x1 / page_size, region.y1 / page_size };
+}
 
-    m_textured_quads.push(quad);
+// TODO: Make this code more robust so that the vertex buffer layout stays
+//       in sync with the "QuadInstance" type.
+void Renderer::set_instance_attributes(size_t first_instance)
+{
+    size_t base = first_instance * sizeof(QuadInstance);
+    GLsizei stride = sizeof(QuadInstance);
 
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void*) (base + offsetof(QuadInstance, rect)));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void*) (base + offsetof(QuadInstance, tex_rect)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*) (base + offsetof(QuadInstance, color)));
+    glVertexAttribIPointer(3, 2, GL_UNSIGNED_SHORT, stride, (const void*) (base + offsetof(QuadInstance, texture_slot)));
 }
 
-void Renderer::push_quad_text(Quad quad)
+void Renderer::push_quad(QuadInstance quad, uint32_t atlas_page)
 {
-    // TODO: Deduplicate code on push_quad methods.
-    if (m_text_quads.get_used() == m_text_quads.get_size())
-        flush_text();
+    if (m_quads.is_full())
+        flush();
 
-    m_text_quads.push(quad);
+    uint64_t sequence = m_quads.get_used();
+    uint64_t sort_key = ((uint64_t) m_layer << 56) | sequence;
 
+    m_quad_atlas_pages.set(sequence, atlas_page);
+    m_sort_keys.set(sequence, sort_key);
+    m_sort_indices.set(sequence, (uint32_t) sequence);
+    m_quads.push(quad);
 }
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "array.hpp"
+#include "hash_map.hpp"
+#include "stream_buffer.hpp"
+#include "texture_atlas.hpp"
+#include "texture_manager.hpp"
+#include "font_cache.hpp"
 
 typedef unsigned int GLuint;
 typedef unsigned int GLenum;
@@ -36,22 +41,22 @@ class Bitmap
     struct { int w, h; } m_size;
     int m_channels;
     int m_stride;
+    Allocator& m_allocator;
 
 public:
-    Bitmap(int width, int height, int channels)
+    Bitmap(int width, int height, int channels, Allocator& allocator = get_heap_allocator())
     : m_size({ width, height })
     , m_channels(channels)
     , m_stride(width * channels)
+    , m_allocator(allocator)
     {
-        // TODO: Remove malloc when memory strategy finalized.
-        m_pixels = (T*) malloc(width * height * channels);
+        m_pixels = static_cast<T*>(m_allocator.allocate(width * height * channels, alignof(T)));
         memset(m_pixels, 0, width * height * channels);
     }
 
-    Bitmap()
+    ~Bitmap()
     {
-        free(m_pixels);
-        memset(this, 0, sizeof(*this));
+        m_allocator.deallocate(m_pixels, m_size.w * m_size.h * m_channels);
     }
 
     T* get_pixel_buffer()
@@ -79,24 +84,6 @@ public:
         return m_channels;
     }
 
-    void copy_grayscale_as_rgba(Bitmap<uint8_t>& grayscale_bitmap)
-    {
-        assert(grayscale_bitmap.get_height() == m_size.h);
-        assert(grayscale_bitmap.get_width() == m_size.w);
-        assert(grayscale_bitmap.get_channels() == 1);
-
-        uint32_t* rbga_pixels = m_pixels;
-        for (uint8_t pixel : grayscale_bitmap)
-        {
-            uint8_t r = pixel;
-            uint8_t g = pixel;
-            uint8_t b = pixel;
-            uint8_t a = pixel;
-
-            *rbga_pixels++ = (a << 24) | (b << 16) | (g << 8) | (r << 0);
-        }
-    }
-
     /* ------------------------------------- Iterator ------------------------------------- */
 
     class Iterator
@@ -141,61 +128,113 @@ public:
     }
 };
 
+enum class FontType
+{
+    // Coverage rasterized at the font size, for text drawn at about that size.
+    FONT_BITMAP,
+
+    // Signed distance fields, which stay sharp scaled well above or below the font size.
+    FONT_SDF
+};
+
+// Glyphs of a TTF font. The codepoint range given at construction is rasterized up
+// front, and cached on disk, and stays in the atlas for good. Any other codepoint is
+// rasterized the first time it's drawn into a cell of a region reserved next to them,
+// and uploaded on its own. When every cell is taken, the glyph drawn least recently is
+// evicted, never one drawn this frame, and the font's epoch changes so text laid out
+// before knows to lay itself out again.
 class Font
 {
+    // Pixels of distance the fields extend past the outline, and the value on it.
+    static const int SDF_PADDING       = 6;
+    static const int SDF_ON_EDGE_VALUE = 128;
+
+    // Side of the square region of the atlas the on demand glyphs are kept in.
+    static const int LAZY_GLYPH_REGION_SIZE = 512;
+
     const char* m_filepath;
+    FontType m_type;
     int m_first_codepoint;
     int m_last_codepoint;
     
-    Bitmap<uint32_t>& m_bitmap;
+    // Glyph coverage, one byte per pixel. Points into the cache when the font was loaded
+    // from one, otherwise into the bitmap it was rasterized into.
+    Bitmap<uint8_t>& m_bitmap;
+    const uint8_t* m_pixels;
+    FontCache m_cache;
+    bool m_is_from_cache;
+
     float m_font_size;
     Array<stbtt_packedchar> m_packedchars;
 
-public:
-    Font(Bitmap<uint32_t>& bitmap, int codepoint_range[2], float font_size, const char* filepath);
-    ~Font();
-    stbtt_packedchar get_glyph(char c);
-    float get_font_size();
+    // Once placed in an atlas the glyph rects are in pixels of this page.
+    TextureAtlas* m_atlas;
+    int m_atlas_page;
+    int m_atlas_page_size;
 
-    Bitmap<uint32_t>& get_bitmap();
-};
+    // Mapped for as long as the font lives. A cached font only reads it for the key's
+    // hash, the font info is set up once a glyph outside the range is needed.
+    File m_font_file;
+    stbtt_fontinfo m_font_info;
 
-class Text
-{
-    // TODO: Remove limit and allocate text storage.
-    static const int TEXT_MAX = 128;
+    struct LazyGlyph
+    {
+        uint32_t codepoint;
+        stbtt_packedchar glyph;
+        uint64_t last_drawn_frame;
+    };
 
-    Font& m_font;
-    struct { int w, h; } m_size;
-    int m_length;
-    float m_text_size;
+    AtlasRegion m_lazy_region;
+    int m_lazy_cell_size;
+    int m_lazy_cells_per_row;
+    Array<LazyGlyph> m_lazy_glyphs;
+    HashMap<uint32_t, uint32_t> m_lazy_glyph_slots;
+    Array<uint8_t> m_lazy_cell_pixels;
 
-    Array<Vec4<float>> m_glyph_rects;
-    Array<Vec4<float>> m_glyph_tex_coords;
+    uint64_t m_frame_index;
+    uint64_t m_epoch;
 
 public:
-    Text(Font& font, float text_size, const char* format, ...);
-    Text(Font& font, float text_size, const char* format, va_list va_list);
-    Text(const Text& text);
-    void operator=(const Text& other);
-    void adjust_text(float x, float y);
-    int get_length();
+    // Loads the glyphs from "<filepath>.fontcache" when it was baked for this file, type,
+    // size, range and bitmap size. Otherwise rasterizes them into `bitmap` and bakes the
+    // cache for next time.
+    Font(Bitmap<uint8_t>& bitmap, int codepoint_range[2], float font_size, const char* filepath,
+         FontType type = FontType::FONT_BITMAP);
+
+    // Rasterizes the glyph if it's outside the range and not in the atlas yet, which may
+    // evict another. Codepoints the font doesn't have, or that don't fit, come back as the
+    // fallback glyph.
+    stbtt_packedchar get_glyph(uint32_t codepoint);
+    bool is_in_range(uint32_t codepoint);
+
+    // Changes whenever a glyph is evicted, text laid out under another epoch may point at
+    // a glyph that isn't there anymore.
+    uint64_t get_epoch();
+
+    // Glyphs drawn from now on count as drawn in a new frame, the ones that aren't drawn
+    // again become evictable.
+    void end_frame();
 
-    Array<Vec4<float>>& get_glyph_rects();
-    Array<Vec4<float>>& get_glyph_tex_coords();
+    float get_font_size();
+    FontType get_type();
+    bool is_from_cache();
 
-    Vec4<float> get_glyph_rect(size_t index);
-    Vec4<float> get_glyph_tex_coord(size_t index);
+    // Copies every glyph into `atlas`, which must be single channel, and points the glyphs
+    // at their copies. They must all land on one page so text never needs more than one
+    // texture. Does nothing if the font is already placed.
+    void place_in_atlas(TextureAtlas& atlas);
+    bool is_placed_in_atlas();
+    int get_atlas_page();
+    int get_atlas_page_size();
 
 private:
-    void init_text_with_va_list(Font& font, float text_size, const char* format, va_list va_list);
-};
+    void rasterize_bitmap(const uint8_t* font_data, int num_of_codepoints);
+    void rasterize_sdf(const uint8_t* font_data, int num_of_codepoints);
 
-struct Vertex
-{
-    Vec2<float> position;
-    Color color;
-    Vec2<float> tex_coords;
+    stbtt_packedchar get_fallback_glyph();
+    bool load_lazy_glyph(uint32_t codepoint, stbtt_packedchar& glyph);
+    bool find_free_lazy_slot(uint32_t& slot);
+    bool rasterize_lazy_glyph(uint32_t codepoint, stbtt_packedchar& glyph);
 };
 
 enum class QuadType
@@ -205,38 +244,214 @@ enum class QuadType
     QUAD_TEXT
 };
 
-static const int VERTCIES_PER_QUAD = 6;
-struct Quad
+// How a quad's texture is sampled, must match the fragment shader.
+enum QuadFlags : uint16_t
+{
+    // The texture holds signed distance fields, the quad is covered where they're past
+    // the outline.
+    QUAD_FLAG_SDF = 1 << 0
+};
+
+// Everything the vertex shader needs for one quad, the corners are generated on the GPU.
+// Texture coordinates are normalized 16-bit and the color is RGBA8.
+struct QuadInstance
+{
+    Vec4<float> rect;
+    uint16_t tex_rect[4];
+    uint32_t color;
+    uint16_t texture_slot;
+    uint16_t flags;
+};
+
+static const int VERTICES_PER_QUAD = 4;
+
+// Texture coordinates as stored in QuadInstance::tex_rect.
+static inline uint16_t tex_coord_to_unorm16(float tex_coord)
 {
-    Vertex vertices[6];
+    return (uint16_t) (tex_coord * UINT16_MAX + 0.5f);
+}
+
+// A UTF-8 string laid out once into glyph quads, relative to its origin on the baseline.
+// Setting the same string and size again is free, so text that's redrawn every frame but
+// rarely changes, like a HUD, only pays for layout when it does change, or when one of its
+// glyphs was evicted from the font.
+class Text
+{
+public:
+    // TODO: Remove limit and allocate text storage.
+    static const int TEXT_MAX = 128;
+
+private:
+    Font* m_font;
+    float m_text_size;
+    struct { float w, h; } m_size;
+
+    char m_string[TEXT_MAX];
+    int m_length;
+
+    Array<QuadInstance> m_glyph_quads;
+    bool m_has_lazy_glyphs;
+    uint64_t m_font_epoch;
+
+public:
+    Text(Font& font, float text_size, Allocator& allocator = get_heap_allocator());
+    Text(Font& font, float text_size, const char* format, ...);
+
+    // Each returns whether the text had to be laid out again.
+    bool set_text(const char* format, ...);
+    bool set_text_with_va_list(const char* format, va_list va_list);
+    bool set_size(float text_size);
+    bool set(Font& font, float text_size, const char* string, int length);
+
+    const char* get_string();
+    int get_length();
+    float get_text_size();
+    float get_width();
+    Font& get_font();
+
+    // Lays the text out again if the font evicted glyphs since, and keeps the glyphs it
+    // uses from being evicted this frame.
+    void prepare_to_draw();
+    Array<QuadInstance>& get_glyph_quads();
+
+private:
+    void layout();
 };
 
 class Renderer
 {
     GLuint m_vertex_array;
-    GLuint m_vertex_buffer;
+    StreamBuffer m_quad_stream;
     GLuint m_program;
-    GLuint m_texture;
-    Font& m_font;
+    Font* m_font;
+
+    // Cell grids are drawn by their own program straight from a texture, see draw_grid.
+    GLuint m_grid_program;
+    GLuint m_grid_texture;
+    struct { int w, h; } m_grid_texture_size;
+    size_t m_grid_bytes_uploaded;
+
+    // Past these, a full upload is used instead of the dirty rects.
+    static const int GRID_MAX_DIRTY_RECTS           = 64;
+    static const int GRID_MAX_DIRTY_AREA_PERCENTAGE = 50;
     
     struct { float w, h; } m_frame_size;
 
-    // TODO: What should this be?
-    static const int QUAD_BUFFER_CAPACITY = 1024;
-    Array<Quad> m_colored_quads;
-    Array<Quad> m_textured_quads;
-    Array<Quad> m_text_quads;
+    // Quads are recorded as commands and only sorted and drawn on flush. The sort key
+    // orders them by layer first, so higher layers always end up on top, then by
+    // submission order, so overlapping quads on a layer draw in the order they were
+    // submitted whatever they sample:
+    //
+    //   63      56 55                         24 23            0
+    //   [ layer  ][                             ][ sequence     ]
+    //
+    // Images and the white texel colored quads sample live in the image atlas, glyphs in
+    // the single channel glyph atlas, whose pages are numbered after the image atlas's.
+    // A frame normally touches one page of each, and up to TEXTURE_SLOTS pages are bound
+    // per draw call, so a flush takes a single instanced draw across every layer. A new
+    // draw call only starts when a page that doesn't fit in the slots shows up.
+    static const int QUAD_BUFFER_CAPACITY   = 65536;
+    static const int TEXTURE_SLOTS          = 8;
+    static const int GRID_TEXTURE_UNIT      = TEXTURE_SLOTS;
+    static const int QUAD_STREAM_SEGMENTS   = 3;
+    static const int ATLAS_PAGE_SIZE        = 2048;
+    static const int GLYPH_ATLAS_PAGE_SIZE  = 1024;
+    static const int GLYPH_ATLAS_FIRST_PAGE = TextureAtlas::MAX_PAGES;
+
+    struct QuadBatch
+    {
+        uint32_t first;
+        uint32_t count;
+        uint32_t atlas_pages[TEXTURE_SLOTS];
+        int num_of_textures;
+    };
+
+    Array<QuadInstance> m_quads;
+    Array<uint32_t> m_quad_atlas_pages;
+    Array<uint64_t> m_sort_keys;
+    Array<uint32_t> m_sort_indices;
+    Array<uint64_t> m_scratch_sort_keys;
+    Array<uint32_t> m_scratch_sort_indices;
+    Array<QuadBatch> m_batches;
+
+    TextureAtlas m_atlas;
+
+    // Filtered linearly, distance fields need it and glyphs are rarely drawn at the size
+    // they were rasterized at.
+    TextureAtlas m_glyph_atlas;
+    TextureManager m_textures;
+
+    // Colored quads sample this so every quad can go through the same shader.
+    AtlasRegion m_white_region;
+
+    uint8_t m_layer;
+    size_t m_num_of_draw_calls;
+
+    // Immediate mode draw_text lays strings out into these, keyed by a hash of the string,
+    // size and font, so a string drawn again the next frame isn't laid out again. The
+    // least recently drawn one is reused once they're all taken.
+    static const int TEXT_CACHE_CAPACITY = 64;
+
+    struct CachedText
+    {
+        Text* text;
+        uint64_t hash;
+        uint64_t last_drawn_frame;
+    };
+
+    // The Texts themselves, their glyphs come from the permanent arena.
+    Pool m_text_pool;
+    Array<CachedText> m_text_cache;
+    HashMap<uint64_t, uint32_t> m_text_cache_slots;
+    uint64_t m_frame_index;
 
 public:
     Renderer(Font& font);
+    ~Renderer();
     void init();
 
     void draw_rect(Vec4<float> rect, Color color, const char* filepath, Vec4<float> tex_coords, QuadType type);
     void draw_rect(Vec4<float>, Color color);
     void draw_rect(Vec4<float>, const char* filepath);
+    void draw_rect(Vec4<float>, uint32_t texture_id);
     void draw_text(float x, float y, float text_size, const char* format, ...);
     void draw_text(float x, float y, Text& text);
 
+    // Flushes everything drawn this frame. Strings the immediate mode draw_text hasn't drawn
+    // for a while become the first to be evicted from its cache, and the same goes for the
+    // font's on demand glyphs.
+    void end_frame();
+
+    // Loads the image at `filepath` the first time and returns its id for draw_rect after
+    // that. Drawing by path works too, but costs a hash of the path every quad.
+    uint32_t load_texture(const char* filepath);
+
+    // Draws `width` x `height` bit-packed cells, one bit per cell and `bytes_per_row` bytes
+    // per row, lowest bit leftmost. `pan` is the cell at the top left of the frame and
+    // `zoom` the size of a cell in pixels. Issues a single draw call, pending quads are
+    // flushed first so they stay underneath.
+    //
+    // Without `dirty_rects` every byte is uploaded. Otherwise only the rects, in bytes and
+    // rows, are, and nothing at all if there are none. Many or large rects fall back to
+    // a full upload, which is cheaper than lots of small ones.
+    void draw_grid(const void* cells, int bytes_per_row, int width, int height, Vec2<float> pan, float zoom, Color color,
+                   const Vec4<int>* dirty_rects = nullptr, int num_of_dirty_rects = 0);
+
+    // Bytes of cell data draw_grid sent to the GPU since the last call to this.
+    size_t take_grid_bytes_uploaded();
+
+    // Quads drawn from now on go on this layer. Higher layers draw over lower ones no
+    // matter the order they were submitted in.
+    void set_layer(uint8_t layer);
+
+    // Draw calls issued since the last call to this.
+    size_t take_num_of_draw_calls();
+
+    // Times the CPU waited for the GPU before it could stream more quads.
+    size_t get_num_of_fence_waits();
+
+    // The font's glyphs are uploaded once, here if the renderer is initialized already and
+    // in init otherwise.
     void set_font(Font& font);
     void set_frame_size(float w, float h);
     void clear(Color color);
@@ -265,14 +480,13 @@ public:
     void flush();
 
 private:
-    void push_quad_colored(Quad quad);
-    void push_quad_textured(Quad quad);
-    void push_quad_text(Quad quad);
+    void push_quad(QuadInstance quad, uint32_t atlas_page);
+    Text& get_cached_text(float text_size, const char* string, int length);
+    void build_batches(size_t num_of_quads, QuadInstance* sorted_quads);
+    void bind_texture(int slot, uint32_t atlas_page);
+    Vec4<float> get_atlas_tex_coords(AtlasRegion region);
+    void set_instance_attributes(size_t first_instance);
 
-    void flush_colored();
-    void flush_textured();
-    void flush_text();
-    
     const char* get_shader_type_string(GLenum type);
     GLuint create_shader(const char* source, GLenum type);
     GLuint create_program(const char* vertex_source, const char* fragment_source);
@@ -1,12 +1,18 @@
+// Quads are instanced, one record per quad, and the four corners are generated from
+// gl_VertexID. `texture_slot` picks one of the textures bound for the draw call and
+// `flags` how it's sampled, see QuadFlags.
 static const char* vertex_source = R"(
 #version 300 es
 
-in vec2 position;
-in vec4 color;
-in vec2 tex_coords;
+layout(location = 0) in vec4 rect;
+layout(location = 1) in vec4 tex_rect;
+layout(location = 2) in vec4 color;
+layout(location = 3) in uvec2 texture_slot_and_flags;
 
 out vec4 frag_color;
 out vec2 frag_tex_coords;
+flat out uint frag_texture_slot;
+flat out uint frag_flags;
 
 uniform vec2 frame_size;
 
@@ -20,11 +26,16 @@ vec2 frame_to_gl_space(vec2 point)
 
 void main()
 {
+    vec2 corner   = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 position = mix(rect.xy, rect.zw, corner);
+
     vec2 position_in_gl_space = frame_to_gl_space(position);
     gl_Position = vec4(position_in_gl_space, 1, 1);
 
     frag_color = color;
-    frag_tex_coords = tex_coords;
+    frag_tex_coords = mix(tex_rect.xy, tex_rect.zw, corner);
+    frag_texture_slot = texture_slot_and_flags.x;
+    frag_flags = texture_slot_and_flags.y;
 }
 
 )";
@@ -35,19 +46,98 @@ precision mediump float;
 
 in vec4 frag_color;
 in vec2 frag_tex_coords;
+flat in uint frag_texture_slot;
+flat in uint frag_flags;
 
 out vec4 color;
 
-uniform bool is_textured;
+// Must match QuadFlags in renderer.hpp.
+const uint QUAD_FLAG_SDF = 1u;
+
+// Sampler arrays can only be indexed by constants in GLSL ES 3.00.
+uniform sampler2D samplers[8];
 
-uniform sampler2D sampler;
+vec4 sample_slot(uint slot, vec2 tex_coords)
+{
+    switch (slot)
+    {
+        case 0u: return texture(samplers[0], tex_coords);
+        case 1u: return texture(samplers[1], tex_coords);
+        case 2u: return texture(samplers[2], tex_coords);
+        case 3u: return texture(samplers[3], tex_coords);
+        case 4u: return texture(samplers[4], tex_coords);
+        case 5u: return texture(samplers[5], tex_coords);
+        case 6u: return texture(samplers[6], tex_coords);
+        default: return texture(samplers[7], tex_coords);
+    }
+}
 
 void main()
 {
-    if (is_textured)
-        color = texture(sampler, frag_tex_coords) * frag_color;
+    vec4 texel = sample_slot(frag_texture_slot, frag_tex_coords);
+
+    if ((frag_flags & QUAD_FLAG_SDF) != 0u)
+    {
+        // Signed distance field glyphs are 0.5 on the outline. The edge is smoothed over
+        // about a pixel on screen, however large the glyph is drawn.
+        float distance   = texel.r;
+        float edge_width = max(0.7f * fwidth(distance), 0.0001f);
+        float coverage   = smoothstep(0.5f - edge_width, 0.5f + edge_width, distance);
+        color = vec4(frag_color.rgb, frag_color.a * coverage);
+    }
     else
-        color = frag_color;
+    {
+        color = texel * frag_color;
+    }
+}
+
+)";
+
+// Draws a bit-packed cell grid as a single quad. Each byte of the R8UI texture holds
+// eight horizontally adjacent cells, lowest bit leftmost, so the upload is one bit per
+// cell. The quad covers the whole frame and is generated from gl_VertexID.
+static const char* grid_vertex_source = R"(
+#version 300 es
+
+void main()
+{
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    gl_Position = vec4(corner * 2.0f - 1.0f, 0, 1);
+}
+
+)";
+
+static const char* grid_fragment_source = R"(
+#version 300 es
+precision highp float;
+precision highp int;
+
+out vec4 color;
+
+uniform vec2 frame_size;
+
+// Cell coordinate at the top left corner of the frame, and pixels per cell.
+uniform vec2 pan;
+uniform float zoom;
+
+uniform ivec2 grid_size;
+uniform vec4 cell_color;
+
+uniform highp usampler2D grid;
+
+void main()
+{
+    vec2 pixel = vec2(gl_FragCoord.x, frame_size.y - gl_FragCoord.y);
+    ivec2 cell = ivec2(floor(pan + pixel / zoom));
+
+    if (cell.x < 0 || cell.y < 0 || cell.x >= grid_size.x || cell.y >= grid_size.y)
+        discard;
+
+    uint cells = texelFetch(grid, ivec2(cell.x >> 3, cell.y), 0).r;
+    if (((cells >> uint(cell.x & 7)) & 1u) == 0u)
+        discard;
+
+    color = cell_color;
 }
 
 )";
@@ -0,0 +1,252 @@
+#include "simulation.hpp"
+
+Simulation::Simulation(LifeEngine& engine, uint64_t generations_per_step, uint64_t max_steps_per_second)
+: m_engine(engine)
+, m_generations_per_step(generations_per_step)
+, m_max_steps_per_second(max_steps_per_second)
+, m_was_last_frame_acquired(false)
+, m_last_region()
+, m_thread()
+, m_is_running(false)
+, m_view_width(1)
+, m_view_height(1)
+, m_generations_per_second(0)
+, m_snapshot_writer(nullptr)
+, m_snapshot_filepath(nullptr)
+, m_snapshot_interval(0)
+, m_next_snapshot_generation(0)
+, m_history(nullptr)
+, m_is_paused(false)
+, m_num_of_seek_steps(0)
+{}
+
+Simulation::~Simulation()
+{
+    stop();
+}
+
+void Simulation::start()
+{
+    assert(!m_is_running);
+
+    // Publishes the starting generation so there's something to draw straight away.
+    publish_frame();
+    if (m_history)
+        m_history->record(m_engine);
+
+    __atomic_store_n(&m_is_running, true, __ATOMIC_RELEASE);
+    int result = pthread_create(&m_thread, nullptr, thread_main, this);
+    assert_with_message(result == 0, "Failed to create the simulation thread");
+}
+
+void Simulation::stop()
+{
+    if (!__atomic_load_n(&m_is_running, __ATOMIC_ACQUIRE))
+        return;
+
+    __atomic_store_n(&m_is_running, false, __ATOMIC_RELEASE);
+    pthread_join(m_thread, nullptr);
+}
+
+void Simulation::set_view_size(int width, int height)
+{
+    __atomic_store_n(&m_view_width,  max(width, 1),  __ATOMIC_RELAXED);
+    __atomic_store_n(&m_view_height, max(height, 1), __ATOMIC_RELAXED);
+}
+
+void Simulation::set_snapshots(SnapshotWriter* writer, const char* filepath, uint64_t interval)
+{
+    assert(!m_is_running && interval > 0);
+
+    m_snapshot_writer          = writer;
+    m_snapshot_filepath        = filepath;
+    m_snapshot_interval        = interval;
+    m_next_snapshot_generation = m_engine.get_generation() + interval;
+}
+
+void Simulation::set_history(LifeHistory* history)
+{
+    assert(!m_is_running);
+    m_history = history;
+}
+
+void Simulation::set_paused(bool is_paused)
+{
+    __atomic_store_n(&m_is_paused, is_paused, __ATOMIC_RELEASE);
+}
+
+bool Simulation::is_paused()
+{
+    return __atomic_load_n(&m_is_paused, __ATOMIC_ACQUIRE);
+}
+
+void Simulation::seek(int64_t num_of_steps)
+{
+    set_paused(true);
+    __atomic_add_fetch(&m_num_of_seek_steps, num_of_steps, __ATOMIC_ACQ_REL);
+}
+
+LifeFrame& Simulation::get_latest_frame(bool& is_new_frame)
+{
+    is_new_frame = m_frames.acquire();
+    return m_frames.get_read_slot();
+}
+
+double Simulation::get_generations_per_second()
+{
+    double generations_per_second;
+    __atomic_load(&m_generations_per_second, &generations_per_second, __ATOMIC_RELAXED);
+    return generations_per_second;
+}
+
+/* -------------------------------------- Thread -------------------------------------- */
+
+void* Simulation::thread_main(void* simulation)
+{
+    static_cast<Simulation*>(simulation)->run();
+    return nullptr;
+}
+
+void Simulation::run()
+{
+    double step_interval = m_max_steps_per_second ? 1.0 / m_max_steps_per_second : 0;
+    double next_step_time = get_time_in_seconds();
+
+    double rate_start_time        = next_step_time;
+    uint64_t rate_start_generation = m_engine.get_generation();
+
+    while (__atomic_load_n(&m_is_running, __ATOMIC_ACQUIRE))
+    {
+        int64_t num_of_seek_steps = __atomic_exchange_n(&m_num_of_seek_steps, 0, __ATOMIC_ACQ_REL);
+        if (num_of_seek_steps)
+        {
+            step_through_history(num_of_seek_steps);
+            publish_frame();
+
+            // Going back would count as a negative rate.
+            rate_start_time       = get_time_in_seconds();
+            rate_start_generation = m_engine.get_generation();
+        }
+        else if (is_paused())
+        {
+            timespec sleep_time = { 0, 1000000 };
+            nanosleep(&sleep_time, nullptr);
+            next_step_time = get_time_in_seconds();
+        }
+        else
+        {
+            if (step_interval > 0)
+            {
+                double wait_time = next_step_time - get_time_in_seconds();
+                if (wait_time > 0)
+                {
+                    timespec sleep_time = { (time_t) wait_time, (long) ((wait_time - (time_t) wait_time) * 1e9) };
+                    nanosleep(&sleep_time, nullptr);
+                }
+
+                // Doesn't try to catch up after falling behind, that would only make it fall
+                // further behind.
+                next_step_time = max(next_step_time + step_interval, get_time_in_seconds());
+            }
+
+            m_engine.step(m_generations_per_step);
+            publish_frame();
+            if (m_history)
+                m_history->record(m_engine);
+
+            // Skipped while the last snapshot is still being written, and tried again after
+            // the next step.
+            if (m_snapshot_writer && m_engine.get_generation() >= m_next_snapshot_generation &&
+                m_snapshot_writer->save(m_engine, m_snapshot_filepath))
+            {
+                m_next_snapshot_generation = m_engine.get_generation() + m_snapshot_interval;
+            }
+        }
+
+        double current_time = get_time_in_seconds();
+        if (current_time - rate_start_time >= 0.5)
+        {
+            uint64_t generation           = m_engine.get_generation();
+            double generations_per_second = (generation - rate_start_generation) / (current_time - rate_start_time);
+            __atomic_store(&m_generations_per_second, &generations_per_second, __ATOMIC_RELAXED);
+
+            rate_start_time       = current_time;
+            rate_start_generation = generation;
+        }
+    }
+}
+
+// Going back never goes further than the oldest recorded generation. Going forward takes
+// what's recorded, then steps.
+void Simulation::step_through_history(int64_t num_of_steps)
+{
+    uint64_t generation = m_engine.get_generation();
+    uint64_t distance   = (uint64_t) (num_of_steps < 0 ? -num_of_steps : num_of_steps) * m_generations_per_step;
+
+    if (num_of_steps < 0)
+    {
+        if (m_history)
+            m_history->restore(m_engine, generation - min(distance, generation - m_history->get_oldest_generation()));
+
+        return;
+    }
+
+    uint64_t target_generation = generation + distance;
+    if (m_history && m_history->get_newest_generation() > generation)
+        m_history->restore(m_engine, target_generation);
+
+    while (m_engine.get_generation() < target_generation)
+    {
+        m_engine.step(m_generations_per_step);
+        if (m_history)
+            m_history->record(m_engine);
+    }
+}
+
+void Simulation::publish_frame()
+{
+    LifeFrame& frame = m_frames.get_write_slot();
+    capture_frame(frame);
+
+    LifeDirtyTiles& dirty_tiles = frame.get_dirty_tiles();
+    bool is_same_region = m_last_region.x == frame.get_x() && m_last_region.y == frame.get_y() &&
+                          m_last_region.w == frame.get_width() && m_last_region.h == frame.get_height() &&
+                          m_last_region.level == frame.get_level();
+    if (!is_same_region)
+        dirty_tiles.mark_all();
+
+    m_last_region = { frame.get_x(), frame.get_y(), frame.get_width(), frame.get_height(), frame.get_level() };
+
+    // The render thread has at least the frame before the last one, so only the changes
+    // since then are still pending. Otherwise they keep piling up.
+    if (m_was_last_frame_acquired)
+        m_pending_dirty_tiles.copy_from(m_last_dirty_tiles);
+
+    m_last_dirty_tiles.copy_from(dirty_tiles);
+    m_pending_dirty_tiles.merge(dirty_tiles);
+    dirty_tiles.copy_from(m_pending_dirty_tiles);
+
+    m_was_last_frame_acquired = m_frames.publish();
+}
+
+// Picks the smallest block level at which the engine's bounds fit in the view, and
+// captures that region.
+void Simulation::capture_frame(LifeFrame& frame)
+{
+    int view_width  = __atomic_load_n(&m_view_width,  __ATOMIC_RELAXED);
+    int view_height = __atomic_load_n(&m_view_height, __ATOMIC_RELAXED);
+
+    int64_t x0, y0, x1, y1;
+    m_engine.get_bounds(x0, y0, x1, y1);
+
+    int level = 0;
+    while (((x1 - x0) >> level) > view_width || ((y1 - y0) >> level) > view_height)
+        level++;
+
+    int64_t block_size = 1ll << level;
+    int frame_w        = max<int64_t>((x1 - x0 + block_size - 1) >> level, 1);
+    int frame_h        = max<int64_t>((y1 - y0 + block_size - 1) >> level, 1);
+    frame.set_region(x0, y0, frame_w, frame_h, level);
+
+    m_engine.capture(frame);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "life.hpp"
+#include "history.hpp"
+#include "snapshot.hpp"
+#include "triple_buffer.hpp"
+
+// Runs a LifeEngine on its own thread so a slow generation never holds up rendering or
+// input. After every step the thread captures the part of the universe that fits the view
+// into a LifeFrame and publishes it through a triple buffer, the render thread picks up
+// the newest one each frame without blocking.
+//
+// Only the simulation thread touches the engine while it's running.
+class Simulation
+{
+    LifeEngine& m_engine;
+    uint64_t m_generations_per_step;
+    uint64_t m_max_steps_per_second;
+
+    TripleBuffer<LifeFrame> m_frames;
+
+    // Frames can be dropped before the render thread sees them, so a frame's dirty tiles
+    // have to cover everything since the last frame known to have been acquired, not just
+    // since the previous one.
+    LifeDirtyTiles m_pending_dirty_tiles;
+    LifeDirtyTiles m_last_dirty_tiles;
+    bool m_was_last_frame_acquired;
+    struct { int64_t x, y; int w, h, level; } m_last_region;
+
+    pthread_t m_thread;
+    bool m_is_running;
+
+    // Written by the render thread.
+    int m_view_width;
+    int m_view_height;
+
+    // Written by the simulation thread.
+    double m_generations_per_second;
+
+    // Optional checkpoints every so many generations.
+    SnapshotWriter* m_snapshot_writer;
+    const char* m_snapshot_filepath;
+    uint64_t m_snapshot_interval;
+    uint64_t m_next_snapshot_generation;
+
+    // Optional, every step is recorded so the render thread can go back through them.
+    LifeHistory* m_history;
+
+    // Written by the render thread, the seek steps are taken and zeroed by the simulation
+    // thread.
+    bool m_is_paused;
+    int64_t m_num_of_seek_steps;
+
+public:
+    // Zero `max_steps_per_second` steps as fast as the engine allows.
+    Simulation(LifeEngine& engine, uint64_t generations_per_step, uint64_t max_steps_per_second);
+    ~Simulation();
+
+    void start();
+    void stop();
+
+    // Size in pixels of the area frames are drawn into, frames are captured at the finest
+    // level that fits the engine's bounds in it.
+    void set_view_size(int width, int height);
+
+    // Saves a snapshot to `filepath` through `writer` every `interval` generations, from
+    // the simulation thread between steps. Must be set before the simulation starts.
+    void set_snapshots(SnapshotWriter* writer, const char* filepath, uint64_t interval);
+
+    // Records the starting generation and every step after it in `history`. Must be set
+    // before the simulation starts.
+    void set_history(LifeHistory* history);
+
+    // Render thread only. Stops stepping, or carries on from the generation last shown.
+    void set_paused(bool is_paused);
+    bool is_paused();
+
+    // Render thread only. Pauses and moves `num_of_steps` steps back through the history,
+    // or forward, stepping the engine again once past the newest recorded generation.
+    void seek(int64_t num_of_steps);
+
+    // Render thread only. Returns the latest published frame, which stays valid until the
+    // next call. `is_new_frame` is false when it's the same frame as last time. A new
+    // frame's dirty tiles cover every change since the previous frame returned.
+    LifeFrame& get_latest_frame(bool& is_new_frame);
+
+    double get_generations_per_second();
+
+private:
+    static void* thread_main(void* simulation);
+
+    void run();
+    void step_through_history(int64_t num_of_steps);
+    void publish_frame();
+    void capture_frame(LifeFrame& frame);
+};
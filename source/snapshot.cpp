@@ -0,0 +1,303 @@
+#include "snapshot.hpp"
+
+static const uint32_t SNAPSHOT_MAGIC   = 0x534C4F47; // "GOLS"
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+// B3/S23, the only rule the engines run.
+static const uint32_t LIFE_BIRTH_MASK    = 1 << 3;
+static const uint32_t LIFE_SURVIVAL_MASK = (1 << 2) | (1 << 3);
+
+// The buffer is made of words, so the header and the tile table have to be too.
+static_assert(sizeof(SnapshotHeader) % sizeof(uint64_t) == 0, "SnapshotHeader must be a whole number of words");
+static_assert(sizeof(SnapshotTile) % sizeof(uint64_t) == 0, "SnapshotTile must be a whole number of words");
+
+static const size_t HEADER_WORDS = sizeof(SnapshotHeader) / sizeof(uint64_t);
+static const size_t TILE_WORDS   = sizeof(SnapshotTile) / sizeof(uint64_t);
+
+/* -------------------------------------- Saving -------------------------------------- */
+
+struct SnapshotEncoder
+{
+    Array<uint64_t>& buffer;
+    Array<SnapshotTile> tiles;
+};
+
+static void encode_tile(void* data, int64_t tile_x, int64_t tile_y, const uint64_t* rows, int num_of_rows, size_t stride)
+{
+    SnapshotEncoder& encoder = *static_cast<SnapshotEncoder*>(data);
+
+    uint64_t row_mask = 0;
+    for (int row = 0; row < num_of_rows; row++)
+    {
+        uint64_t word = rows[row * stride];
+        if (word)
+        {
+            row_mask |= 1ull << row;
+            encoder.buffer.push(word);
+        }
+    }
+
+    if (row_mask)
+        encoder.tiles.push({ (int32_t) tile_x, (int32_t) tile_y, row_mask });
+}
+
+bool snapshot_encode(LifeEngine& engine, Array<uint64_t>& buffer)
+{
+    // The header goes in last, once the counts are known.
+    buffer.clear();
+    for (size_t i = 0; i < HEADER_WORDS; i++)
+        buffer.push(0);
+
+    SnapshotEncoder encoder = { buffer, Array<SnapshotTile>() };
+    if (!engine.visit_tiles(encode_tile, &encoder))
+        return false;
+
+    SnapshotHeader header = {};
+    header.magic          = SNAPSHOT_MAGIC;
+    header.version        = SNAPSHOT_VERSION;
+    header.birth_mask     = LIFE_BIRTH_MASK;
+    header.survival_mask  = LIFE_SURVIVAL_MASK;
+    header.generation     = engine.get_generation();
+    header.num_of_words   = buffer.get_used() - HEADER_WORDS;
+    header.num_of_tiles   = encoder.tiles.get_used();
+    engine.get_bounds(header.x0, header.y0, header.x1, header.y1);
+
+    buffer.reserve(buffer.get_used() + encoder.tiles.get_used() * TILE_WORDS);
+    for (size_t i = 0; i < encoder.tiles.get_used(); i++)
+    {
+        uint64_t tile_words[TILE_WORDS];
+        memcpy(tile_words, &encoder.tiles[i], sizeof(SnapshotTile));
+        for (size_t word = 0; word < TILE_WORDS; word++)
+            buffer.push(tile_words[word]);
+    }
+
+    memcpy(buffer.get_underlying_buffer(), &header, sizeof(header));
+    return true;
+}
+
+bool snapshot_write(const char* filepath, Array<uint64_t>& buffer)
+{
+    FileReplacement replacement;
+    if (!replacement.open(filepath))
+        return false;
+
+    size_t num_of_words = buffer.get_used();
+    fwrite(buffer.get_underlying_buffer(), sizeof(uint64_t), num_of_words, replacement.get_file());
+    return replacement.commit();
+}
+
+bool snapshot_save(LifeEngine& engine, const char* filepath)
+{
+    Array<uint64_t> buffer;
+    return snapshot_encode(engine, buffer) && snapshot_write(filepath, buffer);
+}
+
+/* ------------------------------------- Restoring ------------------------------------ */
+
+static bool fail(SnapshotInfo& info, const char* error)
+{
+    info.error = error;
+    return false;
+}
+
+bool snapshot_get_info(File& file, SnapshotInfo& info)
+{
+    info = {};
+
+    size_t size = file.get_size();
+    if (size < sizeof(SnapshotHeader))
+        return fail(info, "Too small to be a snapshot");
+
+    SnapshotHeader header;
+    memcpy(&header, file.get_data(), sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC)
+        return fail(info, "Not a snapshot");
+
+    if (header.version != SNAPSHOT_VERSION)
+        return fail(info, "Snapshot is from another version");
+
+    if (header.birth_mask != LIFE_BIRTH_MASK || header.survival_mask != LIFE_SURVIVAL_MASK)
+        return fail(info, "Snapshot is of a rule other than B3/S23");
+
+    // Compared piece by piece so broken counts can't overflow the sum.
+    size_t payload_size = size - sizeof(SnapshotHeader);
+    if (header.num_of_words > payload_size / sizeof(uint64_t) ||
+        header.num_of_tiles != (payload_size - header.num_of_words * sizeof(uint64_t)) / sizeof(SnapshotTile) ||
+        (payload_size - header.num_of_words * sizeof(uint64_t)) % sizeof(SnapshotTile) != 0)
+    {
+        return fail(info, "Snapshot is cut short or has trailing data");
+    }
+
+    // Every stored row has to be inside the bounds, which is what a grid is sized from.
+    const uint8_t* data       = static_cast<const uint8_t*>(file.get_data());
+    const SnapshotTile* tiles = reinterpret_cast<const SnapshotTile*>(data + sizeof(SnapshotHeader) + header.num_of_words * sizeof(uint64_t));
+    uint64_t num_of_rows      = 0;
+    for (uint64_t i = 0; i < header.num_of_tiles; i++)
+    {
+        SnapshotTile tile = tiles[i];
+        if (!tile.row_mask)
+            return fail(info, "Snapshot has an empty tile");
+
+        int64_t x0 = (int64_t) tile.x * LIFE_TILE_SIZE;
+        int64_t y0 = (int64_t) tile.y * LIFE_TILE_SIZE + __builtin_ctzll(tile.row_mask);
+        int64_t y1 = (int64_t) tile.y * LIFE_TILE_SIZE + LIFE_TILE_SIZE - __builtin_clzll(tile.row_mask);
+        if (x0 < header.x0 || x0 + LIFE_TILE_SIZE > header.x1 || y0 < header.y0 || y1 > header.y1)
+            return fail(info, "Snapshot has a tile outside its bounds");
+
+        num_of_rows += __builtin_popcountll(tile.row_mask);
+    }
+
+    if (num_of_rows != header.num_of_words)
+        return fail(info, "Snapshot's tiles don't add up to its words");
+
+    info.generation   = header.generation;
+    info.x0           = header.x0;
+    info.y0           = header.y0;
+    info.x1           = header.x1;
+    info.y1           = header.y1;
+    info.num_of_tiles = header.num_of_tiles;
+    return true;
+}
+
+bool snapshot_restore(File& file, LifeEngine& engine, int64_t x, int64_t y, SnapshotInfo& info)
+{
+    SnapshotHeader header;
+    memcpy(&header, file.get_data(), sizeof(header));
+
+    // Mappings start on a page and heap copies are aligned, so the words can be read in
+    // place.
+    const uint8_t* data       = static_cast<const uint8_t*>(file.get_data());
+    const uint64_t* words     = reinterpret_cast<const uint64_t*>(data + sizeof(SnapshotHeader));
+    const SnapshotTile* tiles = reinterpret_cast<const SnapshotTile*>(words + header.num_of_words);
+
+    uint64_t num_of_cells = 0;
+    for (uint64_t i = 0; i < header.num_of_tiles; i++)
+    {
+        SnapshotTile tile = tiles[i];
+        int64_t tile_x    = x + (int64_t) tile.x * LIFE_TILE_SIZE;
+        int64_t tile_y    = y + (int64_t) tile.y * LIFE_TILE_SIZE;
+
+        uint64_t row_mask = tile.row_mask;
+        while (row_mask)
+        {
+            int row = __builtin_ctzll(row_mask);
+            row_mask &= row_mask - 1;
+
+            num_of_cells += __builtin_popcountll(*words);
+            engine.set_row(tile_x, tile_y + row, words++, 1);
+        }
+    }
+
+    engine.set_generation(header.generation);
+    info.num_of_cells = num_of_cells;
+    return true;
+}
+
+/* ---------------------------------- SnapshotWriter ---------------------------------- */
+
+SnapshotWriter::SnapshotWriter()
+: m_is_busy(false)
+, m_is_shutting_down(false)
+, m_num_of_saved(0)
+, m_num_of_skipped(0)
+{
+    m_filepath[0] = '\0';
+
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_work_ready, nullptr);
+    pthread_cond_init(&m_work_done, nullptr);
+
+    int result = pthread_create(&m_thread, nullptr, thread_main, this);
+    assert_with_message(result == 0, "Failed to create the snapshot writer thread");
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_is_shutting_down = true;
+    pthread_cond_signal(&m_work_ready);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_join(m_thread, nullptr);
+
+    pthread_cond_destroy(&m_work_done);
+    pthread_cond_destroy(&m_work_ready);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool SnapshotWriter::save(LifeEngine& engine, const char* filepath)
+{
+    pthread_mutex_lock(&m_mutex);
+    bool is_busy = m_is_busy;
+    if (is_busy)
+        m_num_of_skipped++;
+    pthread_mutex_unlock(&m_mutex);
+
+    // The writer thread doesn't touch the buffer until it's handed over below.
+    if (is_busy || !snapshot_encode(engine, m_buffer))
+        return false;
+
+    pthread_mutex_lock(&m_mutex);
+    snprintf(m_filepath, sizeof(m_filepath), "%s", filepath);
+    m_is_busy = true;
+    pthread_cond_signal(&m_work_ready);
+    pthread_mutex_unlock(&m_mutex);
+    return true;
+}
+
+void SnapshotWriter::wait()
+{
+    pthread_mutex_lock(&m_mutex);
+    while (m_is_busy)
+        pthread_cond_wait(&m_work_done, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+size_t SnapshotWriter::get_num_of_saved()
+{
+    pthread_mutex_lock(&m_mutex);
+    size_t num_of_saved = m_num_of_saved;
+    pthread_mutex_unlock(&m_mutex);
+    return num_of_saved;
+}
+
+size_t SnapshotWriter::get_num_of_skipped()
+{
+    pthread_mutex_lock(&m_mutex);
+    size_t num_of_skipped = m_num_of_skipped;
+    pthread_mutex_unlock(&m_mutex);
+    return num_of_skipped;
+}
+
+void* SnapshotWriter::thread_main(void* writer)
+{
+    static_cast<SnapshotWriter*>(writer)->run();
+    return nullptr;
+}
+
+void SnapshotWriter::run()
+{
+    pthread_mutex_lock(&m_mutex);
+    for (;;)
+    {
+        // Shutting down only once the snapshot in flight is written.
+        while (!m_is_busy && !m_is_shutting_down)
+            pthread_cond_wait(&m_work_ready, &m_mutex);
+
+        if (!m_is_busy)
+            break;
+
+        pthread_mutex_unlock(&m_mutex);
+        bool is_written = snapshot_write(m_filepath, m_buffer);
+        if (!is_written)
+            fprintf(stderr, "Could not write snapshot: %s\n", m_filepath);
+        pthread_mutex_lock(&m_mutex);
+
+        if (is_written)
+            m_num_of_saved++;
+
+        m_is_busy = false;
+        pthread_cond_broadcast(&m_work_done);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
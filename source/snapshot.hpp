@@ -0,0 +1,119 @@
+#pragma once
+
+#include "utils.hpp"
+#include "life.hpp"
+
+// A checkpoint of an engine that keeps its cells in tiles, from which a run can carry on
+// exactly where it was. The file is laid out so that saving is one write of a buffer the
+// tiles were copied into, and restoring reads straight out of a mapping, word by word
+// rather than cell by cell:
+//
+//   SnapshotHeader
+//   The words of every row with live cells, tile after tile, top to bottom.
+//   A SnapshotTile per tile, its `row_mask` saying which rows those words are.
+//
+// Rows with nothing alive aren't stored at all, so sparse boards stay small while dense
+// ones cost one bit per cell and a little for the tile table.
+//
+// Native endian like the font cache. Snapshots are for resuming on the same machine, not
+// for sharing patterns, which is what RLE and macrocells are for.
+struct SnapshotHeader
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // Bit n is set if a cell with n neighbours is born, or survives. Always B3/S23 for
+    // now, but a snapshot of another rule must not be resumed as this one.
+    uint32_t birth_mask;
+    uint32_t survival_mask;
+
+    uint64_t generation;
+
+    // What get_bounds returned, the whole board for the grid.
+    int64_t x0, y0, x1, y1;
+
+    uint64_t num_of_words;
+    uint64_t num_of_tiles;
+};
+
+struct SnapshotTile
+{
+    int32_t x, y;
+    uint64_t row_mask;
+};
+
+struct SnapshotInfo
+{
+    uint64_t generation;
+    int64_t x0, y0, x1, y1;
+    uint64_t num_of_tiles;
+
+    // Live cells written by snapshot_restore.
+    uint64_t num_of_cells;
+
+    // Why the last call failed.
+    const char* error;
+};
+
+// Copies the engine's tiles into `buffer` laid out as the file. Only reads the engine, so
+// it can run between two generations on the thread stepping it. Returns false if the
+// engine doesn't keep its cells in tiles.
+bool snapshot_encode(LifeEngine& engine, Array<uint64_t>& buffer);
+
+// Writes an encoded snapshot with a FileReplacement, so there's always a whole snapshot at
+// `filepath` even if this one is cut short.
+bool snapshot_write(const char* filepath, Array<uint64_t>& buffer);
+
+bool snapshot_save(LifeEngine& engine, const char* filepath);
+
+// Checks the header and the tile table against the size of the file.
+bool snapshot_get_info(File& file, SnapshotInfo& info);
+
+// Sets the snapshot's live cells in `engine` offset by (x, y), and its generation. Cells
+// already alive stay alive, so the engine should start out empty. `info` must come from
+// snapshot_get_info on the same file.
+bool snapshot_restore(File& file, LifeEngine& engine, int64_t x, int64_t y, SnapshotInfo& info);
+
+/* ---------------------------------- SnapshotWriter ---------------------------------- */
+
+// Saves snapshots without holding up the simulation. The engine is copied into the
+// writer's buffer by the thread calling save, between generations, which is a pass over
+// the live words at memory speed. Writing the file, the slow part, is left to a thread of
+// its own while the simulation carries on from the copy.
+class SnapshotWriter
+{
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work_ready;
+    pthread_cond_t m_work_done;
+
+    // Belong to the writer thread while a snapshot is being written.
+    Array<uint64_t> m_buffer;
+    char m_filepath[1024];
+    bool m_is_busy;
+
+    bool m_is_shutting_down;
+    size_t m_num_of_saved;
+    size_t m_num_of_skipped;
+
+public:
+    SnapshotWriter();
+
+    // Finishes the snapshot being written first.
+    ~SnapshotWriter();
+
+    // Returns once the engine is copied. Skipped, returning false, if the last snapshot is
+    // still being written or the engine can't be snapshotted. Checkpoints come round
+    // again, so nothing waits.
+    bool save(LifeEngine& engine, const char* filepath);
+
+    // Blocks until the snapshot being written, if any, is on disk.
+    void wait();
+
+    size_t get_num_of_saved();
+    size_t get_num_of_skipped();
+
+private:
+    static void* thread_main(void* writer);
+    void run();
+};
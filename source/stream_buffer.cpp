@@ -0,0 +1,147 @@
+#include "stream_buffer.hpp"
+
+StreamBuffer::StreamBuffer()
+: m_buffer(0)
+, m_target(0)
+, m_segment_size(0)
+, m_num_of_segments(0)
+, m_is_persistent(false)
+, m_persistent_data(nullptr)
+, m_current_segment(0)
+, m_segment_offset(0)
+, m_write_offset(0)
+, m_write_size(0)
+, m_num_of_fence_waits(0)
+{}
+
+StreamBuffer::~StreamBuffer()
+{
+    // The context may already be gone at exit, in which case the driver cleans up.
+    if (!m_buffer || !SDL_GL_GetCurrentContext())
+        return;
+
+    for (int i = 0; i < m_num_of_segments; i++)
+    {
+        if (m_segments[i].fence)
+            glDeleteSync(m_segments[i].fence);
+    }
+
+    glBindBuffer(m_target, m_buffer);
+    if (m_is_persistent)
+        glUnmapBuffer(m_target);
+
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::init(GLenum target, size_t segment_size, int num_of_segments)
+{
+    assert(!m_buffer);
+    assert(segment_size > 0 && num_of_segments >= 2);
+
+    m_target          = target;
+    m_segment_size    = segment_size;
+    m_num_of_segments = num_of_segments;
+
+    m_segments.resize(num_of_segments);
+    m_segments.clear_and_zero();
+
+    size_t buffer_size = segment_size * num_of_segments;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+
+    m_is_persistent = GLEW_ARB_buffer_storage;
+    if (m_is_persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(m_target, buffer_size, nullptr, flags);
+        m_persistent_data = static_cast<uint8_t*>(glMapBufferRange(m_target, 0, buffer_size, flags));
+        assert_with_message(m_persistent_data, "Failed to persistently map the stream buffer");
+    }
+    else
+    {
+        glBufferData(m_target, buffer_size, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void* StreamBuffer::begin_write(size_t size, size_t& buffer_offset)
+{
+    assert_with_message(size <= m_segment_size, "Write of %zu bytes is larger than a segment", size);
+    assert(m_write_size == 0);
+
+    if (m_segment_offset + size > m_segment_size)
+        move_to_next_segment();
+
+    m_write_offset = m_current_segment * m_segment_size + m_segment_offset;
+    m_write_size   = size;
+    buffer_offset  = m_write_offset;
+    m_segment_offset += size;
+
+    if (m_is_persistent)
+        return m_persistent_data + m_write_offset;
+
+    // The fences already keep the GPU off this range, so there's nothing to synchronize.
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    void* data = glMapBufferRange(m_target, m_write_offset, size, flags);
+    assert_with_message(data, "Failed to map %zu bytes of the stream buffer", size);
+    return data;
+}
+
+void StreamBuffer::end_write()
+{
+    if (!m_is_persistent && m_write_size)
+        glUnmapBuffer(m_target);
+
+    m_write_size = 0;
+}
+
+void StreamBuffer::fence()
+{
+    Segment& segment = m_segments[m_current_segment];
+    if (segment.fence)
+        glDeleteSync(segment.fence);
+
+    segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint StreamBuffer::get_buffer()
+{
+    return m_buffer;
+}
+
+size_t StreamBuffer::get_num_of_fence_waits()
+{
+    return m_num_of_fence_waits;
+}
+
+bool StreamBuffer::is_persistent()
+{
+    return m_is_persistent;
+}
+
+void StreamBuffer::move_to_next_segment()
+{
+    m_current_segment = (m_current_segment + 1) % m_num_of_segments;
+    m_segment_offset  = 0;
+
+    Segment& segment = m_segments[m_current_segment];
+    if (!segment.fence)
+        return;
+
+    // Polls first so waits that didn't actually block aren't counted.
+    GLenum status = glClientWaitSync(segment.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        m_num_of_fence_waits++;
+
+        uint64_t timeout_in_ns = 1000000000;
+        do
+        {
+            status = glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_in_ns);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+
+    assert_with_message(status != GL_WAIT_FAILED, "Waiting on a stream buffer fence failed");
+
+    glDeleteSync(segment.fence);
+    segment.fence = nullptr;
+}
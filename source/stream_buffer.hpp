@@ -0,0 +1,60 @@
+#pragma once
+
+#include "array.hpp"
+
+// Vertex buffer the CPU streams into every frame without waiting on the GPU. It's split
+// into segments used round robin. A fence goes in after the draws that read a segment,
+// and the segment is only written again once that fence has passed. With a few segments
+// the GPU is normally done long before the CPU comes back around, so the wait is free.
+//
+// When the GL has buffer storage the whole buffer is mapped once, persistently.
+// Otherwise each write maps just its range, unsynchronized since the fences already
+// guarantee the GPU isn't reading it.
+class StreamBuffer
+{
+    struct Segment
+    {
+        GLsync fence;
+    };
+
+    GLuint m_buffer;
+    GLenum m_target;
+    size_t m_segment_size;
+    int m_num_of_segments;
+    Array<Segment> m_segments;
+
+    bool m_is_persistent;
+    uint8_t* m_persistent_data;
+
+    int m_current_segment;
+    size_t m_segment_offset;
+    size_t m_write_offset;
+    size_t m_write_size;
+
+    size_t m_num_of_fence_waits;
+
+public:
+    StreamBuffer();
+    ~StreamBuffer();
+
+    // Must be called with a current GL context. Leaves the buffer bound to `target`.
+    void init(GLenum target, size_t segment_size, int num_of_segments);
+
+    // Returns `size` bytes of GPU visible memory to write into, and where they start in
+    // the buffer. Nothing else may be written until end_write. `size` can't be more than
+    // a segment.
+    void* begin_write(size_t size, size_t& buffer_offset);
+    void end_write();
+
+    // Call after the draws reading what was written, fences off the current segment.
+    void fence();
+
+    GLuint get_buffer();
+
+    // Times the CPU had to wait for the GPU to finish with a segment.
+    size_t get_num_of_fence_waits();
+    bool is_persistent();
+
+private:
+    void move_to_next_segment();
+};
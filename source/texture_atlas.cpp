@@ -0,0 +1,136 @@
+#include "texture_atlas.hpp"
+
+TextureAtlas::TextureAtlas(int page_size, GLenum internal_format, GLenum format, int bytes_per_pixel, GLenum filter)
+: m_page_size(page_size)
+, m_internal_format(internal_format)
+, m_format(format)
+, m_bytes_per_pixel(bytes_per_pixel)
+, m_filter(filter)
+, m_num_of_pages(0)
+, m_page_textures()
+, m_page_packers()
+, m_page_nodes(MAX_PAGES * page_size)
+, m_bytes_uploaded(0)
+{}
+
+TextureAtlas::~TextureAtlas()
+{
+    // The context may already be gone at exit, in which case the driver cleans up.
+    if (m_num_of_pages && SDL_GL_GetCurrentContext())
+        glDeleteTextures(m_num_of_pages, m_page_textures);
+}
+
+bool TextureAtlas::insert(int width, int height, const void* pixels, int row_length, AtlasRegion& region)
+{
+    if (!reserve(width, height, region))
+        return false;
+
+    upload(region.page, region.x0, region.y0, width, height, pixels, row_length);
+    return true;
+}
+
+bool TextureAtlas::reserve(int width, int height, AtlasRegion& region)
+{
+    assert(width > 0 && height > 0);
+    if (width + PADDING > m_page_size || height + PADDING > m_page_size)
+        return false;
+
+    for (int page = 0; page < m_num_of_pages; page++)
+    {
+        if (insert_into_page(page, width, height, region))
+            return true;
+    }
+
+    if (m_num_of_pages == MAX_PAGES)
+        return false;
+
+    add_page();
+    bool is_inserted = insert_into_page(m_num_of_pages - 1, width, height, region);
+    assert(is_inserted);
+    return true;
+}
+
+void TextureAtlas::upload(int page, int x, int y, int width, int height, const void* pixels, int row_length)
+{
+    assert(x >= 0 && y >= 0 && x + width <= m_page_size && y + height <= m_page_size);
+
+    glBindTexture(GL_TEXTURE_2D, get_page_texture(page));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, m_format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    m_bytes_uploaded += (size_t) width * height * m_bytes_per_pixel;
+}
+
+GLuint TextureAtlas::get_page_texture(int page)
+{
+    assert(page >= 0 && page < m_num_of_pages);
+    return m_page_textures[page];
+}
+
+int TextureAtlas::get_num_of_pages()
+{
+    return m_num_of_pages;
+}
+
+int TextureAtlas::get_page_size()
+{
+    return m_page_size;
+}
+
+size_t TextureAtlas::take_bytes_uploaded()
+{
+    size_t bytes_uploaded = m_bytes_uploaded;
+    m_bytes_uploaded      = 0;
+    return bytes_uploaded;
+}
+
+bool TextureAtlas::insert_into_page(int page, int width, int height, AtlasRegion& region)
+{
+    // The padding goes on the right and bottom, the pages' left and top edges are
+    // clamped anyway.
+    stbrp_rect rect = {};
+    rect.w = width + PADDING;
+    rect.h = height + PADDING;
+
+    if (!stbrp_pack_rects(&m_page_packers[page], &rect, 1))
+        return false;
+
+    region = { page, rect.x, rect.y, rect.x + width, rect.y + height };
+    return true;
+}
+
+void TextureAtlas::add_page()
+{
+    int page = m_num_of_pages++;
+
+    stbrp_node* nodes = &m_page_nodes[(size_t) page * m_page_size];
+    stbrp_init_target(&m_page_packers[page], m_page_size, m_page_size, nodes, m_page_size);
+
+    // Starts out cleared so the padding between regions is transparent.
+    Array<uint8_t> cleared_pixels((size_t) m_page_size * m_page_size * m_bytes_per_pixel, get_frame_arena());
+
+    glGenTextures(1, &m_page_textures[page]);
+    glBindTexture(GL_TEXTURE_2D, m_page_textures[page]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_page_size, m_page_size, 0, m_format, GL_UNSIGNED_BYTE,
+                 cleared_pixels.get_underlying_buffer());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_filter);
+
+    if (m_format == GL_RED)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+    }
+
+    m_bytes_uploaded += (size_t) m_page_size * m_page_size * m_bytes_per_pixel;
+}
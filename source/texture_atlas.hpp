@@ -0,0 +1,73 @@
+#pragma once
+
+#include "array.hpp"
+
+// Where an image ended up in an atlas, in pixels of its page.
+struct AtlasRegion
+{
+    int page;
+    int x0, y0, x1, y1;
+};
+
+// Packs many small images into a few large textures, so quads drawing different images
+// can share one texture binding and one draw call. Each page is packed with stb_rect_pack,
+// which keeps its skyline between calls, so images can be added at any time and only the
+// new image's pixels are uploaded. A new page is started when an image doesn't fit in any
+// existing one.
+//
+// Regions are padded by a texel of transparent black so filtering never bleeds one image
+// into another. Pages are created on first use, which needs a current GL context.
+//
+// Single channel pages sample as (r, r, r, r), so they can be drawn exactly like RGBA
+// pages holding the same value in every channel, at a quarter of the memory.
+class TextureAtlas
+{
+public:
+    static const int MAX_PAGES = 8;
+
+private:
+    static const int PADDING = 1;
+
+    int m_page_size;
+    GLenum m_internal_format;
+    GLenum m_format;
+    int m_bytes_per_pixel;
+    GLenum m_filter;
+
+    int m_num_of_pages;
+    GLuint m_page_textures[MAX_PAGES];
+    stbrp_context m_page_packers[MAX_PAGES];
+    Array<stbrp_node> m_page_nodes;
+
+    size_t m_bytes_uploaded;
+
+public:
+    // `internal_format` and `format` are what the pages are created and uploaded with, e.g.
+    // GL_RGBA8 and GL_RGBA with 4 bytes per pixel. `filter` is used for both minification
+    // and magnification.
+    TextureAtlas(int page_size, GLenum internal_format, GLenum format, int bytes_per_pixel, GLenum filter);
+    ~TextureAtlas();
+
+    // Copies `width` x `height` pixels into free space and returns where they went. Rows of
+    // `pixels` are `row_length` pixels apart, zero meaning `width`. Fails when the image is
+    // larger than a page or every page is full.
+    bool insert(int width, int height, const void* pixels, int row_length, AtlasRegion& region);
+
+    // Like insert but leaves the region cleared, for the caller to upload into later.
+    bool reserve(int width, int height, AtlasRegion& region);
+
+    // Overwrites `width` x `height` pixels at `x`, `y` of `page`, which should be inside a
+    // region the caller owns.
+    void upload(int page, int x, int y, int width, int height, const void* pixels, int row_length);
+
+    GLuint get_page_texture(int page);
+    int get_num_of_pages();
+    int get_page_size();
+
+    // Bytes of pixels sent to the GPU since the last call to this.
+    size_t take_bytes_uploaded();
+
+private:
+    bool insert_into_page(int page, int width, int height, AtlasRegion& region);
+    void add_page();
+};
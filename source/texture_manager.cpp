@@ -0,0 +1,82 @@
+#include "texture_manager.hpp"
+
+TextureManager::TextureManager(TextureAtlas& atlas)
+: m_atlas(atlas)
+, m_textures(MAX_TEXTURES)
+, m_path_storage(PATH_STORAGE_SIZE)
+, m_path_storage_used(0)
+, m_ids_by_path_hash(MAX_TEXTURES)
+{}
+
+uint32_t TextureManager::get_texture_id(const char* filepath)
+{
+    assert(filepath);
+
+    size_t path_length = strlen(filepath);
+    uint64_t path_hash = hash_bytes(filepath, path_length);
+
+    uint32_t* existing_id = m_ids_by_path_hash.find(path_hash);
+    if (existing_id)
+    {
+        assert_with_message(strcmp(get_filepath(*existing_id), filepath) == 0,
+                            "Texture paths %s and %s have the same hash", get_filepath(*existing_id), filepath);
+        return *existing_id;
+    }
+
+    assert_with_message(!m_textures.is_full(), "More than %d textures loaded", MAX_TEXTURES);
+
+    TextureEntry entry = {};
+    const char* interned_path = intern_path(filepath, entry.path_offset);
+    entry.region = load_texture(interned_path);
+
+    uint32_t texture_id = (uint32_t) m_textures.get_used();
+    m_textures.push(entry);
+    m_ids_by_path_hash.insert(path_hash, texture_id);
+
+    return texture_id;
+}
+
+AtlasRegion TextureManager::get_region(uint32_t texture_id)
+{
+    assert(texture_id < m_textures.get_used());
+    return m_textures[texture_id].region;
+}
+
+const char* TextureManager::get_filepath(uint32_t texture_id)
+{
+    assert(texture_id < m_textures.get_used());
+    return &m_path_storage[m_textures[texture_id].path_offset];
+}
+
+size_t TextureManager::get_num_of_textures()
+{
+    return m_textures.get_used();
+}
+
+const char* TextureManager::intern_path(const char* filepath, size_t& path_offset)
+{
+    size_t path_size = strlen(filepath) + 1;
+    assert_with_message(m_path_storage_used + path_size <= PATH_STORAGE_SIZE, "Out of texture path storage");
+
+    path_offset = m_path_storage_used;
+    char* interned_path = &m_path_storage[path_offset];
+    memcpy(interned_path, filepath, path_size);
+    m_path_storage_used += path_size;
+
+    return interned_path;
+}
+
+AtlasRegion TextureManager::load_texture(const char* filepath)
+{
+    int desired_channels = 4;
+    int image_w, image_h, image_channels;
+    uint8_t* image_data = stbi_load(filepath, &image_w, &image_h, &image_channels, desired_channels);
+    assert_with_message(image_data, "Failed to load texture %s", filepath);
+
+    AtlasRegion region;
+    bool is_inserted = m_atlas.insert(image_w, image_h, image_data, 0, region);
+    assert_with_message(is_inserted, "No room in the atlas for %s (%dx%d)", filepath, image_w, image_h);
+    stbi_image_free(image_data);
+
+    return region;
+}
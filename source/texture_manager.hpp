@@ -0,0 +1,43 @@
+#pragma once
+
+#include "array.hpp"
+#include "hash_map.hpp"
+#include "texture_atlas.hpp"
+
+// Decodes each image asset once, the first time its path is asked for, packs it into an
+// atlas and hands out a small id for it from then on. Paths are interned: every path is
+// copied once into the manager's own storage and looked up by its hash, so drawing with a
+// texture never touches the disk or the PNG decoder after the first frame.
+//
+// Must be used with a current GL context.
+class TextureManager
+{
+    static const int MAX_TEXTURES      = 256;
+    static const int PATH_STORAGE_SIZE = 16 * 1024;
+
+    struct TextureEntry
+    {
+        size_t path_offset;
+        AtlasRegion region;
+    };
+
+    TextureAtlas& m_atlas;
+    Array<TextureEntry> m_textures;
+    Array<char> m_path_storage;
+    size_t m_path_storage_used;
+    HashMap<uint64_t, uint32_t> m_ids_by_path_hash;
+
+public:
+    TextureManager(TextureAtlas& atlas);
+
+    // Returns the id of the texture at `filepath`, loading it if this is the first time.
+    uint32_t get_texture_id(const char* filepath);
+
+    AtlasRegion get_region(uint32_t texture_id);
+    const char* get_filepath(uint32_t texture_id);
+    size_t get_num_of_textures();
+
+private:
+    const char* intern_path(const char* filepath, size_t& path_offset);
+    AtlasRegion load_texture(const char* filepath);
+};
@@ -0,0 +1,199 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(int num_of_threads)
+: m_num_of_threads(num_of_threads > 0 ? num_of_threads : get_num_of_cores())
+, m_batch_id(0)
+, m_function(nullptr)
+, m_data(nullptr)
+, m_num_of_active_workers(0)
+, m_num_of_remaining_tasks(0)
+, m_is_shutting_down(false)
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_batch_ready, nullptr);
+    pthread_cond_init(&m_batch_done, nullptr);
+
+    m_workers.resize(m_num_of_threads);
+    for (int i = 0; i < m_num_of_threads; i++)
+    {
+        Worker& worker      = m_workers[i];
+        worker.pool         = this;
+        worker.index        = i;
+        worker.random_state = 0x9E3779B97F4A7C15ull * (i + 1);
+        worker.head         = 0;
+        worker.tail         = 0;
+        pthread_mutex_init(&worker.mutex, nullptr);
+    }
+
+    // Worker 0 is whichever thread calls parallel_for.
+    for (int i = 1; i < m_num_of_threads; i++)
+    {
+        int result = pthread_create(&m_workers[i].thread, nullptr, worker_main, &m_workers[i]);
+        assert_with_message(result == 0, "Failed to create worker thread %d", i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_is_shutting_down = true;
+    pthread_cond_broadcast(&m_batch_ready);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (int i = 1; i < m_num_of_threads; i++)
+        pthread_join(m_workers[i].thread, nullptr);
+
+    for (int i = 0; i < m_num_of_threads; i++)
+        pthread_mutex_destroy(&m_workers[i].mutex);
+
+    pthread_cond_destroy(&m_batch_done);
+    pthread_cond_destroy(&m_batch_ready);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void ThreadPool::parallel_for(int task_count, TaskFunction function, void* data)
+{
+    if (task_count <= 0)
+        return;
+
+    if (m_num_of_threads == 1 || task_count == 1)
+    {
+        for (int i = 0; i < task_count; i++)
+            function(data, i);
+
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+
+    // The previous batch has fully drained, so no worker is looking at the deques.
+    for (int i = 0; i < m_num_of_threads; i++)
+    {
+        Worker& worker = m_workers[i];
+        pthread_mutex_lock(&worker.mutex);
+        worker.head = (int) ((int64_t) task_count * i       / m_num_of_threads);
+        worker.tail = (int) ((int64_t) task_count * (i + 1) / m_num_of_threads);
+        pthread_mutex_unlock(&worker.mutex);
+    }
+
+    m_function               = function;
+    m_data                   = data;
+    m_num_of_remaining_tasks = task_count;
+    m_batch_id++;
+    pthread_cond_broadcast(&m_batch_ready);
+
+    pthread_mutex_unlock(&m_mutex);
+
+    run_tasks(m_workers[0], function, data);
+
+    // Once our own deque and everyone else's are empty, the last few tasks are finishing
+    // on workers that are still active.
+    pthread_mutex_lock(&m_mutex);
+    while (m_num_of_active_workers > 0)
+        pthread_cond_wait(&m_batch_done, &m_mutex);
+
+    assert(__atomic_load_n(&m_num_of_remaining_tasks, __ATOMIC_ACQUIRE) == 0);
+
+    // Closes the batch so a worker that only wakes up now doesn't join it.
+    m_function = nullptr;
+    m_data     = nullptr;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int ThreadPool::get_num_of_threads()
+{
+    return m_num_of_threads;
+}
+
+int ThreadPool::get_num_of_cores()
+{
+    long num_of_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_of_cores > 0 ? (int) num_of_cores : 1;
+}
+
+/* -------------------------------------- Workers ------------------------------------- */
+
+void* ThreadPool::worker_main(void* data)
+{
+    Worker& worker   = *static_cast<Worker*>(data);
+    ThreadPool& pool = *worker.pool;
+
+    pthread_mutex_lock(&pool.m_mutex);
+
+    uint64_t seen_batch_id = 0;
+    for (;;)
+    {
+        while (pool.m_batch_id == seen_batch_id && !pool.m_is_shutting_down)
+            pthread_cond_wait(&pool.m_batch_ready, &pool.m_mutex);
+
+        if (pool.m_is_shutting_down)
+            break;
+
+        seen_batch_id = pool.m_batch_id;
+        if (!pool.m_function)
+            continue;
+
+        TaskFunction function = pool.m_function;
+        void* function_data   = pool.m_data;
+        pool.m_num_of_active_workers++;
+
+        pthread_mutex_unlock(&pool.m_mutex);
+        pool.run_tasks(worker, function, function_data);
+        pthread_mutex_lock(&pool.m_mutex);
+
+        pool.m_num_of_active_workers--;
+        if (pool.m_num_of_active_workers == 0)
+            pthread_cond_signal(&pool.m_batch_done);
+    }
+
+    pthread_mutex_unlock(&pool.m_mutex);
+    return nullptr;
+}
+
+void ThreadPool::run_tasks(Worker& worker, TaskFunction function, void* data)
+{
+    int task_index;
+    while (take_task(worker, task_index) || steal_task(worker, task_index))
+    {
+        function(data, task_index);
+        __atomic_sub_fetch(&m_num_of_remaining_tasks, 1, __ATOMIC_RELEASE);
+    }
+}
+
+bool ThreadPool::take_task(Worker& worker, int& task_index)
+{
+    pthread_mutex_lock(&worker.mutex);
+
+    bool has_task = worker.head < worker.tail;
+    if (has_task)
+        task_index = --worker.tail;
+
+    pthread_mutex_unlock(&worker.mutex);
+    return has_task;
+}
+
+bool ThreadPool::steal_task(Worker& thief, int& task_index)
+{
+    // Starts at a random victim so thieves don't all pile onto the same deque.
+    int first_victim = (int) (random_next(thief.random_state) % m_num_of_threads);
+
+    for (int i = 0; i < m_num_of_threads; i++)
+    {
+        Worker& victim = m_workers[(first_victim + i) % m_num_of_threads];
+        if (&victim == &thief)
+            continue;
+
+        pthread_mutex_lock(&victim.mutex);
+
+        bool has_task = victim.head < victim.tail;
+        if (has_task)
+            task_index = victim.head++;
+
+        pthread_mutex_unlock(&victim.mutex);
+
+        if (has_task)
+            return true;
+    }
+
+    return false;
+}
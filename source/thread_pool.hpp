@@ -0,0 +1,60 @@
+#pragma once
+
+#include "array.hpp"
+
+typedef void (*TaskFunction)(void* data, int task_index);
+
+// Fixed set of worker threads that run batches of independent tasks. Each batch is split
+// into contiguous ranges, one per worker deque. Workers take tasks from the back of their
+// own deque and steal from the front of someone else's once theirs runs dry, so an uneven
+// batch still keeps every thread busy. The calling thread acts as worker 0.
+class ThreadPool
+{
+    struct Worker
+    {
+        ThreadPool* pool;
+        pthread_t thread;
+        int index;
+        uint64_t random_state;
+
+        // Tasks [head, tail) of the current batch that haven't been taken yet.
+        pthread_mutex_t mutex;
+        int head;
+        int tail;
+    };
+
+    int m_num_of_threads;
+    Array<Worker> m_workers;
+
+    // Guards the batch state below and the sleeping workers.
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_batch_ready;
+    pthread_cond_t m_batch_done;
+
+    uint64_t m_batch_id;
+    TaskFunction m_function;
+    void* m_data;
+    int m_num_of_active_workers;
+    int m_num_of_remaining_tasks;
+    bool m_is_shutting_down;
+
+public:
+    // Zero picks one thread per online core.
+    ThreadPool(int num_of_threads = 0);
+    ~ThreadPool();
+
+    // Runs `function(data, i)` for every i in [0, task_count) and returns once all of
+    // them have finished, which also makes it a barrier between batches.
+    void parallel_for(int task_count, TaskFunction function, void* data);
+
+    int get_num_of_threads();
+
+    static int get_num_of_cores();
+
+private:
+    static void* worker_main(void* worker);
+
+    void run_tasks(Worker& worker, TaskFunction function, void* data);
+    bool take_task(Worker& worker, int& task_index);
+    bool steal_task(Worker& thief, int& task_index);
+};
@@ -0,0 +1,569 @@
+#include "tiled_life.hpp"
+
+static const int DIRECTION_OFFSETS[8][2] = { {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1} };
+
+// Stands in for missing neighbours, which are always empty.
+static const uint64_t EMPTY_ROWS[TiledLife::TILE_SIZE] = {};
+
+static uint64_t get_tile_key(int32_t x, int32_t y)
+{
+    return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y;
+}
+
+TiledLife::TiledLife()
+: m_stamp(0)
+, m_is_tracking_changes(false)
+, m_generation(0)
+{
+    grow_pool();
+}
+
+void TiledLife::step(uint64_t generations)
+{
+    for (uint64_t generation = 0; generation < generations; generation++)
+        step_once();
+}
+
+// Tiles go back to the pool, which keeps its size.
+void TiledLife::clear()
+{
+    for (size_t i = 0; i < m_tiles.get_size(); i++)
+    {
+        if (!m_tiles[i].in_use)
+            continue;
+
+        mark_changed(i);
+        free_tile(i);
+    }
+
+    m_busy_tiles.clear();
+    m_generation = 0;
+}
+
+void TiledLife::step_once()
+{
+    Tile* tiles = m_tiles.get_underlying_buffer();
+
+    // Cells can only be born next to live cells, so busy tiles with anything on their
+    // border need all of their neighbours to exist. New tiles are busy themselves and get
+    // appended, but are empty so they never need neighbours of their own.
+    size_t num_of_busy_tiles = m_busy_tiles.get_used();
+    for (size_t i = 0; i < num_of_busy_tiles; i++)
+    {
+        uint32_t tile_index = m_busy_tiles[i];
+        if (!has_live_border(m_tiles[tile_index]))
+            continue;
+
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+        {
+            if (m_tiles[tile_index].neighbours[direction] == TILE_NONE)
+            {
+                int32_t x = m_tiles[tile_index].x + DIRECTION_OFFSETS[direction][0];
+                int32_t y = m_tiles[tile_index].y + DIRECTION_OFFSETS[direction][1];
+                create_tile(x, y);
+            }
+        }
+    }
+
+    // Anything outside the neighbourhood of a busy tile is guaranteed not to change.
+    m_stamp++;
+    m_candidate_tiles.clear();
+    tiles = m_tiles.get_underlying_buffer();
+    for (size_t i = 0; i < m_busy_tiles.get_used(); i++)
+    {
+        uint32_t tile_index = m_busy_tiles[i];
+        add_candidate(tile_index);
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+        {
+            uint32_t neighbour = tiles[tile_index].neighbours[direction];
+            if (neighbour != TILE_NONE)
+                add_candidate(neighbour);
+        }
+    }
+
+    // All tiles read their neighbours' front buffers and only write their own back buffer,
+    // so nothing is committed until every tile has been decided.
+    size_t num_of_candidates = m_candidate_tiles.get_used();
+    for (size_t i = 0; i < num_of_candidates; i++)
+        decide_tile(m_candidate_tiles[i]);
+
+    m_busy_tiles.clear();
+    for (size_t i = 0; i < num_of_candidates; i++)
+    {
+        uint32_t tile_index = m_candidate_tiles[i];
+        Tile& tile          = tiles[tile_index];
+        if (tile.action == TileAction::TILE_KEEP)
+            continue;
+
+        tile.front      ^= 1;
+        tile.changed     = tile.next_changed;
+        tile.period_2    = tile.next_period_2;
+        tile.has_history = true;
+
+        if (tile.changed)
+        {
+            m_busy_tiles.push(tile_index);
+            mark_changed(tile_index);
+        }
+    }
+
+    for (size_t i = 0; i < num_of_candidates; i++)
+    {
+        uint32_t tile_index = m_candidate_tiles[i];
+        Tile& tile          = tiles[tile_index];
+        if (!tile.in_use || tile.changed || !is_empty(tile))
+            continue;
+
+        bool neighbours_are_quiet = true;
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+        {
+            uint32_t neighbour = tile.neighbours[direction];
+            if (neighbour != TILE_NONE && tiles[neighbour].changed)
+                neighbours_are_quiet = false;
+        }
+
+        if (neighbours_are_quiet)
+            free_tile(tile_index);
+    }
+
+    m_generation++;
+}
+
+void TiledLife::decide_tile(uint32_t tile_index)
+{
+    Tile* tiles = m_tiles.get_underlying_buffer();
+    Tile& tile  = tiles[tile_index];
+
+    bool all_quiet    = !tile.changed;
+    bool all_period_2 = tile.period_2;
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+    {
+        uint32_t neighbour = tile.neighbours[direction];
+        if (neighbour != TILE_NONE)
+        {
+            all_quiet    &= !tiles[neighbour].changed;
+            all_period_2 &= tiles[neighbour].period_2;
+        }
+    }
+
+    if (all_quiet)
+    {
+        tile.action = TileAction::TILE_KEEP;
+    }
+    else if (all_period_2)
+    {
+        // The back buffer holds the previous generation, which is also the next one. After
+        // the flip it still differs from the front by exactly as much as it does now.
+        tile.action        = TileAction::TILE_FLIP;
+        tile.next_changed  = tile.changed;
+        tile.next_period_2 = true;
+    }
+    else
+    {
+        tile.action = TileAction::TILE_COMPUTE;
+        compute_tile(tile_index);
+    }
+}
+
+void TiledLife::compute_tile(uint32_t tile_index)
+{
+    Tile* tiles = m_tiles.get_underlying_buffer();
+    Tile& tile  = tiles[tile_index];
+
+    const uint64_t* neighbour_rows[DIRECTION_COUNT];
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+    {
+        uint32_t neighbour = tile.neighbours[direction];
+        neighbour_rows[direction] = neighbour == TILE_NONE ? EMPTY_ROWS : tiles[neighbour].rows[tiles[neighbour].front];
+    }
+
+    const uint64_t* rows = tile.rows[tile.front];
+    const uint64_t* west = neighbour_rows[WEST];
+    const uint64_t* east = neighbour_rows[EAST];
+    uint64_t* next       = tile.rows[tile.front ^ 1];
+
+    const int last = TILE_SIZE - 1;
+    uint64_t changed_bits   = 0;
+    uint64_t period_2_diffs = 0;
+
+    for (int y = 0; y < TILE_SIZE; y++)
+    {
+        uint64_t above_w = y > 0    ? west[y-1] : neighbour_rows[NORTH_WEST][last];
+        uint64_t above   = y > 0    ? rows[y-1] : neighbour_rows[NORTH][last];
+        uint64_t above_e = y > 0    ? east[y-1] : neighbour_rows[NORTH_EAST][last];
+        uint64_t below_w = y < last ? west[y+1] : neighbour_rows[SOUTH_WEST][0];
+        uint64_t below   = y < last ? rows[y+1] : neighbour_rows[SOUTH][0];
+        uint64_t below_e = y < last ? east[y+1] : neighbour_rows[SOUTH_EAST][0];
+
+        uint64_t word = life_step_word(above_w, above,   above_e,
+                                       west[y], rows[y], east[y],
+                                       below_w, below,   below_e);
+
+        // The back buffer still holds the previous generation until it's overwritten here.
+        changed_bits   |= word ^ rows[y];
+        period_2_diffs |= word ^ next[y];
+        next[y] = word;
+    }
+
+    tile.next_changed  = changed_bits != 0;
+    tile.next_period_2 = period_2_diffs == 0 && tile.has_history;
+}
+
+bool TiledLife::get_cell(int64_t x, int64_t y)
+{
+    uint32_t tile_index = find_tile(x >> TILE_SIZE_LOG2, y >> TILE_SIZE_LOG2);
+    if (tile_index == TILE_NONE)
+        return false;
+
+    Tile& tile = m_tiles[tile_index];
+    return (tile.rows[tile.front][y & (TILE_SIZE - 1)] >> (x & (TILE_SIZE - 1))) & 1;
+}
+
+void TiledLife::set_cell(int64_t x, int64_t y, bool alive)
+{
+    int32_t tile_x = x >> TILE_SIZE_LOG2;
+    int32_t tile_y = y >> TILE_SIZE_LOG2;
+    assert_with_message(tile_x == (x >> TILE_SIZE_LOG2) && tile_y == (y >> TILE_SIZE_LOG2),
+                        "Cell (%lld, %lld) is out of range", (long long) x, (long long) y);
+
+    uint32_t tile_index = find_tile(tile_x, tile_y);
+    if (tile_index == TILE_NONE)
+    {
+        if (!alive)
+            return;
+
+        tile_index = create_tile(tile_x, tile_y);
+    }
+
+    Tile& tile     = m_tiles[tile_index];
+    uint64_t& word = tile.rows[tile.front][y & (TILE_SIZE - 1)];
+    uint64_t mask  = 1ull << (x & (TILE_SIZE - 1));
+    if (alive)
+        word |= mask;
+    else
+        word &= ~mask;
+
+    // The edit breaks any assumptions about the tile's history.
+    mark_busy(tile_index);
+    m_tiles[tile_index].period_2    = false;
+    m_tiles[tile_index].has_history = false;
+}
+
+void TiledLife::set_run(int64_t x, int64_t y, int64_t length)
+{
+    while (length > 0)
+    {
+        int offset    = x & (TILE_SIZE - 1);
+        int64_t count = min<int64_t>(length, TILE_SIZE - offset);
+        uint64_t mask = count == TILE_SIZE ? ~0ull : ((1ull << count) - 1) << offset;
+
+        set_tile_row_bits(x >> TILE_SIZE_LOG2, y, mask);
+
+        x      += count;
+        length -= count;
+    }
+}
+
+void TiledLife::set_row(int64_t x, int64_t y, const uint64_t* words, int64_t num_of_words)
+{
+    // Tiles are a word wide, so an unaligned word straddles two of them.
+    int shift = x & (TILE_SIZE - 1);
+    for (int64_t i = 0; i < num_of_words; i++)
+    {
+        uint64_t word = words[i];
+        if (!word)
+            continue;
+
+        int64_t tile_x = (x + i * TILE_SIZE) >> TILE_SIZE_LOG2;
+        if (word << shift)
+            set_tile_row_bits(tile_x, y, word << shift);
+        if (shift && (word >> (TILE_SIZE - shift)))
+            set_tile_row_bits(tile_x + 1, y, word >> (TILE_SIZE - shift));
+    }
+}
+
+// Sets `bits` alive in row y of the tile at tile_x, creating the tile if needed.
+void TiledLife::set_tile_row_bits(int64_t tile_x, int64_t y, uint64_t bits)
+{
+    int64_t tile_y = y >> TILE_SIZE_LOG2;
+    assert_with_message(tile_x == (int32_t) tile_x && tile_y == (int32_t) tile_y,
+                        "Cell (%lld, %lld) is out of range", (long long) (tile_x * TILE_SIZE), (long long) y);
+
+    uint32_t tile_index = find_tile((int32_t) tile_x, (int32_t) tile_y);
+    if (tile_index == TILE_NONE)
+        tile_index = create_tile((int32_t) tile_x, (int32_t) tile_y);
+
+    Tile& tile = m_tiles[tile_index];
+    tile.rows[tile.front][y & (TILE_SIZE - 1)] |= bits;
+
+    // Same as set_cell, the edit breaks any assumptions about the tile's history.
+    mark_busy(tile_index);
+    tile.period_2    = false;
+    tile.has_history = false;
+}
+
+uint64_t TiledLife::get_population()
+{
+    uint64_t population = 0;
+    for (size_t i = 0; i < m_tiles.get_size(); i++)
+    {
+        Tile& tile = m_tiles[i];
+        if (!tile.in_use)
+            continue;
+
+        for (uint64_t row : tile.rows[tile.front])
+            population += __builtin_popcountll(row);
+    }
+
+    return population;
+}
+
+uint64_t TiledLife::get_generation()
+{
+    return m_generation;
+}
+
+void TiledLife::set_generation(uint64_t generation)
+{
+    m_generation = generation;
+}
+
+void TiledLife::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1)
+{
+    int32_t min_x = INT32_MAX, min_y = INT32_MAX;
+    int32_t max_x = INT32_MIN, max_y = INT32_MIN;
+
+    for (size_t i = 0; i < m_tiles.get_size(); i++)
+    {
+        Tile& tile = m_tiles[i];
+        if (!tile.in_use || is_empty(tile))
+            continue;
+
+        min_x = min(min_x, tile.x);
+        min_y = min(min_y, tile.y);
+        max_x = max(max_x, tile.x);
+        max_y = max(max_y, tile.y);
+    }
+
+    if (min_x > max_x)
+    {
+        x0 = y0 = 0;
+        x1 = y1 = TILE_SIZE;
+        return;
+    }
+
+    x0 = (int64_t) min_x << TILE_SIZE_LOG2;
+    y0 = (int64_t) min_y << TILE_SIZE_LOG2;
+    x1 = ((int64_t) max_x + 1) << TILE_SIZE_LOG2;
+    y1 = ((int64_t) max_y + 1) << TILE_SIZE_LOG2;
+}
+
+bool TiledLife::visit_tiles(LifeTileVisitor visit, void* data)
+{
+    for (size_t i = 0; i < m_tiles.get_size(); i++)
+    {
+        Tile& tile = m_tiles[i];
+        if (tile.in_use && !is_empty(tile))
+            visit(data, tile.x, tile.y, tile.rows[tile.front], TILE_SIZE, 1);
+    }
+
+    return true;
+}
+
+bool TiledLife::visit_changed_tiles(LifeTileVisitor visit, void* data)
+{
+    // Nothing was kept before the first call.
+    if (!m_is_tracking_changes)
+    {
+        m_is_tracking_changes = true;
+        return visit_tiles(visit, data);
+    }
+
+    // Dropped tiles go first, a tile made in the same place since comes after.
+    for (size_t i = 0; i < m_dropped_tiles.get_used(); i++)
+    {
+        uint64_t key = m_dropped_tiles[i];
+        visit(data, (int32_t) (key >> 32), (int32_t) key, EMPTY_ROWS, TILE_SIZE, 1);
+    }
+
+    for (size_t i = 0; i < m_changed_tiles.get_used(); i++)
+    {
+        Tile& tile                = m_tiles[m_changed_tiles[i]];
+        tile.is_listed_as_changed = false;
+        if (tile.in_use)
+            visit(data, tile.x, tile.y, tile.rows[tile.front], TILE_SIZE, 1);
+    }
+
+    m_dropped_tiles.clear();
+    m_changed_tiles.clear();
+    return true;
+}
+
+void TiledLife::capture(LifeFrame& frame)
+{
+    frame.set_stats(m_generation, get_population());
+
+    int level        = frame.get_level();
+    int64_t frame_x0 = frame.get_x();
+    int64_t frame_y0 = frame.get_y();
+    int64_t frame_x1 = frame_x0 + ((int64_t) frame.get_width()  << level);
+    int64_t frame_y1 = frame_y0 + ((int64_t) frame.get_height() << level);
+
+    for (size_t i = 0; i < m_tiles.get_size(); i++)
+    {
+        Tile& tile = m_tiles[i];
+        if (!tile.in_use)
+            continue;
+
+        int64_t tile_x0 = (int64_t) tile.x << TILE_SIZE_LOG2;
+        int64_t tile_y0 = (int64_t) tile.y << TILE_SIZE_LOG2;
+        if (tile_x0 >= frame_x1 || tile_y0 >= frame_y1 || tile_x0 + TILE_SIZE <= frame_x0 || tile_y0 + TILE_SIZE <= frame_y0)
+            continue;
+
+        // Blocks out of the frame are ignored by set_block.
+        uint64_t* rows = tile.rows[tile.front];
+        for (int y = 0; y < TILE_SIZE; y++)
+        {
+            uint64_t word = rows[y];
+            while (word)
+            {
+                int x = __builtin_ctzll(word);
+                word &= word - 1;
+
+                frame.set_block((tile_x0 + x - frame_x0) >> level, (tile_y0 + y - frame_y0) >> level);
+            }
+        }
+    }
+}
+
+size_t TiledLife::get_num_of_tiles()
+{
+    return m_tile_lookup.get_count();
+}
+
+uint32_t TiledLife::find_tile(int32_t x, int32_t y)
+{
+    uint32_t* tile_index = m_tile_lookup.find(get_tile_key(x, y));
+    return tile_index ? *tile_index : TILE_NONE;
+}
+
+uint32_t TiledLife::create_tile(int32_t x, int32_t y)
+{
+    if (m_free_tiles.get_used() == 0)
+        grow_pool();
+
+    uint32_t tile_index = m_free_tiles.pop();
+    Tile* tiles         = m_tiles.get_underlying_buffer();
+    Tile& tile          = tiles[tile_index];
+
+    uint8_t is_listed_as_changed = tile.is_listed_as_changed;
+    memset(&tile, 0, sizeof(tile));
+    tile.x                    = x;
+    tile.y                    = y;
+    tile.in_use               = true;
+    tile.is_listed_as_changed = is_listed_as_changed;
+    m_tile_lookup.insert(get_tile_key(x, y), tile_index);
+
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+    {
+        uint32_t neighbour = find_tile(x + DIRECTION_OFFSETS[direction][0], y + DIRECTION_OFFSETS[direction][1]);
+        tile.neighbours[direction] = neighbour;
+
+        if (neighbour != TILE_NONE)
+            tiles[neighbour].neighbours[(direction + 4) % DIRECTION_COUNT] = tile_index;
+    }
+
+    // Never been computed, so it has to be looked at next generation.
+    mark_busy(tile_index);
+    return tile_index;
+}
+
+void TiledLife::free_tile(uint32_t tile_index)
+{
+    Tile* tiles = m_tiles.get_underlying_buffer();
+    Tile& tile  = tiles[tile_index];
+
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++)
+    {
+        uint32_t neighbour = tile.neighbours[direction];
+        if (neighbour != TILE_NONE)
+            tiles[neighbour].neighbours[(direction + 4) % DIRECTION_COUNT] = TILE_NONE;
+    }
+
+    m_tile_lookup.remove(get_tile_key(tile.x, tile.y));
+    tile.in_use = false;
+    m_free_tiles.push(tile_index);
+
+    if (tile.is_listed_as_changed)
+        m_dropped_tiles.push(get_tile_key(tile.x, tile.y));
+}
+
+void TiledLife::mark_busy(uint32_t tile_index)
+{
+    Tile& tile = m_tiles[tile_index];
+    if (!tile.changed)
+    {
+        tile.changed = true;
+        m_busy_tiles.push(tile_index);
+    }
+
+    mark_changed(tile_index);
+}
+
+void TiledLife::mark_changed(uint32_t tile_index)
+{
+    Tile& tile = m_tiles[tile_index];
+    if (m_is_tracking_changes && !tile.is_listed_as_changed)
+    {
+        tile.is_listed_as_changed = true;
+        m_changed_tiles.push(tile_index);
+    }
+}
+
+void TiledLife::add_candidate(uint32_t tile_index)
+{
+    Tile& tile = m_tiles[tile_index];
+    if (tile.stamp != m_stamp)
+    {
+        tile.stamp = m_stamp;
+        m_candidate_tiles.push(tile_index);
+    }
+}
+
+bool TiledLife::is_empty(Tile& tile)
+{
+    uint64_t any = 0;
+    for (uint64_t row : tile.rows[tile.front])
+        any |= row;
+
+    return any == 0;
+}
+
+bool TiledLife::has_live_border(Tile& tile)
+{
+    uint64_t* rows = tile.rows[tile.front];
+    uint64_t edge_bits = (1ull << 0) | (1ull << (TILE_SIZE - 1));
+
+    uint64_t border = rows[0] | rows[TILE_SIZE - 1];
+    for (int y = 1; y < TILE_SIZE - 1; y++)
+        border |= rows[y] & edge_bits;
+
+    return border != 0;
+}
+
+// The index lists can hold every tile at once, so they grow along with the pool.
+void TiledLife::grow_pool()
+{
+    size_t old_capacity = m_tiles.get_size();
+    size_t new_capacity = max<size_t>(old_capacity * 2, 256);
+
+    // Tiles are allocated by index rather than pushed, reserve keeps the whole pool.
+    m_tiles.reserve(new_capacity);
+    m_free_tiles.reserve(new_capacity);
+    m_busy_tiles.reserve(new_capacity);
+    m_candidate_tiles.reserve(new_capacity);
+    m_changed_tiles.reserve(new_capacity);
+
+    for (size_t i = new_capacity; i > old_capacity; i--)
+        m_free_tiles.push(i - 1);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "life.hpp"
+#include "hash_map.hpp"
+
+// Unbounded universe made of 64x64 bit-packed tiles, kept in a hash map keyed by tile
+// coordinate. Only the tiles that are changing, and their neighbours, are looked at each
+// generation, so the cost scales with the active area rather than the bounding box:
+//
+//   - A tile whose whole neighbourhood didn't change last generation is left alone.
+//   - A tile whose whole neighbourhood is the same as two generations ago (still lifes
+//     and period 2 oscillators) just flips its buffers, the back buffer already holds
+//     the next generation.
+//   - Everything else is recomputed.
+//
+// Empty tiles with quiet neighbours are returned to a pool.
+class TiledLife : public LifeEngine
+{
+public:
+    static const int TILE_SIZE       = LIFE_CELLS_PER_WORD;
+    static const int TILE_SIZE_LOG2  = 6;
+
+private:
+    static const uint32_t TILE_NONE = UINT32_MAX;
+
+    enum Direction { NORTH, NORTH_EAST, EAST, SOUTH_EAST, SOUTH, SOUTH_WEST, WEST, NORTH_WEST, DIRECTION_COUNT };
+
+    enum class TileAction : uint8_t
+    {
+        TILE_KEEP,
+        TILE_FLIP,
+        TILE_COMPUTE
+    };
+
+    struct Tile
+    {
+        uint64_t rows[2][TILE_SIZE];
+        int32_t x, y;
+        uint32_t neighbours[DIRECTION_COUNT];
+        uint32_t stamp;
+        uint8_t front;
+        uint8_t in_use;
+
+        // Current generation differs from the previous one.
+        uint8_t changed;
+        // Current generation is the same as two generations ago.
+        uint8_t period_2;
+        // At least one generation has been stepped since the tile was created or edited,
+        // so the back buffer really is the generation before the front.
+        uint8_t has_history;
+
+        // Listed in m_changed_tiles. Belongs to the slot rather than the tile, so a tile
+        // made in a freed slot isn't listed twice.
+        uint8_t is_listed_as_changed;
+
+        TileAction action;
+        uint8_t next_changed;
+        uint8_t next_period_2;
+    };
+
+    Array<Tile> m_tiles;
+    Array<uint32_t> m_free_tiles;
+    HashMap<uint64_t, uint32_t> m_tile_lookup;
+
+    // Tiles with `changed` set, exactly once each.
+    Array<uint32_t> m_busy_tiles;
+    Array<uint32_t> m_candidate_tiles;
+    uint32_t m_stamp;
+
+    // Tiles that may have changed since the last visit_changed_tiles, and the keys of the
+    // ones freed since. Only kept once it's been called.
+    bool m_is_tracking_changes;
+    Array<uint32_t> m_changed_tiles;
+    Array<uint64_t> m_dropped_tiles;
+
+    uint64_t m_generation;
+
+public:
+    TiledLife();
+
+    void step(uint64_t generations) override;
+    void clear() override;
+    bool get_cell(int64_t x, int64_t y) override;
+    void set_cell(int64_t x, int64_t y, bool alive) override;
+    void set_run(int64_t x, int64_t y, int64_t length) override;
+    void set_row(int64_t x, int64_t y, const uint64_t* words, int64_t num_of_words) override;
+    uint64_t get_population() override;
+    uint64_t get_generation() override;
+    void set_generation(uint64_t generation) override;
+    void get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) override;
+    void capture(LifeFrame& frame) override;
+    bool visit_tiles(LifeTileVisitor visit, void* data) override;
+    bool visit_changed_tiles(LifeTileVisitor visit, void* data) override;
+
+    size_t get_num_of_tiles();
+
+private:
+    void step_once();
+    void decide_tile(uint32_t tile_index);
+    void compute_tile(uint32_t tile_index);
+
+    uint32_t find_tile(int32_t x, int32_t y);
+    uint32_t create_tile(int32_t x, int32_t y);
+    void free_tile(uint32_t tile_index);
+    void set_tile_row_bits(int64_t tile_x, int64_t y, uint64_t bits);
+    void mark_busy(uint32_t tile_index);
+    void mark_changed(uint32_t tile_index);
+    void add_candidate(uint32_t tile_index);
+
+    bool is_empty(Tile& tile);
+    bool has_live_border(Tile& tile);
+    void grow_pool();
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+// Lock-free hand over of the latest value from one producer thread to one consumer thread.
+// The producer always has a slot of its own to write into and the consumer always has one
+// to read from, the third sits in the middle holding the most recently published value.
+// Publishing and acquiring just swap slot indices with the middle, neither side ever waits
+// on the other, and values the consumer was too slow to see are simply overwritten.
+template<typename T>
+class TripleBuffer
+{
+    // Set on the middle index when it holds a value the consumer hasn't acquired yet.
+    static const uint32_t FRESH_BIT  = 1u << 31;
+    static const uint32_t INDEX_MASK = 3;
+
+    T m_slots[3];
+
+    uint32_t m_write_index;
+    uint32_t m_middle;
+    uint32_t m_read_index;
+
+public:
+    TripleBuffer()
+    : m_write_index(0)
+    , m_middle(1)
+    , m_read_index(2)
+    {}
+
+    /* ------------------------------------- Producer ------------------------------------- */
+
+    T& get_write_slot()
+    {
+        return m_slots[m_write_index];
+    }
+
+    // Makes the write slot the latest value and hands the producer the old middle slot,
+    // which may hold anything, to write the next value into. Returns false if the value
+    // that was the latest until now never reached the consumer.
+    bool publish()
+    {
+        uint32_t old_middle = __atomic_exchange_n(&m_middle, m_write_index | FRESH_BIT, __ATOMIC_ACQ_REL);
+        m_write_index = old_middle & INDEX_MASK;
+        return !(old_middle & FRESH_BIT);
+    }
+
+    /* ------------------------------------- Consumer ------------------------------------- */
+
+    // Swaps in the latest published value if there is a new one. Returns false, and keeps
+    // the current read slot, otherwise.
+    bool acquire()
+    {
+        if (!(__atomic_load_n(&m_middle, __ATOMIC_ACQUIRE) & FRESH_BIT))
+            return false;
+
+        uint32_t old_middle = __atomic_exchange_n(&m_middle, m_read_index, __ATOMIC_ACQ_REL);
+        m_read_index = old_middle & INDEX_MASK;
+        return true;
+    }
+
+    T& get_read_slot()
+    {
+        return m_slots[m_read_index];
+    }
+};
@@ -1,50 +1,195 @@
 #include "utils.hpp"
 
-File::File(const char* filepath)
+File::File(Allocator& allocator)
+: m_data(nullptr)
+, m_size(0)
+, m_is_mapped(false)
+, m_is_open(false)
+, m_allocator(allocator)
+{}
+
+File::File(const char* filepath, FileAccess access, Allocator& allocator)
+: File(allocator)
 {
-    m_handle = open_or_panic(filepath);
-    m_size = get_file_size(m_handle);
+    if (!open(filepath, access))
+    {
+        fprintf(stderr, "Could not open file: %s\n", filepath);
+        exit(EXIT_FAILURE);
+    }
+}
 
-    // TODO: Remove malloc when memory strategy finalized.
-    m_data = malloc(m_size+1);
-    memset(m_data, 0, m_size+1);
-    fread(m_data, m_size, 1, static_cast<FILE*>(m_handle));
+File::~File()
+{
+    close();
 }
 
-size_t File::get_file_size(void* handle)
+bool File::open(const char* filepath, FileAccess access)
 {
-    FILE* file_handle = static_cast<FILE*>(handle);
-    assert(file_handle);
+    close();
 
-    fseek(file_handle, 0, SEEK_END);
-    size_t file_size = ftell(file_handle);
-    rewind(file_handle);
+    int descriptor = ::open(filepath, O_RDONLY);
+    if (descriptor == -1)
+        return false;
 
-    return file_size;
+    struct stat file_status;
+    if (fstat(descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode))
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    m_size = file_status.st_size;
+
+    // Empty files can't be mapped, and there's nothing to read anyway.
+    bool is_read = m_size == 0 || map(descriptor, access) || read_into_memory(descriptor);
+
+    // A mapping keeps the file alive on its own.
+    ::close(descriptor);
+
+    if (!is_read)
+    {
+        m_size = 0;
+        return false;
+    }
+
+    m_is_open = true;
+    return true;
 }
 
-FILE* File::open_or_panic(const char* filepath)
+void File::close()
 {
-    FILE* file = fopen(filepath, "rb");
-    if (!file)
+    if (m_data)
     {
-        fprintf(stderr, "Could not open file: %s\n", filepath);
-        exit(EXIT_FAILURE);
+        if (m_is_mapped)
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        else
+            m_allocator.deallocate(const_cast<uint8_t*>(m_data), m_size);
     }
 
-    return file;
+    m_data      = nullptr;
+    m_size      = 0;
+    m_is_mapped = false;
+    m_is_open   = false;
 }
 
-File::~File()
+bool File::map(int descriptor, FileAccess access)
+{
+#if defined(__EMSCRIPTEN__)
+    return false;
+#else
+    int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (m_size <= MAX_POPULATE_SIZE)
+        flags |= MAP_POPULATE;
+#endif
+
+    void* data = mmap(nullptr, m_size, PROT_READ, flags, descriptor, 0);
+    if (data == MAP_FAILED)
+        return false;
+
+    // Only hints, it's fine if the kernel ignores them.
+    madvise(data, m_size, access == FILE_ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_WILLNEED);
+
+    m_data      = static_cast<const uint8_t*>(data);
+    m_is_mapped = true;
+    return true;
+#endif
+}
+
+bool File::read_into_memory(int descriptor)
+{
+    uint8_t* data = static_cast<uint8_t*>(m_allocator.allocate(m_size, alignof(max_align_t)));
+
+    size_t num_of_bytes_read = 0;
+    while (num_of_bytes_read < m_size)
+    {
+        ssize_t result = read(descriptor, data + num_of_bytes_read, m_size - num_of_bytes_read);
+        if (result <= 0)
+        {
+            m_allocator.deallocate(data, m_size);
+            return false;
+        }
+
+        num_of_bytes_read += result;
+    }
+
+    m_data      = data;
+    m_is_mapped = false;
+    return true;
+}
+
+bool File::is_open()
+{
+    return m_is_open;
+}
+
+bool File::is_mapped()
+{
+    return m_is_mapped;
+}
+
+const void* File::get_data()
+{
+    return m_data;
+}
+
+size_t File::get_size()
+{
+    return m_size;
+}
+
+FileReplacement::FileReplacement()
+: m_filepath(nullptr)
+, m_file(nullptr)
+{}
+
+FileReplacement::~FileReplacement()
 {
-    if (m_handle)
+    discard();
+}
+
+bool FileReplacement::open(const char* filepath)
+{
+    discard();
+
+    snprintf(m_temporary_filepath, sizeof(m_temporary_filepath), "%s.%d.tmp", filepath, (int) getpid());
+    m_file = fopen(m_temporary_filepath, "wb");
+    if (!m_file)
+        return false;
+
+    m_filepath = filepath;
+    return true;
+}
+
+FILE* FileReplacement::get_file()
+{
+    assert(m_file);
+    return m_file;
+}
+
+bool FileReplacement::commit()
+{
+    assert(m_file);
+
+    bool is_written = !ferror(m_file);
+    is_written      = fclose(m_file) == 0 && is_written;
+    m_file          = nullptr;
+
+    if (!is_written || rename(m_temporary_filepath, m_filepath) != 0)
     {
-        FILE* file_handle = static_cast<FILE*>(m_handle);
-        fclose(file_handle);
+        unlink(m_temporary_filepath);
+        return false;
     }
+
+    return true;
 }
 
-void* File::get_data()
+void FileReplacement::discard()
 {
-    return m_data;    
+    if (!m_file)
+        return;
+
+    fclose(m_file);
+    m_file = nullptr;
+    unlink(m_temporary_filepath);
 }
@@ -1,20 +1,84 @@
 #pragma once
 
+#include "memory.hpp"
+
+enum FileAccess
+{
+    // Read front to back, like pattern files. Read ahead aggressively, pages behind the
+    // reader can be dropped.
+    FILE_ACCESS_SEQUENTIAL,
+
+    // Read all over the place, like fonts.
+    FILE_ACCESS_RANDOM,
+};
+
+// Read only view of a whole file. Where it can, the file is memory mapped so reading it
+// copies nothing and costs no heap, however large it is. Files small enough are paged in
+// up front so the first reads don't fault. Without mmap, as on wasm, or if mapping fails,
+// the file is read into memory from `allocator` instead.
+//
+// The data isn't null terminated.
 class File
 {
-    void* m_handle;
-    void* m_data;
+    const uint8_t* m_data;
     size_t m_size;
+    bool m_is_mapped;
+    bool m_is_open;
+    Allocator& m_allocator;
+
+    // Bigger files are paged in on demand instead of all at once.
+    static const size_t MAX_POPULATE_SIZE = 64 * 1024 * 1024;
 
 public:
+    File(Allocator& allocator = get_heap_allocator());
 
-    File(const char* filepath);
+    // Exits if the file can't be opened.
+    File(const char* filepath, FileAccess access = FILE_ACCESS_RANDOM, Allocator& allocator = get_heap_allocator());
     ~File();
-    void* get_data();
+
+    File(const File& other) = delete;
+    File& operator=(const File& other) = delete;
+
+    // Returns false if the file can't be opened, in which case the File is left closed.
+    bool open(const char* filepath, FileAccess access = FILE_ACCESS_RANDOM);
+    void close();
+
+    bool is_open();
+    bool is_mapped();
+    const void* get_data();
+    size_t get_size();
+
+private:
+    bool map(int descriptor, FileAccess access);
+    bool read_into_memory(int descriptor);
+};
+
+// Writes a file that replaces whatever was at the path in one go, so a crash or another
+// instance reading it never sees half of it. Everything goes to "<filepath>.<pid>.tmp"
+// first, which commit renames into place. Dropped without committing, or if a write
+// failed, the temporary file is removed and the old one is left alone.
+class FileReplacement
+{
+    char m_temporary_filepath[1024];
+    const char* m_filepath;
+    FILE* m_file;
+
+public:
+    FileReplacement();
+    ~FileReplacement();
+
+    FileReplacement(const FileReplacement& other) = delete;
+    FileReplacement& operator=(const FileReplacement& other) = delete;
+
+    bool open(const char* filepath);
+    FILE* get_file();
+
+    // Returns false if anything written to the file since open failed, or it couldn't
+    // be put in place.
+    bool commit();
 
 private:
-    size_t get_file_size(void* m_handle);
-    FILE* open_or_panic(const char* filepath);
+    void discard();
 };
 
 template<typename T>
@@ -28,3 +92,100 @@ static inline T max(T a, T b)
 {
     return a > b ? a : b;
 }
+
+// Monotonic wall clock time, for measuring intervals.
+static inline double get_time_in_seconds()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// SplitMix64. Not cryptographic, but fast and good enough for seeding boards.
+static inline uint64_t random_next(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// 64-bit FNV-1a.
+static inline uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+// Finalizer from MurmurHash3, spreads every input bit across the whole output.
+static inline uint64_t hash_u64(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+// Decodes the UTF-8 sequence at `string` and moves it past. Malformed, overlong or cut off
+// sequences decode as U+FFFD, consuming one byte, so decoding always makes progress.
+static inline uint32_t utf8_next(const char*& string, const char* end)
+{
+    static const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(string);
+    size_t available     = end - string;
+    assert(available > 0);
+
+    uint32_t lead = bytes[0];
+    if (lead < 0x80)
+    {
+        string += 1;
+        return lead;
+    }
+
+    int length;
+    uint32_t codepoint, min_codepoint;
+    if      ((lead & 0xE0) == 0xC0) { length = 2; codepoint = lead & 0x1F; min_codepoint = 0x80;    }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; codepoint = lead & 0x0F; min_codepoint = 0x800;   }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; codepoint = lead & 0x07; min_codepoint = 0x10000; }
+    else
+    {
+        string += 1;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    if (available < (size_t) length)
+    {
+        string += 1;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    for (int i = 1; i < length; i++)
+    {
+        if ((bytes[i] & 0xC0) != 0x80)
+        {
+            string += 1;
+            return REPLACEMENT_CHARACTER;
+        }
+
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+
+    bool is_surrogate = codepoint >= 0xD800 && codepoint <= 0xDFFF;
+    if (codepoint < min_codepoint || codepoint > 0x10FFFF || is_surrogate)
+    {
+        string += 1;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    string += length;
+    return codepoint;
+}
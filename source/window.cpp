@@ -14,6 +14,7 @@ Window::Window(const char* title, int x, int y, int w, int h, Renderer& renderer
 , m_size({w, h})
 , m_open(false)
 , m_renderer(renderer)
+, m_key_presses()
 {
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
         SDL_ErrorAndExit();
@@ -46,12 +47,17 @@ bool Window::is_open()
 
 void Window::swap_buffers()
 {
-    m_renderer.flush();
+    m_renderer.end_frame();
     SDL_GL_SwapWindow(m_handle);
+
+    // Nothing from the frame arena outlives the frame it was allocated in.
+    get_frame_arena().reset();
 }
 
 void Window::poll_events()
 {
+    memset(m_key_presses, 0, sizeof(m_key_presses));
+
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
@@ -71,6 +77,23 @@ void Window::poll_events()
                     {
                         m_open = false;
                     } break;
+
+                    case SDLK_LEFT:
+                    {
+                        m_key_presses[KEY_LEFT]++;
+                    } break;
+
+                    case SDLK_RIGHT:
+                    {
+                        m_key_presses[KEY_RIGHT]++;
+                    } break;
+
+                    // Toggles, so holding it down doesn't flicker.
+                    case SDLK_SPACE:
+                    {
+                        if (!event.key.repeat)
+                            m_key_presses[KEY_SPACE]++;
+                    } break;
                 }
             } break;
 
@@ -96,6 +119,11 @@ void Window::poll_events()
     }
 }
 
+int Window::get_num_of_presses(Key key)
+{
+    return m_key_presses[key];
+}
+
 int Window::get_width()
 {
     return m_size.w;
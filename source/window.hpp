@@ -1,5 +1,13 @@
 #pragma once
 
+enum Key : uint8_t
+{
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_SPACE,
+    KEY_COUNT
+};
+
 class Window
 {
     class SDL_Window* m_handle;
@@ -8,6 +16,9 @@ class Window
     struct { int w, h; } m_size;
     bool m_open;
 
+    // Times each key went down during the last poll_events, counting repeats while held.
+    int m_key_presses[KEY_COUNT];
+
     class Renderer& m_renderer;
     
 public:
@@ -16,6 +27,7 @@ public:
     bool is_open();
     void swap_buffers();
     void poll_events();
+    int get_num_of_presses(Key key);
     int get_width();
     int get_height();
 };